@@ -0,0 +1,117 @@
+#include "AdaptiveChunkSizer.h"
+
+namespace clipboard {
+
+AdaptiveChunkSizer::AdaptiveChunkSizer()
+    : nextSlot_(0)
+    , enabled_(true)
+    , minChunkSize_(DEFAULT_MIN_CHUNK_SIZE)
+    , maxChunkSize_(DEFAULT_MAX_CHUNK_SIZE)
+    , currentChunkSize_(DEFAULT_CHUNK_SIZE)
+{
+    reset();
+}
+
+void AdaptiveChunkSizer::setEnabled(bool enabled)
+{
+    enabled_.store(enabled);
+}
+
+bool AdaptiveChunkSizer::isEnabled() const
+{
+    return enabled_.load();
+}
+
+void AdaptiveChunkSizer::setBounds(qint64 minChunkSize, qint64 maxChunkSize)
+{
+    minChunkSize = qMax(minChunkSize, (qint64)4096);
+    minChunkSize_.store(minChunkSize);
+    maxChunkSize_.store(qMax(maxChunkSize, minChunkSize));
+}
+
+qint64 AdaptiveChunkSizer::minChunkSize() const
+{
+    return minChunkSize_.load();
+}
+
+qint64 AdaptiveChunkSizer::maxChunkSize() const
+{
+    return maxChunkSize_.load();
+}
+
+void AdaptiveChunkSizer::reset()
+{
+    for (std::atomic<qint64>& size : readSizes_) {
+        size.store(0, std::memory_order_relaxed);
+    }
+    nextSlot_.store(0);
+    currentChunkSize_.store(enabled_.load() ? minChunkSize_.load() : DEFAULT_CHUNK_SIZE);
+}
+
+void AdaptiveChunkSizer::recordReadSize(qint64 maxSize)
+{
+    if (maxSize <= 0) {
+        return;
+    }
+    quint32 slot = nextSlot_.fetch_add(1, std::memory_order_relaxed) % WINDOW_SIZE;
+    readSizes_[slot].store(maxSize, std::memory_order_relaxed);
+}
+
+qint64 AdaptiveChunkSizer::nextChunkSize(qint64 bufferedBytes, qint64 highWatermark)
+{
+    if (!enabled_.load()) {
+        currentChunkSize_.store(DEFAULT_CHUNK_SIZE);
+        return DEFAULT_CHUNK_SIZE;
+    }
+
+    const qint64 minSize = minChunkSize_.load();
+    const qint64 maxSize = maxChunkSize_.load();
+
+    // 还没有读取记录时用最小块，尽快交出第一个字节
+    qint64 total = 0;
+    int samples = 0;
+    for (const std::atomic<qint64>& size : readSizes_) {
+        qint64 value = size.load(std::memory_order_relaxed);
+        if (value > 0) {
+            total += value;
+            ++samples;
+        }
+    }
+    if (samples == 0) {
+        currentChunkSize_.store(minSize);
+        return minSize;
+    }
+
+    // 以典型请求大小为基准，取2的幂，使一个块正好被整数次读取消费，减少拆分
+    qint64 size = roundUpToPowerOfTwo(total / samples);
+
+    // 队列占用越高说明消费者跟不上，加大块以减少分配次数；队列接近空时保持小块以降低延迟
+    if (highWatermark > 0) {
+        qint64 occupancy = bufferedBytes * 4 / highWatermark;
+        if (occupancy >= 2) {
+            size *= 4;
+        } else if (occupancy >= 1) {
+            size *= 2;
+        }
+    }
+
+    size = qBound(minSize, size, maxSize);
+    currentChunkSize_.store(size);
+    return size;
+}
+
+qint64 AdaptiveChunkSizer::currentChunkSize() const
+{
+    return currentChunkSize_.load();
+}
+
+qint64 AdaptiveChunkSizer::roundUpToPowerOfTwo(qint64 value)
+{
+    qint64 result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+} // namespace clipboard
@@ -0,0 +1,53 @@
+#pragma once
+#include <QtGlobal>
+#include <atomic>
+
+namespace clipboard {
+
+// 根据消费者最近的readData请求大小和队列占用情况，自适应选择生产者的数据块大小
+// recordReadSize由消费者线程调用，nextChunkSize由生产者线程调用
+class AdaptiveChunkSizer
+{
+public:
+    AdaptiveChunkSizer();
+
+    // 关闭自适应时固定使用DEFAULT_CHUNK_SIZE
+    void setEnabled(bool enabled);
+    bool isEnabled() const;
+
+    // 数据块大小的上下限
+    void setBounds(qint64 minChunkSize, qint64 maxChunkSize);
+    qint64 minChunkSize() const;
+    qint64 maxChunkSize() const;
+
+    // 每次传输开始前清空统计窗口
+    void reset();
+
+    // 记录一次readData请求的大小
+    void recordReadSize(qint64 maxSize);
+
+    // 计算下一个数据块的大小
+    qint64 nextChunkSize(qint64 bufferedBytes, qint64 highWatermark);
+
+    // 最近一次选择的数据块大小
+    qint64 currentChunkSize() const;
+
+    static const qint64 DEFAULT_CHUNK_SIZE = 512 * 1024;
+    static const qint64 DEFAULT_MIN_CHUNK_SIZE = 64 * 1024;
+    static const qint64 DEFAULT_MAX_CHUNK_SIZE = 4 * 1024 * 1024;
+
+private:
+    static qint64 roundUpToPowerOfTwo(qint64 value);
+
+    // 最近若干次readData请求大小的滑动窗口
+    static const int WINDOW_SIZE = 16;
+    std::atomic<qint64> readSizes_[WINDOW_SIZE];
+    std::atomic<quint32> nextSlot_;
+
+    std::atomic<bool> enabled_;
+    std::atomic<qint64> minChunkSize_;
+    std::atomic<qint64> maxChunkSize_;
+    std::atomic<qint64> currentChunkSize_;
+};
+
+} // namespace clipboard
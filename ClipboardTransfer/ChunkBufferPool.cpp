@@ -0,0 +1,215 @@
+#include "ChunkBufferPool.h"
+#include <new>
+
+namespace clipboard {
+
+// 块头与数据在一次分配中连续存放
+struct PooledBuffer::Block
+{
+    Block* next;
+    qint64 capacity;
+    int sizeClass;
+
+    char* data() {
+        return reinterpret_cast<char*>(this + 1);
+    }
+};
+
+PooledBuffer::PooledBuffer()
+    : pool_(nullptr)
+    , block_(nullptr)
+    , size_(0)
+{
+}
+
+PooledBuffer::PooledBuffer(ChunkBufferPool* pool, Block* block)
+    : pool_(pool)
+    , block_(block)
+    , size_(0)
+{
+}
+
+PooledBuffer::PooledBuffer(PooledBuffer&& other) noexcept
+    : pool_(other.pool_)
+    , block_(other.block_)
+    , size_(other.size_)
+{
+    other.pool_ = nullptr;
+    other.block_ = nullptr;
+    other.size_ = 0;
+}
+
+PooledBuffer& PooledBuffer::operator=(PooledBuffer&& other) noexcept
+{
+    if (this != &other) {
+        reset();
+        pool_ = other.pool_;
+        block_ = other.block_;
+        size_ = other.size_;
+        other.pool_ = nullptr;
+        other.block_ = nullptr;
+        other.size_ = 0;
+    }
+    return *this;
+}
+
+PooledBuffer::~PooledBuffer()
+{
+    reset();
+}
+
+char* PooledBuffer::data()
+{
+    return block_ ? block_->data() : nullptr;
+}
+
+const char* PooledBuffer::constData() const
+{
+    return block_ ? block_->data() : nullptr;
+}
+
+void PooledBuffer::setSize(qint64 size)
+{
+    size_ = qBound((qint64)0, size, capacity());
+}
+
+qint64 PooledBuffer::capacity() const
+{
+    return block_ ? block_->capacity : 0;
+}
+
+void PooledBuffer::reset()
+{
+    if (block_) {
+        pool_->release(block_);
+        block_ = nullptr;
+        pool_ = nullptr;
+        size_ = 0;
+    }
+}
+
+//////////////////////////////////////////////////////
+ChunkBufferPool::ChunkBufferPool()
+    : maxFreeBytes_(DEFAULT_MAX_FREE_BYTES)
+{
+    for (int i = 0; i < SIZE_CLASS_COUNT; ++i) {
+        freeLists_[i] = nullptr;
+    }
+}
+
+ChunkBufferPool::~ChunkBufferPool()
+{
+    // 所有借出的缓冲区必须在缓冲池销毁前归还
+    Q_ASSERT(stats_.outstanding == 0);
+    trim();
+}
+
+PooledBuffer ChunkBufferPool::acquire(qint64 size)
+{
+    const int sizeClass = sizeClassOf(size);
+    PooledBuffer::Block* block = nullptr;
+    {
+        QMutexLocker locker(&mutex_);
+        block = freeLists_[sizeClass];
+        if (block) {
+            freeLists_[sizeClass] = block->next;
+            stats_.freeBytes -= block->capacity;
+            ++stats_.hits;
+        } else {
+            ++stats_.misses;
+            stats_.pooledBytes += (qint64)1 << sizeClass;
+        }
+        ++stats_.outstanding;
+        stats_.highWaterMark = qMax(stats_.highWaterMark, stats_.outstanding);
+    }
+
+    if (!block) {
+        const qint64 capacity = (qint64)1 << sizeClass;
+        void* memory = ::operator new(sizeof(PooledBuffer::Block) + capacity);
+        block = new (memory) PooledBuffer::Block;
+        block->capacity = capacity;
+        block->sizeClass = sizeClass;
+    }
+    block->next = nullptr;
+    return PooledBuffer(this, block);
+}
+
+void ChunkBufferPool::release(PooledBuffer::Block* block)
+{
+    {
+        QMutexLocker locker(&mutex_);
+        --stats_.outstanding;
+        if (stats_.freeBytes + block->capacity <= maxFreeBytes_) {
+            block->next = freeLists_[block->sizeClass];
+            freeLists_[block->sizeClass] = block;
+            stats_.freeBytes += block->capacity;
+            return;
+        }
+        stats_.pooledBytes -= block->capacity;
+    }
+    // 空闲链表已满，在锁外释放
+    destroy(block);
+}
+
+ChunkBufferPool::Statistics ChunkBufferPool::statistics() const
+{
+    QMutexLocker locker(&mutex_);
+    return stats_;
+}
+
+void ChunkBufferPool::resetStatistics()
+{
+    QMutexLocker locker(&mutex_);
+    stats_.hits = 0;
+    stats_.misses = 0;
+    stats_.highWaterMark = stats_.outstanding;
+}
+
+void ChunkBufferPool::trim()
+{
+    QMutexLocker locker(&mutex_);
+    trimLocked(0);
+}
+
+void ChunkBufferPool::setMaxFreeBytes(qint64 bytes)
+{
+    QMutexLocker locker(&mutex_);
+    maxFreeBytes_ = qMax(bytes, (qint64)0);
+    trimLocked(maxFreeBytes_);
+}
+
+qint64 ChunkBufferPool::maxFreeBytes() const
+{
+    QMutexLocker locker(&mutex_);
+    return maxFreeBytes_;
+}
+
+void ChunkBufferPool::trimLocked(qint64 limit)
+{
+    for (int i = SIZE_CLASS_COUNT - 1; i >= 0 && stats_.freeBytes > limit; --i) {
+        while (freeLists_[i] && stats_.freeBytes > limit) {
+            PooledBuffer::Block* block = freeLists_[i];
+            freeLists_[i] = block->next;
+            stats_.freeBytes -= block->capacity;
+            stats_.pooledBytes -= block->capacity;
+            destroy(block);
+        }
+    }
+}
+
+void ChunkBufferPool::destroy(PooledBuffer::Block* block)
+{
+    block->~Block();
+    ::operator delete(block);
+}
+
+int ChunkBufferPool::sizeClassOf(qint64 size)
+{
+    int sizeClass = MIN_SIZE_CLASS;
+    while (sizeClass < SIZE_CLASS_COUNT - 1 && ((qint64)1 << sizeClass) < size) {
+        ++sizeClass;
+    }
+    return sizeClass;
+}
+
+} // namespace clipboard
@@ -0,0 +1,101 @@
+#pragma once
+#include <QtGlobal>
+#include <QMutex>
+
+namespace clipboard {
+
+class ChunkBufferPool;
+
+// 从缓冲池借出的数据块缓冲区，析构时自动归还，只能移动不能复制
+class PooledBuffer
+{
+public:
+    PooledBuffer();
+    PooledBuffer(PooledBuffer&& other) noexcept;
+    PooledBuffer& operator=(PooledBuffer&& other) noexcept;
+    ~PooledBuffer();
+
+    PooledBuffer(const PooledBuffer&) = delete;
+    PooledBuffer& operator=(const PooledBuffer&) = delete;
+
+    explicit operator bool() const {
+        return block_ != nullptr;
+    }
+
+    char* data();
+    const char* constData() const;
+    // 有效数据长度，不超过capacity()
+    qint64 size() const {
+        return size_;
+    }
+    void setSize(qint64 size);
+    qint64 capacity() const;
+
+    // 立即归还缓冲区
+    void reset();
+
+private:
+    friend class ChunkBufferPool;
+    struct Block;
+    PooledBuffer(ChunkBufferPool* pool, Block* block);
+
+    ChunkBufferPool* pool_;
+    Block* block_;
+    qint64 size_;
+};
+
+// 传输会话持有的数据块缓冲池，按2的幂大小分级的空闲链表
+// 生产者借出、消费者在数据块读完后归还，预热后每次传输不再产生新的堆分配
+class ChunkBufferPool
+{
+public:
+    struct Statistics
+    {
+        qint64 hits = 0;                // 从空闲链表直接取得
+        qint64 misses = 0;              // 需要新分配
+        qint64 outstanding = 0;         // 当前借出的缓冲区个数
+        qint64 highWaterMark = 0;       // 同时借出的最大个数
+        qint64 pooledBytes = 0;         // 池中分配过的总字节数（借出+空闲）
+        qint64 freeBytes = 0;           // 空闲链表中的字节数
+    };
+
+    ChunkBufferPool();
+    ~ChunkBufferPool();
+
+    ChunkBufferPool(const ChunkBufferPool&) = delete;
+    ChunkBufferPool& operator=(const ChunkBufferPool&) = delete;
+
+    // 借出容量不小于size的缓冲区
+    PooledBuffer acquire(qint64 size);
+
+    Statistics statistics() const;
+    // 重置命中统计，不释放空闲缓冲区
+    void resetStatistics();
+    // 释放所有空闲缓冲区
+    void trim();
+    // 空闲链表最多保留的字节数，超出时归还的缓冲区直接释放，并立即释放超出的部分
+    void setMaxFreeBytes(qint64 bytes);
+    qint64 maxFreeBytes() const;
+
+    static const qint64 DEFAULT_MAX_FREE_BYTES = 64 * 1024 * 1024;
+
+private:
+    friend class PooledBuffer;
+    void release(PooledBuffer::Block* block);
+
+    static int sizeClassOf(qint64 size);
+    // 从最大的分级开始释放空闲缓冲区，直到空闲字节数不超过limit，调用方持有mutex_
+    void trimLocked(qint64 limit);
+    static void destroy(PooledBuffer::Block* block);
+
+    static const int MIN_SIZE_CLASS = 12;   // 4KB
+    static const int SIZE_CLASS_COUNT = 32;
+
+    // 借出和归还分别在生产者和消费者线程，锁只保护空闲链表的一次出入栈
+    mutable QMutex mutex_;
+    PooledBuffer::Block* freeLists_[SIZE_CLASS_COUNT];
+    Statistics stats_;
+    qint64 maxFreeBytes_;
+};
+
+} // namespace clipboard
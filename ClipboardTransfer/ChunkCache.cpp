@@ -0,0 +1,160 @@
+#include "ChunkCache.h"
+#include <cstring>
+#include <iterator>
+
+namespace clipboard {
+
+ChunkCache::ChunkCache(qint64 budget)
+    : budget_(qMax(budget, (qint64)0))
+{
+}
+
+void ChunkCache::setBudget(qint64 budget)
+{
+    QMutexLocker locker(&mutex_);
+    budget_ = qMax(budget, (qint64)0);
+    evictLocked();
+}
+
+qint64 ChunkCache::budget() const
+{
+    QMutexLocker locker(&mutex_);
+    return budget_;
+}
+
+void ChunkCache::insert(DataChunk&& chunk)
+{
+    const qint64 size = chunk.size();
+    if (size <= 0) {
+        return;
+    }
+
+    QMutexLocker locker(&mutex_);
+    const Key key = { chunk.fileIndex, chunk.offset };
+    const qint64 end = key.offset + size;
+
+    // 已有数据块完全覆盖新块时丢弃新块
+    EntryMap::iterator it = entries_.upper_bound(key);
+    if (it != entries_.begin()) {
+        EntryMap::iterator prev = std::prev(it);
+        if (prev->first.fileIndex == key.fileIndex && prev->second.end(prev->first) >= end) {
+            return;
+        }
+    }
+
+    // 移除被新块完全覆盖的数据块，保证区间之间没有包含关系，查找时只需看前一个起点
+    it = entries_.lower_bound(key);
+    while (it != entries_.end() && it->first.fileIndex == key.fileIndex && it->first.offset < end) {
+        if (it->second.end(it->first) <= end) {
+            eraseLocked(it++);
+        } else {
+            ++it;
+        }
+    }
+
+    lru_.push_front(key);
+    Entry& entry = entries_[key];
+    entry.chunk = std::move(chunk);
+    entry.lru = lru_.begin();
+    stats_.cachedBytes += size;
+    stats_.insertedChunks++;
+    evictLocked();
+}
+
+qint64 ChunkCache::read(int fileIndex, qint64 offset, char* data, qint64 maxSize, bool gather)
+{
+    QMutexLocker locker(&mutex_);
+    qint64 copied = 0;
+    while (copied < maxSize) {
+        const qint64 position = offset + copied;
+        EntryMap::iterator it = findLocked(fileIndex, position);
+        if (it == entries_.end()) {
+            break;
+        }
+
+        // 只复制需要的部分，数据块本身留在缓存中
+        const qint64 start = position - it->first.offset;
+        const qint64 copySize = qMin(it->second.chunk.size() - start, maxSize - copied);
+        memcpy(data + copied, it->second.chunk.constData() + start, copySize);
+        copied += copySize;
+        lru_.splice(lru_.begin(), lru_, it->second.lru);
+
+        if (!gather) {
+            break;
+        }
+    }
+    return copied;
+}
+
+bool ChunkCache::contains(int fileIndex, qint64 offset)
+{
+    QMutexLocker locker(&mutex_);
+    return findLocked(fileIndex, offset) != entries_.end();
+}
+
+qint64 ChunkCache::nextCachedOffset(int fileIndex, qint64 offset, qint64 limit) const
+{
+    QMutexLocker locker(&mutex_);
+    const Key key = { fileIndex, offset };
+    EntryMap::const_iterator it = entries_.lower_bound(key);
+    if (it != entries_.end() && it->first.fileIndex == fileIndex) {
+        return qMin(it->first.offset, limit);
+    }
+    return limit;
+}
+
+void ChunkCache::clear()
+{
+    QMutexLocker locker(&mutex_);
+    entries_.clear();
+    lru_.clear();
+    stats_.cachedBytes = 0;
+}
+
+ChunkCache::Statistics ChunkCache::statistics() const
+{
+    QMutexLocker locker(&mutex_);
+    return stats_;
+}
+
+void ChunkCache::resetStatistics()
+{
+    QMutexLocker locker(&mutex_);
+    stats_.insertedChunks = 0;
+    stats_.evictedChunks = 0;
+    stats_.evictedBytes = 0;
+}
+
+ChunkCache::EntryMap::iterator ChunkCache::findLocked(int fileIndex, qint64 offset)
+{
+    // 区间之间没有包含关系，起点不大于offset的最后一个数据块也是终点最大的一个
+    const Key key = { fileIndex, offset };
+    EntryMap::iterator it = entries_.upper_bound(key);
+    if (it == entries_.begin()) {
+        return entries_.end();
+    }
+    --it;
+    if (it->first.fileIndex != fileIndex || it->second.end(it->first) <= offset) {
+        return entries_.end();
+    }
+    return it;
+}
+
+void ChunkCache::eraseLocked(EntryMap::iterator it)
+{
+    stats_.cachedBytes -= it->second.chunk.size();
+    lru_.erase(it->second.lru);
+    entries_.erase(it);
+}
+
+void ChunkCache::evictLocked()
+{
+    while (stats_.cachedBytes > budget_ && lru_.size() > 1) {
+        EntryMap::iterator it = entries_.find(lru_.back());
+        stats_.evictedChunks++;
+        stats_.evictedBytes += it->second.chunk.size();
+        eraseLocked(it);
+    }
+}
+
+} // namespace clipboard
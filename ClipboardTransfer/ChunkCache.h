@@ -0,0 +1,86 @@
+#pragma once
+#include "DataChunk.h"
+#include <QMutex>
+#include <list>
+#include <map>
+
+namespace clipboard {
+
+// 按(文件下标, 文件偏移)索引的数据块缓存，超过字节预算时按LRU淘汰
+// readData从这里按偏移读取，FileStream::Seek和重复粘贴不需要重新读取源文件
+class ChunkCache
+{
+public:
+    struct Statistics
+    {
+        qint64 cachedBytes = 0;     // 当前缓存的字节数
+        qint64 insertedChunks = 0;  // 放入缓存的数据块个数
+        qint64 evictedChunks = 0;   // 因超过预算被淘汰的数据块个数
+        qint64 evictedBytes = 0;    // 被淘汰的字节数
+    };
+
+    explicit ChunkCache(qint64 budget = DEFAULT_BUDGET);
+
+    ChunkCache(const ChunkCache&) = delete;
+    ChunkCache& operator=(const ChunkCache&) = delete;
+
+    // 缓存字节预算，最近放入的一个数据块总是保留
+    void setBudget(qint64 budget);
+    qint64 budget() const;
+
+    // 按chunk.fileIndex和chunk.offset放入缓存，被已有数据块完全覆盖时丢弃
+    void insert(DataChunk&& chunk);
+
+    // 从offset开始复制连续缓存的数据，gather为false时只从一个数据块复制
+    qint64 read(int fileIndex, qint64 offset, char* data, qint64 maxSize, bool gather);
+
+    // offset处的数据是否在缓存中
+    bool contains(int fileIndex, qint64 offset);
+
+    // offset之后第一个缓存区间的起点，没有时返回limit
+    qint64 nextCachedOffset(int fileIndex, qint64 offset, qint64 limit) const;
+
+    void clear();
+
+    Statistics statistics() const;
+    void resetStatistics();
+
+    static const qint64 DEFAULT_BUDGET = 128 * 1024 * 1024;
+
+private:
+    struct Key
+    {
+        int fileIndex;
+        qint64 offset;
+
+        bool operator<(const Key& other) const {
+            return fileIndex != other.fileIndex ? fileIndex < other.fileIndex : offset < other.offset;
+        }
+    };
+
+    struct Entry
+    {
+        DataChunk chunk;
+        std::list<Key>::iterator lru;
+
+        qint64 end(const Key& key) const {
+            return key.offset + chunk.size();
+        }
+    };
+
+    typedef std::map<Key, Entry> EntryMap;
+
+    // 包含offset的数据块，没有时返回entries_.end()
+    EntryMap::iterator findLocked(int fileIndex, qint64 offset);
+    void eraseLocked(EntryMap::iterator it);
+    void evictLocked();
+
+    mutable QMutex mutex_;
+    EntryMap entries_;
+    // 最近使用的在前
+    std::list<Key> lru_;
+    qint64 budget_;
+    Statistics stats_;
+};
+
+} // namespace clipboard
@@ -0,0 +1,227 @@
+#include "ChunkCompressor.h"
+#include <QByteArray>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QThread>
+#include <cmath>
+
+namespace clipboard {
+
+namespace {
+// 估计熵时最多采样的字节数
+const qint64 kEntropySampleSize = 4096;
+// 小于该大小的数据块不值得压缩
+const qint64 kMinCompressSize = 4096;
+}
+
+ChunkCompressor::ChunkCompressor(int threadCount, int level)
+    : level_(qBound(-1, level, 9))
+    , closing_(false)
+{
+    if (threadCount <= 0) {
+        threadCount = qMax(1, QThread::idealThreadCount());
+    }
+    maxJobs_ = static_cast<size_t>(threadCount) * JOBS_PER_THREAD;
+    for (int i = 0; i < threadCount; ++i) {
+        QThread* worker = QThread::create([this]() { workerLoop(); });
+        workers_.push_back(worker);
+        worker->start();
+    }
+}
+
+ChunkCompressor::~ChunkCompressor()
+{
+    {
+        QMutexLocker locker(&mutex_);
+        closing_ = true;
+        jobQueued_.wakeAll();
+    }
+    for (QThread* worker : workers_) {
+        worker->wait();
+        delete worker;
+    }
+    workers_.clear();
+}
+
+void ChunkCompressor::submit(DataChunk&& chunk)
+{
+    std::unique_ptr<Job> job(new Job());
+    job->chunk = std::move(chunk);
+
+    QMutexLocker locker(&mutex_);
+    jobs_.push_back(std::move(job));
+    jobQueued_.wakeOne();
+}
+
+bool ChunkCompressor::takeNext(DataChunk& chunk)
+{
+    QMutexLocker locker(&mutex_);
+    if (jobs_.empty() || !jobs_.front()->done) {
+        return false;
+    }
+    chunk = std::move(jobs_.front()->chunk);
+    jobs_.pop_front();
+    return true;
+}
+
+bool ChunkCompressor::notifyWhenReady(const std::function<void()>& wakeup)
+{
+    QMutexLocker locker(&mutex_);
+    if (jobs_.empty() || jobs_.front()->done) {
+        return false;
+    }
+    readyCallback_ = wakeup;
+    return true;
+}
+
+void ChunkCompressor::cancelNotify()
+{
+    QMutexLocker locker(&mutex_);
+    readyCallback_ = nullptr;
+}
+
+bool ChunkCompressor::isFull() const
+{
+    QMutexLocker locker(&mutex_);
+    return jobs_.size() >= maxJobs_;
+}
+
+bool ChunkCompressor::isEmpty() const
+{
+    QMutexLocker locker(&mutex_);
+    return jobs_.empty();
+}
+
+bool ChunkCompressor::decompress(DataChunk& chunk)
+{
+    if (!chunk.isCompressed()) {
+        return true;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    QByteArray raw = qUncompress(reinterpret_cast<const uchar*>(chunk.constData()), static_cast<int>(chunk.size()));
+    const qint64 elapsed = timer.nsecsElapsed() / 1000;
+    if (raw.size() != chunk.rawSize) {
+        qWarning() << "decompress chunk failed, offset:" << chunk.offset << "expected:" << chunk.rawSize << "got:" << raw.size();
+        return false;
+    }
+
+    chunk.buffer.reset();
+    chunk.owner.reset();
+    chunk.data = raw;
+    chunk.rawSize = -1;
+
+    QMutexLocker locker(&mutex_);
+    stats_.decompressedChunks++;
+    stats_.decompressMicros += elapsed;
+    return true;
+}
+
+ChunkCompressor::Statistics ChunkCompressor::statistics() const
+{
+    QMutexLocker locker(&mutex_);
+    return stats_;
+}
+
+void ChunkCompressor::resetStatistics()
+{
+    QMutexLocker locker(&mutex_);
+    stats_ = Statistics();
+}
+
+double ChunkCompressor::estimateEntropy(const char* data, qint64 size)
+{
+    if (size <= 0) {
+        return 0.0;
+    }
+
+    // 等间隔采样，整块扫描的开销接近压缩本身
+    qint64 histogram[256] = {};
+    const qint64 step = qMax((qint64)1, size / kEntropySampleSize);
+    qint64 samples = 0;
+    for (qint64 i = 0; i < size; i += step) {
+        histogram[static_cast<uchar>(data[i])]++;
+        samples++;
+    }
+
+    double entropy = 0.0;
+    for (qint64 count : histogram) {
+        if (count > 0) {
+            double p = double(count) / samples;
+            entropy -= p * std::log2(p);
+        }
+    }
+    return entropy;
+}
+
+void ChunkCompressor::workerLoop()
+{
+    QMutexLocker locker(&mutex_);
+    for (;;) {
+        Job* job = nullptr;
+        for (const std::unique_ptr<Job>& queued : jobs_) {
+            if (!queued->started) {
+                job = queued.get();
+                break;
+            }
+        }
+        if (!job) {
+            if (closing_) {
+                return;
+            }
+            jobQueued_.wait(&mutex_);
+            continue;
+        }
+
+        // 任务在完成并被取走之前不会出队，解锁期间指针保持有效
+        job->started = true;
+        locker.unlock();
+        compress(job->chunk);
+        locker.relock();
+        job->done = true;
+        if (readyCallback_ && job == jobs_.front().get()) {
+            std::function<void()> callback = std::move(readyCallback_);
+            readyCallback_ = nullptr;
+            callback();
+        }
+    }
+}
+
+void ChunkCompressor::compress(DataChunk& chunk)
+{
+    const qint64 size = chunk.size();
+    bool skipped = false;
+
+    QElapsedTimer timer;
+    timer.start();
+    if (size >= kMinCompressSize) {
+        if (estimateEntropy(chunk.constData(), size) > ENTROPY_THRESHOLD) {
+            skipped = true;
+        } else {
+            QByteArray packed = qCompress(reinterpret_cast<const uchar*>(chunk.constData()), static_cast<int>(size), level_);
+            if (!packed.isEmpty() && packed.size() < size * MIN_SAVING_RATIO) {
+                // 原缓冲区立即归还缓冲池，队列中只保留压缩后的数据
+                chunk.buffer.reset();
+                chunk.owner.reset();
+                chunk.data = packed;
+                chunk.rawSize = size;
+            }
+        }
+    }
+    const qint64 elapsed = timer.nsecsElapsed() / 1000;
+
+    QMutexLocker locker(&mutex_);
+    stats_.chunks++;
+    stats_.rawBytes += size;
+    stats_.storedBytes += chunk.size();
+    stats_.compressMicros += elapsed;
+    if (chunk.isCompressed()) {
+        stats_.compressedChunks++;
+    }
+    if (skipped) {
+        stats_.skippedChunks++;
+    }
+}
+
+} // namespace clipboard
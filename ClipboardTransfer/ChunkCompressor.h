@@ -0,0 +1,102 @@
+#pragma once
+#include "DataChunk.h"
+#include <QMutex>
+#include <QWaitCondition>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+
+class QThread;
+
+namespace clipboard {
+
+// 传输管道中的可选压缩层：生产者提交的数据块由多个工作线程各自独立地用qCompress压缩，
+// 按提交顺序取回后入队；readData一侧在数据块离开队列时解压。每个数据块自成一块，
+// 互不依赖，可以并行压缩、单独解压和补读。采样熵过高（已压缩的媒体、压缩包等）的数据块
+// 以及压缩后没有明显变小的数据块原样通过
+class ChunkCompressor
+{
+public:
+    struct Statistics
+    {
+        qint64 chunks = 0;              // 经过压缩层的数据块个数
+        qint64 compressedChunks = 0;    // 以压缩形式入队的个数
+        qint64 skippedChunks = 0;       // 因采样熵过高而未尝试压缩的个数
+        qint64 rawBytes = 0;            // 压缩前的总字节数
+        qint64 storedBytes = 0;         // 入队的总字节数（压缩或原样）
+        qint64 compressMicros = 0;      // 所有工作线程压缩耗时之和
+        qint64 decompressedChunks = 0;
+        qint64 decompressMicros = 0;    // readData一侧解压耗时之和
+
+        // 压缩比，rawBytes / storedBytes
+        double ratio() const {
+            return storedBytes > 0 ? double(rawBytes) / storedBytes : 1.0;
+        }
+    };
+
+    // threadCount为0时使用QThread::idealThreadCount()，level为qCompress的压缩级别
+    explicit ChunkCompressor(int threadCount = 0, int level = DEFAULT_LEVEL);
+    ~ChunkCompressor();
+
+    ChunkCompressor(const ChunkCompressor&) = delete;
+    ChunkCompressor& operator=(const ChunkCompressor&) = delete;
+
+    // 生产者线程调用：提交一个数据块，之后由takeNext按提交顺序取回
+    void submit(DataChunk&& chunk);
+    // 取出最早提交的数据块，它尚未压缩完或没有已提交的数据块时返回false，不等待
+    bool takeNext(DataChunk& chunk);
+    // 最早提交的数据块尚未压缩完时返回true，并在它压缩完时调用一次wakeup（持有内部锁时调用，
+    // 应当只重新提交任务）；没有已提交的数据块或已可取出时返回false，不登记。生产者据此让出线程而不是等待
+    bool notifyWhenReady(const std::function<void()>& wakeup);
+    // 取消notifyWhenReady登记的回调，返回后不会再被调用
+    void cancelNotify();
+    // 已提交但尚未取回的数据块达到上限，应先取回再提交
+    bool isFull() const;
+    // 没有已提交但尚未取回的数据块
+    bool isEmpty() const;
+
+    // 消费者线程调用：把压缩的数据块还原，未压缩的直接返回true
+    bool decompress(DataChunk& chunk);
+
+    Statistics statistics() const;
+    void resetStatistics();
+
+    // 按采样的字节直方图估计每字节的信息熵（0~8比特）
+    static double estimateEntropy(const char* data, qint64 size);
+
+    static const int DEFAULT_LEVEL = 1;
+    // 采样熵超过该值（比特/字节）时不尝试压缩
+    static constexpr double ENTROPY_THRESHOLD = 7.5;
+    // 压缩后不小于原大小的该比例时原样通过，避免解压开销换不来多少空间
+    static constexpr double MIN_SAVING_RATIO = 0.9;
+    // 在途数据块个数上限为工作线程数的倍数
+    static const int JOBS_PER_THREAD = 2;
+
+private:
+    struct Job
+    {
+        DataChunk chunk;
+        bool started = false;
+        bool done = false;
+    };
+
+    void workerLoop();
+    void compress(DataChunk& chunk);
+
+    int level_;
+    std::vector<QThread*> workers_;
+    size_t maxJobs_;
+
+    mutable QMutex mutex_;
+    QWaitCondition jobQueued_;
+    // 生产者登记的回调，队头的数据块压缩完时调用一次
+    std::function<void()> readyCallback_;
+    // 按提交顺序排列，工作线程取第一个未开始的，生产者从队头取已完成的
+    std::deque<std::unique_ptr<Job>> jobs_;
+    bool closing_;
+    Statistics stats_;
+};
+
+} // namespace clipboard
@@ -0,0 +1,88 @@
+#pragma once
+#include <QByteArray>
+#include <QString>
+#include <QtEndian>
+
+namespace clipboard {
+
+// 网络数据来源的对端和流水线参数
+struct NetworkPeer
+{
+    QString host = QStringLiteral("127.0.0.1");
+    quint16 port = 0;
+    // 接收窗口：已发出但尚未收到应答的读取请求的字节数上限，决定了一个往返内能在途的数据量
+    qint64 receiveWindow = 8 * 1024 * 1024;
+    int timeoutMs = 30000;
+};
+
+// 简单的分块传输协议，所有帧为 [4字节大端body长度][1字节类型][body]
+//   OpenRequest  客户端 -> 服务端  body: UTF-8路径
+//   OpenReply    服务端 -> 客户端  body: 8字节大端文件大小
+//   ReadRequest  客户端 -> 服务端  body: 8字节大端偏移 + 4字节大端长度
+//   DataReply    服务端 -> 客户端  body: 8字节大端偏移 + 数据
+//   ErrorReply   服务端 -> 客户端  body: UTF-8错误信息
+// 读取请求可以连续发送而不等待应答（流水线），服务端按请求顺序应答
+namespace ChunkProtocol {
+
+enum FrameType : quint8 {
+    OpenRequest = 1,
+    OpenReply = 2,
+    ReadRequest = 3,
+    DataReply = 4,
+    ErrorReply = 5
+};
+
+const int HEADER_SIZE = 5;
+const int OFFSET_SIZE = 8;
+// 单个读取请求的长度上限，同时限制了接收方为一帧分配的内存
+const quint32 MAX_READ_LENGTH = 64 * 1024 * 1024;
+const quint32 MAX_BODY_SIZE = MAX_READ_LENGTH + OFFSET_SIZE;
+
+inline QByteArray header(FrameType type, quint32 bodySize)
+{
+    QByteArray frame(HEADER_SIZE, Qt::Uninitialized);
+    qToBigEndian<quint32>(bodySize, frame.data());
+    frame[4] = static_cast<char>(type);
+    return frame;
+}
+
+inline QByteArray openRequest(const QString& path)
+{
+    QByteArray body = path.toUtf8();
+    return header(OpenRequest, body.size()) + body;
+}
+
+inline QByteArray openReply(qint64 fileSize)
+{
+    QByteArray frame = header(OpenReply, OFFSET_SIZE);
+    frame.resize(HEADER_SIZE + OFFSET_SIZE);
+    qToBigEndian<qint64>(fileSize, frame.data() + HEADER_SIZE);
+    return frame;
+}
+
+inline QByteArray readRequest(qint64 offset, quint32 length)
+{
+    QByteArray frame = header(ReadRequest, OFFSET_SIZE + 4);
+    frame.resize(HEADER_SIZE + OFFSET_SIZE + 4);
+    qToBigEndian<qint64>(offset, frame.data() + HEADER_SIZE);
+    qToBigEndian<quint32>(length, frame.data() + HEADER_SIZE + OFFSET_SIZE);
+    return frame;
+}
+
+inline QByteArray errorReply(const QString& message)
+{
+    QByteArray body = message.toUtf8();
+    return header(ErrorReply, body.size()) + body;
+}
+
+// 解析帧头，body长度超出上限时返回false
+inline bool parseHeader(const char* data, FrameType& type, quint32& bodySize)
+{
+    bodySize = qFromBigEndian<quint32>(data);
+    type = static_cast<FrameType>(static_cast<quint8>(data[4]));
+    return bodySize <= MAX_BODY_SIZE;
+}
+
+} // namespace ChunkProtocol
+
+} // namespace clipboard
@@ -0,0 +1,63 @@
+#pragma once
+#include "DataChunk.h"
+#include "ChunkProtocol.h"
+#include <QString>
+#include <QFile>
+
+namespace clipboard {
+
+// 生产者的数据来源，每次读取一个数据块
+class ChunkSource
+{
+public:
+    // 数据来源方式
+    enum Mode {
+        Buffered,       // QFile::read读入新分配的缓冲区
+        MemoryMapped,   // 映射文件窗口，数据块为映射内存上的视图，不可映射时退回Buffered
+        Network,        // 通过ChunkProtocol从NetworkPeer拉取，文件路径是对端上的路径
+        IoUring         // io_uring异步预读，保持queueDepth个读请求在途，不可用时退回Buffered
+    };
+
+    ChunkSource() : bufferPool_(nullptr) {}
+    virtual ~ChunkSource() {}
+
+    // 设置后缓冲读取从缓冲池借用数据块缓冲区，而不是每块新分配
+    void setBufferPool(ChunkBufferPool* pool) {
+        bufferPool_ = pool;
+    }
+
+    virtual bool open(const QString& filePath) = 0;
+    virtual void close() = 0;
+
+    // 读取不超过maxSize字节到chunk，出错或到达末尾时返回false
+    virtual bool readChunk(qint64 maxSize, DataChunk& chunk) = 0;
+
+    // 移动到offset处，下一次readChunk从这里开始，用于补读缓存中缺失的区间
+    virtual bool seek(qint64 offset) = 0;
+    // 移动到offset并说明接下来只读取length字节，网络来源据此不为区间之外发送请求
+    virtual bool seekRange(qint64 offset, qint64 length) {
+        Q_UNUSED(length);
+        return seek(offset);
+    }
+
+    virtual bool atEnd() const = 0;
+    virtual QString errorString() const = 0;
+
+    // 打断正在阻塞的readChunk，停止传输时由其他线程调用
+    virtual void interrupt() {}
+
+    // Network模式使用peer，IoUring模式使用queueDepth和prefetchBudget（预读缓冲区的总字节数，0为不限），
+    // 其他模式忽略
+    static ChunkSource* create(Mode mode, const NetworkPeer& peer = NetworkPeer(), int queueDepth = DEFAULT_QUEUE_DEPTH,
+                               qint64 prefetchBudget = 0);
+
+    static const int DEFAULT_QUEUE_DEPTH = 16;
+
+protected:
+    // 把file当前位置的至多maxSize字节读入chunk，有缓冲池时使用池中的缓冲区
+    bool readFromFile(QFile& file, qint64 maxSize, DataChunk& chunk);
+
+    ChunkBufferPool* bufferPool_;
+};
+
+} // namespace clipboard
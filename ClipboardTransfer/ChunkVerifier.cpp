@@ -0,0 +1,367 @@
+#include "ChunkVerifier.h"
+#include "Crc32c.h"
+#include <QDebug>
+#include <QString>
+#include <QElapsedTimer>
+#include <QThread>
+
+namespace clipboard {
+
+ChunkVerifier::ChunkVerifier(int fileCount, bool verifyReceived)
+    : busy_(false)
+    , closing_(false)
+    , files_(qMax(fileCount, 0))
+    , mismatch_(false)
+    , verifyReceived_(verifyReceived)
+    , checkpoints_(qMax(fileCount, 0))
+{
+    worker_ = QThread::create([this]() { workerLoop(); });
+    worker_->start();
+}
+
+ChunkVerifier::~ChunkVerifier()
+{
+    {
+        QMutexLocker locker(&mutex_);
+        closing_ = true;
+        jobQueued_.wakeAll();
+        fileFinished_.wakeAll();
+    }
+    worker_->wait();
+    delete worker_;
+}
+
+ChunkVerifier::Job ChunkVerifier::makeJob(DataChunk& chunk, bool sequential)
+{
+    if (chunk.buffer) {
+        // 数据块改为引用共享持有的缓冲区，最后一个引用释放时归还缓冲池
+        std::shared_ptr<PooledBuffer> holder = std::make_shared<PooledBuffer>(std::move(chunk.buffer));
+        chunk.data = QByteArray::fromRawData(holder->constData(), static_cast<int>(holder->size()));
+        chunk.owner = holder;
+    }
+
+    Job job;
+    job.fileIndex = chunk.fileIndex;
+    job.offset = chunk.offset;
+    job.data = chunk.data;
+    job.owner = chunk.owner;
+    // 指向作业自己持有的引用，数据块之后被压缩、移入缓存或被淘汰都不影响
+    job.bytes = job.data.constData();
+    job.size = job.data.size();
+    job.sequential = sequential;
+    return job;
+}
+
+void ChunkVerifier::enqueue(Job&& job)
+{
+    QMutexLocker locker(&mutex_);
+    jobs_.push_back(std::move(job));
+    jobQueued_.wakeOne();
+}
+
+void ChunkVerifier::submitSource(DataChunk& chunk, bool sequential)
+{
+    // 只为检查点计算时补读的数据块不需要CRC
+    if (!verifyReceived_ && !sequential) {
+        return;
+    }
+    Job job = makeJob(chunk, sequential);
+    job.source = true;
+    enqueue(std::move(job));
+}
+
+void ChunkVerifier::submit(DataChunk& chunk, bool sequential, bool restored)
+{
+    if (!verifyReceived_) {
+        return;
+    }
+    Job job = makeJob(chunk, sequential);
+    job.restored = restored;
+    enqueue(std::move(job));
+}
+
+void ChunkVerifier::discard(const DataChunk& chunk)
+{
+    if (!verifyReceived_) {
+        return;
+    }
+    Job job;
+    job.fileIndex = chunk.fileIndex;
+    job.offset = chunk.offset;
+    job.discard = true;
+    enqueue(std::move(job));
+}
+
+void ChunkVerifier::skipPrefix(int fileIndex, qint64 offset)
+{
+    QMutexLocker locker(&mutex_);
+    if (fileIndex >= 0 && fileIndex < static_cast<int>(files_.size())) {
+        files_[fileIndex].sourceCovered = offset;
+        files_[fileIndex].covered = offset;
+    }
+}
+
+void ChunkVerifier::attachCheckpoint(int fileIndex, std::unique_ptr<TransferCheckpoint> checkpoint)
+{
+    Job job;
+    job.fileIndex = fileIndex;
+    job.attach = true;
+    job.checkpoint = std::move(checkpoint);
+    enqueue(std::move(job));
+}
+
+void ChunkVerifier::closeCheckpoint(int fileIndex)
+{
+    Job job;
+    job.fileIndex = fileIndex;
+    job.detach = true;
+    enqueue(std::move(job));
+}
+
+TransferCheckpoint::Statistics ChunkVerifier::checkpointStatistics() const
+{
+    QMutexLocker locker(&mutex_);
+    return checkpointStats_;
+}
+
+void ChunkVerifier::finishFile(int fileIndex, qint64 fileSize)
+{
+    if (!verifyReceived_) {
+        return;
+    }
+    Job job;
+    job.fileIndex = fileIndex;
+    job.finishSize = fileSize;
+    enqueue(std::move(job));
+}
+
+ChunkVerifier::FileResult ChunkVerifier::waitForFile(int fileIndex)
+{
+    QMutexLocker locker(&mutex_);
+    if (!verifyReceived_ || fileIndex < 0 || fileIndex >= static_cast<int>(files_.size())) {
+        return FileResult();
+    }
+    while (!closing_ && files_[fileIndex].result.status == FileResult::Pending) {
+        fileFinished_.wait(&mutex_);
+    }
+    return files_[fileIndex].result;
+}
+
+void ChunkVerifier::waitForIdle()
+{
+    QMutexLocker locker(&mutex_);
+    while (!jobs_.empty() || busy_) {
+        idle_.wait(&mutex_);
+    }
+}
+
+ChunkVerifier::FileResult ChunkVerifier::fileResult(int fileIndex) const
+{
+    QMutexLocker locker(&mutex_);
+    if (fileIndex < 0 || fileIndex >= static_cast<int>(files_.size())) {
+        return FileResult();
+    }
+    return files_[fileIndex].result;
+}
+
+ChunkVerifier::Statistics ChunkVerifier::statistics() const
+{
+    QMutexLocker locker(&mutex_);
+    return stats_;
+}
+
+void ChunkVerifier::workerLoop()
+{
+    QMutexLocker locker(&mutex_);
+    for (;;) {
+        while (!closing_ && jobs_.empty()) {
+            jobQueued_.wait(&mutex_);
+        }
+        if (jobs_.empty()) {
+            return;
+        }
+        Job job = std::move(jobs_.front());
+        jobs_.pop_front();
+        busy_ = true;
+
+        if (job.finishSize >= 0) {
+            finish(job);
+        } else if (job.discard) {
+            discardExpected(job);
+        } else {
+            locker.unlock();
+            if (job.attach || job.detach) {
+                updateCheckpoint(job);
+            } else if (job.source) {
+                hashSource(job);
+            } else {
+                verifyChunk(job);
+            }
+            // 在锁外释放对数据的引用
+            job = Job();
+            locker.relock();
+        }
+
+        busy_ = false;
+        if (jobs_.empty()) {
+            idle_.wakeAll();
+        }
+    }
+}
+
+void ChunkVerifier::hashSource(const Job& job)
+{
+    QElapsedTimer timer;
+    timer.start();
+    const quint32 checksum = Crc32c::compute(job.bytes, job.size);
+    const qint64 elapsed = timer.nsecsElapsed() / 1000;
+    if (job.sequential) {
+        appendCheckpoint(job, checksum);
+    }
+
+    QMutexLocker locker(&mutex_);
+    stats_.sourceBytes += job.size;
+    stats_.verifyMicros += elapsed;
+    if (!verifyReceived_ || job.fileIndex < 0 || job.fileIndex >= static_cast<int>(files_.size())) {
+        return;
+    }
+    FileState& file = files_[job.fileIndex];
+    Expected expected;
+    expected.size = job.size;
+    expected.checksum = checksum;
+    file.expected[job.offset].push_back(expected);
+    if (job.sequential && job.offset == file.sourceCovered) {
+        file.sourceDigest = Crc32c::combine(file.sourceDigest, checksum, job.size);
+        file.sourceCovered += job.size;
+    }
+}
+
+void ChunkVerifier::verifyChunk(const Job& job)
+{
+    QElapsedTimer timer;
+    timer.start();
+    const quint32 computed = job.restored ? Crc32c::compute(job.bytes, job.size) : 0;
+    const qint64 elapsed = timer.nsecsElapsed() / 1000;
+
+    QMutexLocker locker(&mutex_);
+    stats_.chunksVerified++;
+    stats_.bytesVerified += job.size;
+    stats_.verifyMicros += elapsed;
+    if (job.fileIndex < 0 || job.fileIndex >= static_cast<int>(files_.size())) {
+        return;
+    }
+    FileState& file = files_[job.fileIndex];
+    // 生产者一侧的作业排在同一数据块之前，这里一定已经有期望值
+    Expected expected;
+    bool found = false;
+    auto it = file.expected.find(job.offset);
+    if (it != file.expected.end()) {
+        expected = it->second.front();
+        found = true;
+        it->second.pop_front();
+        if (it->second.empty()) {
+            file.expected.erase(it);
+        }
+    }
+    const quint32 checksum = job.restored ? computed : expected.checksum;
+    if (!found || expected.size != job.size || expected.checksum != checksum) {
+        stats_.chunkMismatches++;
+        file.result.badChunks++;
+        mismatch_.store(true, std::memory_order_release);
+        qWarning() << "chunk checksum mismatch, file:" << job.fileIndex << "offset:" << job.offset
+                   << "size:" << job.size << "expected size:" << (found ? expected.size : -1)
+                   << "expected:" << QString::number(expected.checksum, 16) << "got:" << QString::number(checksum, 16);
+    }
+    // 只有紧接已拼接前缀的顺序数据块参与摘要，补读的数据块只做单块校验
+    if (job.sequential && job.offset == file.covered) {
+        file.digest = Crc32c::combine(file.digest, checksum, job.size);
+        file.covered += job.size;
+    }
+}
+
+void ChunkVerifier::updateCheckpoint(Job& job)
+{
+    if (job.fileIndex < 0 || job.fileIndex >= static_cast<int>(checkpoints_.size())) {
+        return;
+    }
+    std::unique_ptr<TransferCheckpoint>& checkpoint = checkpoints_[job.fileIndex];
+    if (job.attach) {
+        checkpoint = std::move(job.checkpoint);
+        return;
+    }
+    if (!checkpoint) {
+        return;
+    }
+    checkpoint->close();
+    const TransferCheckpoint::Statistics stats = checkpoint->statistics();
+    checkpoint.reset();
+
+    QMutexLocker locker(&mutex_);
+    checkpointStats_.writtenBytes += stats.writtenBytes;
+    checkpointStats_.flushes += stats.flushes;
+}
+
+void ChunkVerifier::appendCheckpoint(const Job& job, quint32 checksum)
+{
+    if (job.fileIndex < 0 || job.fileIndex >= static_cast<int>(checkpoints_.size())) {
+        return;
+    }
+    std::unique_ptr<TransferCheckpoint>& checkpoint = checkpoints_[job.fileIndex];
+    // 写入检查点失败不影响本次传输，只是之后无法从这里续传
+    if (checkpoint && !checkpoint->append(job.offset, job.size, checksum)) {
+        qWarning() << "write checkpoint failed:" << checkpoint->errorString();
+        checkpoint->close();
+        checkpoint.reset();
+    }
+}
+
+void ChunkVerifier::discardExpected(const Job& job)
+{
+    if (job.fileIndex < 0 || job.fileIndex >= static_cast<int>(files_.size())) {
+        return;
+    }
+    FileState& file = files_[job.fileIndex];
+    auto it = file.expected.find(job.offset);
+    if (it != file.expected.end()) {
+        it->second.pop_front();
+        if (it->second.empty()) {
+            file.expected.erase(it);
+        }
+    }
+}
+
+void ChunkVerifier::finish(const Job& job)
+{
+    if (job.fileIndex < 0 || job.fileIndex >= static_cast<int>(files_.size())) {
+        return;
+    }
+    FileState& file = files_[job.fileIndex];
+    FileResult& result = file.result;
+    result.sourceDigest = file.sourceDigest;
+    result.receivedDigest = file.digest;
+    if (result.badChunks > 0) {
+        result.status = FileResult::Mismatch;
+    } else if (file.sourceCovered != job.finishSize || file.covered != job.finishSize) {
+        result.status = FileResult::Incomplete;
+        qWarning() << "file" << job.fileIndex << "not verified, source covered:" << file.sourceCovered
+                   << "received covered:" << file.covered << "of" << job.finishSize;
+    } else if (result.receivedDigest != result.sourceDigest) {
+        result.status = FileResult::Mismatch;
+    } else {
+        result.status = FileResult::Verified;
+    }
+
+    if (result.status == FileResult::Mismatch) {
+        mismatch_.store(true, std::memory_order_release);
+        qWarning() << "file digest mismatch:" << job.fileIndex << "source:" << QString::number(result.sourceDigest, 16)
+                   << "received:" << QString::number(result.receivedDigest, 16) << "bad chunks:" << result.badChunks;
+    }
+    if (result.status == FileResult::Verified) {
+        stats_.filesVerified++;
+    } else {
+        stats_.fileMismatches++;
+    }
+    fileFinished_.wakeAll();
+}
+
+} // namespace clipboard
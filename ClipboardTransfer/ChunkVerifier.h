@@ -0,0 +1,166 @@
+#pragma once
+#include "DataChunk.h"
+#include "TransferCheckpoint.h"
+#include <QMutex>
+#include <QWaitCondition>
+#include <atomic>
+#include <deque>
+#include <map>
+#include <memory>
+#include <vector>
+
+class QThread;
+
+namespace clipboard {
+
+// 端到端校验：生产者把刚离开数据来源（压缩之前）的数据块交给校验线程计算CRC32C作为期望值，
+// readData一侧把离开队列的数据块再交给校验线程，经过溢出文件或解压重新生成的数据重新计算并比较，
+// 所有数据块都核对位置和大小。CRC都在校验线程上计算，不占用生产者和readData线程。
+// 顺序生产的数据块同时按偏移顺序拼接成整个文件的滚动摘要，readData读到文件末尾时比较两边的摘要，
+// 发现不一致后hasMismatch为true，readData据此返回读取错误。
+// 断点续传的检查点也挂在校验线程上：顺序生产的数据块的CRC计算一次，同时用作期望值和检查点日志的记录
+class ChunkVerifier
+{
+public:
+    struct FileResult
+    {
+        enum Status {
+            Pending,        // 尚未读到文件末尾，或校验线程还在处理
+            Verified,       // 摘要一致且没有数据块校验失败
+            Mismatch,       // 摘要不一致或有数据块校验失败
+            Incomplete      // 没有覆盖整个文件（如溢出读回失败后由补读替代），无法比较摘要
+        };
+        Status status = Pending;
+        quint32 sourceDigest = 0;       // 生产者对源文件计算的摘要
+        quint32 receivedDigest = 0;     // readData一侧对收到的数据计算的摘要
+        qint64 badChunks = 0;           // 校验失败的数据块个数
+    };
+
+    struct Statistics
+    {
+        qint64 chunksVerified = 0;
+        qint64 bytesVerified = 0;
+        qint64 chunkMismatches = 0;
+        qint64 filesVerified = 0;       // 摘要一致的文件个数
+        qint64 fileMismatches = 0;      // 摘要不一致或不完整的文件个数
+        qint64 sourceBytes = 0;         // 为生产者计算期望值的字节数
+        qint64 verifyMicros = 0;        // 校验线程计算耗时之和，包括期望值和校验
+    };
+
+    // verifyReceived为false时只为检查点计算源数据块的CRC，readData一侧的接口不做任何事
+    explicit ChunkVerifier(int fileCount, bool verifyReceived = true);
+    ~ChunkVerifier();
+
+    ChunkVerifier(const ChunkVerifier&) = delete;
+    ChunkVerifier& operator=(const ChunkVerifier&) = delete;
+
+    // 续传时在提交任何数据块之前调用：第fileIndex个文件的前offset字节已由检查点校验，
+    // 两边的摘要都从offset开始拼接
+    void skipPrefix(int fileIndex, qint64 offset);
+    // 生产者线程调用：提交一个刚从数据来源读出、还未压缩的数据块，校验线程计算它的期望值，
+    // sequential表示它是顺序生产的数据块，参与源文件的摘要；须在数据块入队之前调用。
+    // 缓冲池借出的缓冲区转为共享持有，数据块之后被压缩或溢出释放时校验线程仍可读取
+    void submitSource(DataChunk& chunk, bool sequential);
+    // 生产者线程调用：第fileIndex个文件之后提交的顺序数据块由校验线程记入checkpoint，
+    // 须在该文件的数据块之前调用；closeCheckpoint排在该文件所有数据块之后关闭它
+    void attachCheckpoint(int fileIndex, std::unique_ptr<TransferCheckpoint> checkpoint);
+    void closeCheckpoint(int fileIndex);
+    // 已关闭的检查点的统计之和
+    TransferCheckpoint::Statistics checkpointStatistics() const;
+
+    bool verifiesReceived() const {
+        return verifyReceived_;
+    }
+
+    // 消费者线程调用：提交一个离开队列的数据块，与同一位置的期望值比较，
+    // sequential表示它推进了文件前沿，参与整个文件的摘要。restored表示数据经过溢出文件或解压
+    // 重新生成，校验线程重新计算CRC；否则数据仍是生产者提交时计算过的同一块内存，
+    // 只核对位置和大小，CRC沿用期望值，每个字节只计算一次
+    void submit(DataChunk& chunk, bool sequential, bool restored);
+    // 消费者线程调用：数据块读回失败没有提交，丢弃它的期望值，之后补读的数据块与补读时的期望值比较
+    void discard(const DataChunk& chunk);
+    // 消费者线程调用：readData已读到第fileIndex个文件末尾，排在该文件所有数据块之后比较摘要
+    void finishFile(int fileIndex, qint64 fileSize);
+    // 消费者线程调用：等待finishFile提交的摘要比较完成并返回结果
+    FileResult waitForFile(int fileIndex);
+
+    // 已有数据块或文件摘要不一致，不加锁，readData每次调用检查
+    bool hasMismatch() const {
+        return mismatch_.load(std::memory_order_acquire);
+    }
+
+    // 等待已提交的校验全部完成
+    void waitForIdle();
+
+    FileResult fileResult(int fileIndex) const;
+    Statistics statistics() const;
+
+private:
+    struct Job
+    {
+        int fileIndex = 0;
+        qint64 offset = 0;
+        // 不小于0时是文件结束的比较请求，否则是数据块
+        qint64 finishSize = -1;
+        QByteArray data;
+        std::shared_ptr<const void> owner;
+        const char* bytes = nullptr;
+        qint64 size = 0;
+        bool source = false;
+        bool discard = false;
+        bool restored = false;
+        bool sequential = false;
+        // 挂上或关闭fileIndex的检查点
+        bool attach = false;
+        bool detach = false;
+        std::unique_ptr<TransferCheckpoint> checkpoint;
+    };
+
+    // 生产者一侧数据块的期望值
+    struct Expected
+    {
+        qint64 size = 0;
+        quint32 checksum = 0;
+    };
+
+    struct FileState
+    {
+        // 两边各自已按偏移顺序拼接的前缀长度和摘要
+        qint64 sourceCovered = 0;
+        quint32 sourceDigest = 0;
+        qint64 covered = 0;
+        quint32 digest = 0;
+        // 按偏移保存还未被消费者一侧校验的期望值，同一偏移按生产顺序排列（补读可能再次生产同一位置）
+        std::map<qint64, std::deque<Expected>> expected;
+        FileResult result;
+    };
+
+    // 把缓冲池借出的缓冲区转为共享持有，返回引用数据块内容的作业
+    static Job makeJob(DataChunk& chunk, bool sequential);
+    void enqueue(Job&& job);
+    void workerLoop();
+    void hashSource(const Job& job);
+    void verifyChunk(const Job& job);
+    void discardExpected(const Job& job);
+    void finish(const Job& job);
+    void updateCheckpoint(Job& job);
+    void appendCheckpoint(const Job& job, quint32 checksum);
+
+    QThread* worker_;
+    mutable QMutex mutex_;
+    QWaitCondition jobQueued_;
+    QWaitCondition idle_;
+    QWaitCondition fileFinished_;
+    std::deque<Job> jobs_;
+    bool busy_;
+    bool closing_;
+    std::vector<FileState> files_;
+    Statistics stats_;
+    std::atomic<bool> mismatch_;
+    const bool verifyReceived_;
+    // 每个文件打开中的检查点，只在校验线程上访问
+    std::vector<std::unique_ptr<TransferCheckpoint>> checkpoints_;
+    TransferCheckpoint::Statistics checkpointStats_;
+};
+
+} // namespace clipboard
@@ -0,0 +1,50 @@
+#include "ClipboardSink.h"
+#include "VirtualFileSrcStream.h"
+#include <QDebug>
+
+namespace clipboard {
+
+ClipboardSink::ClipboardSink()
+    : m_pVFSS(nullptr)
+{
+}
+
+ClipboardSink::~ClipboardSink()
+{
+    // 剪贴板可能比本对象活得更久，断开回调避免访问已销毁的对象
+    if (m_pVFSS) {
+        m_pVFSS->setReleasedCallback(nullptr);
+        m_pVFSS = nullptr;
+    }
+}
+
+void ClipboardSink::publish(const std::shared_ptr<FileBufferManager>& session, const TransferFileList& files)
+{
+    // 替换剪贴板上的数据对象前断开回调，旧对象由仍在粘贴的一方持有到结束
+    if (m_pVFSS) {
+        m_pVFSS->setReleasedCallback(nullptr);
+        m_pVFSS = nullptr;
+    }
+    createVFS(session);
+    qDebug() << "publish files to clipboard:" << files.size();
+}
+
+void ClipboardSink::createVFS(const std::shared_ptr<FileBufferManager>& session)
+{
+    IDataObject *data_obj = nullptr;
+    m_pVFSS = new VirtualFileSrcStream(session);
+    HRESULT hr = m_pVFSS ? S_OK : E_OUTOFMEMORY;
+    if (SUCCEEDED(hr))
+    {
+        m_pVFSS->setReleasedCallback([this]() { m_pVFSS = nullptr; });
+        m_pVFSS->onInit();
+        hr = m_pVFSS->QueryInterface(IID_IDataObject, (void**)&data_obj);
+        m_pVFSS->Release();
+        if (SUCCEEDED(hr)) {
+            ::OleSetClipboard(data_obj);
+            data_obj->Release();
+        }
+    }
+}
+
+} // namespace clipboard
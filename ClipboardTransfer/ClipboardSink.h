@@ -0,0 +1,25 @@
+#pragma once
+#include "StreamSink.h"
+
+namespace clipboard {
+
+class VirtualFileSrcStream;
+
+// 通过OLE剪贴板以虚拟文件的形式发布传输，资源管理器粘贴时调用FileStream::Read拉取数据
+class ClipboardSink : public StreamSink
+{
+public:
+    ClipboardSink();
+    ~ClipboardSink();
+
+    // 每个会话设置一个新的数据对象，正在进行的粘贴仍持有之前的数据对象和会话，互不影响
+    void publish(const std::shared_ptr<FileBufferManager>& session, const TransferFileList& files) override;
+
+private:
+    void createVFS(const std::shared_ptr<FileBufferManager>& session);
+
+    // 剪贴板持有当前数据对象的引用，对象销毁时通过回调清空该指针
+    VirtualFileSrcStream* m_pVFSS;
+};
+
+} // namespace clipboard
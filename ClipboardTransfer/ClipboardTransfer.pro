@@ -17,20 +17,26 @@ CONFIG(debug, debug|release) {
 }
 
 SOURCES +=     main.cpp \
-     dataproducerthread.cpp \
-     mainwindow.cpp \
-     VirtualFileSrcStream.cpp \
-     DataObject.cpp \
-     filebuffermanager.cpp
+     mainwindow.cpp
 
 HEADERS += \
-     dataproducerthread.h \
-     mainwindow.h \
-     VirtualFileSrcStream.h \
-     DataObject.h \
-     filebuffermanager.h
+     mainwindow.h
+
+# 传输核心，与TransferCore.pro构建的静态库是同一份源文件
+include(TransferCore.pri)
 
 # Windows specific
 win32 {
+    SOURCES += VirtualFileSrcStream.cpp \
+        DataObject.cpp \
+        ClipboardSink.cpp
+    HEADERS += VirtualFileSrcStream.h \
+        DataObject.h \
+        ClipboardSink.h
     LIBS += -lshell32 -lole32 -luuid -luser32
+} else {
+    # 其他平台通过QMimeData按需渲染
+    include(MimeData.pri)
+    SOURCES += MimeDataSink.cpp
+    HEADERS += MimeDataSink.h
 }
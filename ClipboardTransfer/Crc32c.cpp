@@ -0,0 +1,211 @@
+#include "Crc32c.h"
+#include <QtEndian>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define CRC32C_HAS_SSE42
+#include <nmmintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define CRC32C_TARGET_SSE42
+#else
+#define CRC32C_TARGET_SSE42 __attribute__((target("sse4.2")))
+#endif
+#endif
+
+namespace clipboard {
+
+namespace Crc32c {
+
+namespace {
+
+// 反射形式的Castagnoli多项式
+const quint32 kPolynomial = 0x82f63b78u;
+// 硬件路径三路交错时每一路的长度，三路各自的依赖链可以同时在流水线中执行
+const qint64 kLaneSize = 8 * 1024;
+
+// 模多项式乘法a(x) * b(x) mod P，反射表示（与zlib 1.2.12的multmodp相同）
+quint32 multModP(quint32 a, quint32 b)
+{
+    quint32 m = 1u << 31;
+    quint32 product = 0;
+    for (;;) {
+        if (a & m) {
+            product ^= b;
+            if ((a & (m - 1)) == 0) {
+                break;
+            }
+        }
+        m >>= 1;
+        b = (b & 1) ? (b >> 1) ^ kPolynomial : b >> 1;
+    }
+    return product;
+}
+
+struct Tables
+{
+    // 软件路径按8字节查表
+    quint32 slice[8][256];
+    // 把寄存器推进kLaneSize个零字节，按字节查表后异或
+    quint32 laneShift[4][256];
+    // x^(2^n) mod P
+    quint32 x2n[32];
+
+    Tables()
+    {
+        quint32 power = 1u << 30;   // x^1
+        x2n[0] = power;
+        for (int n = 1; n < 32; ++n) {
+            x2n[n] = power = multModP(power, power);
+        }
+        for (quint32 i = 0; i < 256; ++i) {
+            quint32 crc = i;
+            for (int bit = 0; bit < 8; ++bit) {
+                crc = (crc & 1) ? (crc >> 1) ^ kPolynomial : crc >> 1;
+            }
+            slice[0][i] = crc;
+        }
+        for (int k = 1; k < 8; ++k) {
+            for (int i = 0; i < 256; ++i) {
+                slice[k][i] = (slice[k - 1][i] >> 8) ^ slice[0][slice[k - 1][i] & 0xff];
+            }
+        }
+        for (int k = 0; k < 4; ++k) {
+            for (quint32 i = 0; i < 256; ++i) {
+                laneShift[k][i] = appendZeros(i << (8 * k), kLaneSize);
+            }
+        }
+    }
+
+    // 在CRC寄存器之后追加length个零字节，即乘以x^(8 * length) mod P
+    quint32 appendZeros(quint32 crc, qint64 length) const
+    {
+        quint32 power = 1u << 31;   // x^0
+        for (int k = 3; length > 0; length >>= 1, ++k) {
+            if (length & 1) {
+                power = multModP(x2n[k & 31], power);
+            }
+        }
+        return multModP(power, crc);
+    }
+
+    quint32 shiftLane(quint32 crc) const
+    {
+        return laneShift[0][crc & 0xff] ^ laneShift[1][(crc >> 8) & 0xff]
+             ^ laneShift[2][(crc >> 16) & 0xff] ^ laneShift[3][crc >> 24];
+    }
+};
+
+const Tables& tables()
+{
+    static const Tables instance;
+    return instance;
+}
+
+// 以下两个函数都直接处理CRC寄存器，不含首尾取反
+quint32 extendSoftware(quint32 crc, const uchar* p, qint64 size)
+{
+    const Tables& t = tables();
+    while (size >= 8) {
+        // 按小端读取，x86和ARM小端平台上与逐字节计算一致
+        quint32 lo = crc ^ qFromLittleEndian<quint32>(p);
+        quint32 hi = qFromLittleEndian<quint32>(p + 4);
+        crc = t.slice[7][lo & 0xff] ^ t.slice[6][(lo >> 8) & 0xff]
+            ^ t.slice[5][(lo >> 16) & 0xff] ^ t.slice[4][lo >> 24]
+            ^ t.slice[3][hi & 0xff] ^ t.slice[2][(hi >> 8) & 0xff]
+            ^ t.slice[1][(hi >> 16) & 0xff] ^ t.slice[0][hi >> 24];
+        p += 8;
+        size -= 8;
+    }
+    while (size-- > 0) {
+        crc = (crc >> 8) ^ t.slice[0][(crc ^ *p++) & 0xff];
+    }
+    return crc;
+}
+
+#ifdef CRC32C_HAS_SSE42
+quint64 load64(const uchar* p)
+{
+    quint64 value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+CRC32C_TARGET_SSE42 quint32 extendHardware(quint32 crc, const uchar* p, qint64 size)
+{
+    const Tables& t = tables();
+    quint64 c0 = crc;
+    // crc32指令延迟3个周期、吞吐1个周期，三路独立计算后用查表把前面的结果推进到后面合并
+    while (size >= 3 * kLaneSize) {
+        quint64 c1 = 0;
+        quint64 c2 = 0;
+        const uchar* p1 = p + kLaneSize;
+        const uchar* p2 = p + 2 * kLaneSize;
+        for (qint64 i = 0; i < kLaneSize; i += 8) {
+            c0 = _mm_crc32_u64(c0, load64(p + i));
+            c1 = _mm_crc32_u64(c1, load64(p1 + i));
+            c2 = _mm_crc32_u64(c2, load64(p2 + i));
+        }
+        quint32 merged = t.shiftLane(static_cast<quint32>(c0)) ^ static_cast<quint32>(c1);
+        c0 = t.shiftLane(merged) ^ static_cast<quint32>(c2);
+        p += 3 * kLaneSize;
+        size -= 3 * kLaneSize;
+    }
+    while (size >= 8) {
+        c0 = _mm_crc32_u64(c0, load64(p));
+        p += 8;
+        size -= 8;
+    }
+    quint32 c = static_cast<quint32>(c0);
+    while (size-- > 0) {
+        c = _mm_crc32_u8(c, *p++);
+    }
+    return c;
+}
+
+bool detectSse42()
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 20)) != 0;
+#else
+    return __builtin_cpu_supports("sse4.2");
+#endif
+}
+#endif
+
+} // namespace
+
+quint32 extend(quint32 crc, const char* data, qint64 size)
+{
+    const uchar* p = reinterpret_cast<const uchar*>(data);
+    crc = ~crc;
+#ifdef CRC32C_HAS_SSE42
+    static const bool hardware = detectSse42();
+    if (hardware) {
+        return ~extendHardware(crc, p, size);
+    }
+#endif
+    return ~extendSoftware(crc, p, size);
+}
+
+quint32 combine(quint32 crcA, quint32 crcB, qint64 lengthB)
+{
+    // 首尾取反在两次计算中互相抵消，与zlib的crc32_combine相同
+    return tables().appendZeros(crcA, lengthB) ^ crcB;
+}
+
+bool isHardwareAccelerated()
+{
+#ifdef CRC32C_HAS_SSE42
+    static const bool hardware = detectSse42();
+    return hardware;
+#else
+    return false;
+#endif
+}
+
+} // namespace Crc32c
+
+} // namespace clipboard
@@ -0,0 +1,26 @@
+#pragma once
+#include <QtGlobal>
+
+namespace clipboard {
+
+// CRC32C（Castagnoli）校验：x86-64上运行时检测SSE4.2，用crc32指令三路交错计算，
+// 其他平台退回按8字节查表（slicing-by-8）的软件实现
+namespace Crc32c {
+
+// 在crc的基础上继续计算data的校验值，crc为0时即data本身的校验值
+quint32 extend(quint32 crc, const char* data, qint64 size);
+
+inline quint32 compute(const char* data, qint64 size)
+{
+    return extend(0, data, size);
+}
+
+// 由crc(A)和crc(B)得到crc(A + B)，lengthB为B的长度，用于按顺序拼接各数据块的校验值
+quint32 combine(quint32 crcA, quint32 crcB, qint64 lengthB);
+
+// 是否使用硬件指令
+bool isHardwareAccelerated();
+
+} // namespace Crc32c
+
+} // namespace clipboard
@@ -0,0 +1,44 @@
+#pragma once
+#include <QByteArray>
+#include <memory>
+#include "ChunkBufferPool.h"
+
+namespace clipboard {
+
+// 数据块描述，生产者线程与消费者线程之间传递的单元
+// 数据要么在缓冲池借出的buffer中，要么在data中（自有数据或fromRawData视图）
+struct DataChunk
+{
+    QByteArray data;
+    // 来自缓冲池的缓冲区，数据块释放时自动归还
+    PooledBuffer buffer;
+    // data为fromRawData视图时，持有其底层存储（如内存映射窗口），保证消费完之前有效
+    std::shared_ptr<const void> owner;
+    // 所属文件在本次传输中的下标
+    int fileIndex = 0;
+    // 数据块在所属文件中的偏移
+    qint64 offset = 0;
+    // 数据被写入溢出文件时，队列中只保留其在溢出文件中的位置，读取前由SpillFile::load读回
+    qint64 spillOffset = -1;
+    qint64 spillSize = 0;
+    // 数据被ChunkCompressor压缩时为压缩前的大小，data中是qCompress的结果；未压缩时为-1
+    qint64 rawSize = -1;
+    // 入队时刻（TransferMetrics::now），用于统计在队列中停留的时间
+    qint64 enqueuedNs = 0;
+
+    bool isSpilled() const {
+        return spillOffset >= 0;
+    }
+    bool isCompressed() const {
+        return rawSize >= 0;
+    }
+
+    const char* constData() const {
+        return buffer ? buffer.constData() : data.constData();
+    }
+    qint64 size() const {
+        return buffer ? buffer.size() : data.size();
+    }
+};
+
+} // namespace clipboard
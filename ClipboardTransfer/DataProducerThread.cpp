@@ -0,0 +1,904 @@
+#include "DataProducerThread.h"
+#include <QDebug>
+#include <QDeadlineTimer>
+#include <QElapsedTimer>
+#include <QRunnable>
+#include "FileBufferManager.h"
+#include "WakeupTimer.h"
+
+namespace clipboard {
+
+class DataProducerThread::Task : public QRunnable
+{
+public:
+    explicit Task(DataProducerThread* producer)
+        : producer_(producer)
+    {
+    }
+
+    void run() override {
+        producer_->execute();
+    }
+
+private:
+    DataProducerThread* producer_;
+};
+
+DataProducerThread::DataProducerThread(FileBufferManager* manager, QObject* parent)
+    : QObject(parent)
+    , manager_(manager)
+    , threadPool_(nullptr)
+    , fileSize_(0)
+    , totalBytesGenerated_(0)
+    , shouldStop_(false)
+    , source_(nullptr)
+    , compressor_(nullptr)
+    , verifier_(nullptr)
+    , scheduler_(nullptr)
+    , priority_(TransferScheduler::DEFAULT_PRIORITY)
+    , schedulerTicket_(-1)
+    , sourceMode_(ChunkSource::Buffered)
+    , bufferPool_(nullptr)
+    , ioQueueDepth_(ChunkSource::DEFAULT_QUEUE_DEPTH)
+    , prefetchBudget_(0)
+    , rangeWorkers_(1)
+    , rangeSize_(ParallelRangeFetcher::DEFAULT_RANGE_SIZE)
+    , refillSource_(nullptr)
+    , refillFileIndex_(-1)
+    , pendingRanges_(0)
+    , running_(false)
+    , queuedTask_(nullptr)
+    , runPriority_(0)
+    , active_(false)
+    , parked_(false)
+    , resumeRequested_(false)
+    , started_(false)
+    , producing_(false)
+    , fileIndex_(0)
+    , fileOpen_(false)
+    , rangeActive_(false)
+    , rangeOpened_(false)
+    , rangeFinished_(false)
+    , rangeOk_(false)
+    , rangePosition_(0)
+    , completionPending_(false)
+    , readSize_(-1)
+    , paceDeadlineNs_(-1)
+    , paceTimerId_(-1)
+    , slotWaitStart_(-1)
+    , chunkFetched_(false)
+{
+    ownThreadPool_.setMaxThreadCount(1);
+    paceClock_.start();
+}
+
+void DataProducerThread::setParameters(const TransferFileList& files,
+                                       ChunkSource::Mode sourceMode, ChunkBufferPool* bufferPool,
+                                       const NetworkPeer& peer)
+{
+    files_ = files;
+    fileSize_ = 0;
+    for (const TransferFile& file : files_) {
+        fileSize_ += file.fileSize;
+    }
+    totalBytesGenerated_ = 0;
+    shouldStop_ = false;
+    resumeOffsets_.assign(files_.size(), 0);
+
+    // 清理之前的数据来源
+    if (source_) {
+        delete source_;
+        source_ = nullptr;
+    }
+    if (refillSource_) {
+        delete refillSource_;
+        refillSource_ = nullptr;
+    }
+
+    // 创建新的数据来源，并发读取的工作任务使用的数据来源在顺序生产开始时按同样的方式创建
+    sourceMode_ = sourceMode;
+    networkPeer_ = peer;
+    bufferPool_ = bufferPool;
+    source_ = ChunkSource::create(sourceMode, peer, ioQueueDepth_, prefetchBudgetPerSource());
+    source_->setBufferPool(bufferPool);
+    refillSource_ = ChunkSource::create(sourceMode, peer, ioQueueDepth_, prefetchBudgetPerSource());
+    refillSource_->setBufferPool(bufferPool);
+    refillFileIndex_ = -1;
+
+    QMutexLocker locker(&rangeMutex_);
+    rangeRequests_.clear();
+    pendingRanges_ = 0;
+    rangeStats_ = ParallelRangeFetcher::Statistics();
+}
+
+void DataProducerThread::setThreadPool(QThreadPool* pool)
+{
+    QMutexLocker locker(&rangeMutex_);
+    threadPool_ = pool;
+}
+
+QThreadPool* DataProducerThread::threadPool()
+{
+    return threadPool_ ? threadPool_ : &ownThreadPool_;
+}
+
+void DataProducerThread::start()
+{
+    // 提交之前登记，第一个时间片就按调度策略在线程池中排队
+    int priority = 0;
+    if (scheduler_) {
+        schedulerTicket_ = scheduler_->enroll(fileSize_, priority_);
+        priority = scheduler_->runPriority(schedulerTicket_);
+    }
+
+    QMutexLocker locker(&rangeMutex_);
+    active_ = true;
+    parked_ = false;
+    resumeRequested_ = false;
+    started_ = false;
+    producing_ = true;
+    fileIndex_ = 0;
+    fileOpen_ = false;
+    rangeActive_ = false;
+    completionPending_ = false;
+    outbox_.clear();
+    readSize_ = -1;
+    chunkFetched_ = false;
+    runPriority_ = priority;
+    submitLocked();
+}
+
+void DataProducerThread::submitLocked()
+{
+    running_ = true;
+    queuedTask_ = new Task(this);
+    threadPool()->start(queuedTask_, runPriority_);
+}
+
+void DataProducerThread::resume()
+{
+    QMutexLocker locker(&rangeMutex_);
+    if (parked_) {
+        parked_ = false;
+        submitLocked();
+    } else {
+        // 任务还在运行，它结束时据此重新提交而不是让出线程
+        resumeRequested_ = true;
+    }
+}
+
+bool DataProducerThread::wait(int msecs)
+{
+    QDeadlineTimer deadline(msecs < 0 ? QDeadlineTimer::Forever : QDeadlineTimer(msecs));
+    QMutexLocker locker(&rangeMutex_);
+    while (running_) {
+        if (!idle_.wait(&rangeMutex_, deadline)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool DataProducerThread::isRunning() const
+{
+    QMutexLocker locker(&rangeMutex_);
+    return running_;
+}
+
+void DataProducerThread::setIoQueueDepth(int depth, qint64 prefetchBudget)
+{
+    ioQueueDepth_ = depth;
+    prefetchBudget_ = qMax(prefetchBudget, (qint64)0);
+}
+
+qint64 DataProducerThread::prefetchBudgetPerSource() const
+{
+    // 顺序来源和补读来源各一份，并发读取时每个工作来源再各一份
+    const int sources = 2 + (rangeWorkers_ > 1 ? rangeWorkers_ : 0);
+    return prefetchBudget_ > 0 ? qMax(prefetchBudget_ / sources, (qint64)1) : 0;
+}
+
+void DataProducerThread::setPacingPolicy(const PacingPolicy& policy)
+{
+    pacer_.setPolicy(policy);
+}
+
+void DataProducerThread::setCompressor(ChunkCompressor* compressor)
+{
+    compressor_ = compressor;
+}
+
+void DataProducerThread::setVerifier(ChunkVerifier* verifier)
+{
+    verifier_ = verifier;
+}
+
+void DataProducerThread::setScheduler(TransferScheduler* scheduler, int priority)
+{
+    scheduler_ = scheduler;
+    priority_ = priority;
+}
+
+void DataProducerThread::setRangeWorkers(int workerCount, qint64 rangeSize)
+{
+    rangeWorkers_ = qMax(workerCount, 1);
+    rangeSize_ = qMax(rangeSize, (qint64)1);
+    // 没有共用线程池时工作任务和生产任务在自己的线程池中并发运行
+    ownThreadPool_.setMaxThreadCount(rangeWorkers_ > 1 ? rangeWorkers_ + 1 : 1);
+}
+
+void DataProducerThread::setCheckpointDirectory(const QString& directory)
+{
+    checkpointDirectory_ = directory;
+}
+
+void DataProducerThread::setResumeOffsets(const std::vector<qint64>& offsets)
+{
+    for (size_t index = 0; index < resumeOffsets_.size() && index < offsets.size(); ++index) {
+        resumeOffsets_[index] = qBound((qint64)0, offsets[index], files_.at(static_cast<int>(index)).fileSize);
+    }
+}
+
+ParallelRangeFetcher::Statistics DataProducerThread::rangeStatistics() const
+{
+    QMutexLocker locker(&rangeMutex_);
+    return rangeStats_;
+}
+
+qint64 DataProducerThread::targetBytesPerSecond() const
+{
+    return pacer_.targetBytesPerSecond();
+}
+
+double DataProducerThread::achievedBytesPerSecond() const
+{
+    return pacer_.achievedBytesPerSecond();
+}
+
+void DataProducerThread::stop()
+{
+    shouldStop_ = true;
+    // 网络来源可能正阻塞在等待应答上
+    if (source_) {
+        source_->interrupt();
+    }
+    if (refillSource_) {
+        refillSource_->interrupt();
+    }
+    QMutexLocker locker(&rangeMutex_);
+    active_ = false;
+    for (ChunkSource* source : workerSources_) {
+        source->interrupt();
+    }
+    // 等待背压的生产者没有在运行的任务，共用线程池已满时任务可能还在排队，直接取回；
+    // 这两种情况下在这里收尾，不必等到有空闲线程
+    bool idle = parked_;
+    parked_ = false;
+    if (queuedTask_ && threadPool()->tryTake(queuedTask_)) {
+        delete queuedTask_;
+        queuedTask_ = nullptr;
+        idle = true;
+    }
+    if (idle) {
+        locker.unlock();
+        discardProduction();
+        locker.relock();
+        finishTaskLocked();
+    }
+}
+
+void DataProducerThread::requestRange(int fileIndex, qint64 offset, qint64 length)
+{
+    if (fileIndex < 0 || fileIndex >= files_.size() || length <= 0) {
+        return;
+    }
+    RangeRequest request = { fileIndex, offset, length };
+    QMutexLocker locker(&rangeMutex_);
+    rangeRequests_.enqueue(request);
+    pendingRanges_.fetch_add(1);
+    // 生产任务在运行时会在数据块之间处理，让出了线程时叫醒它，否则提交一个补读任务
+    if (active_ && !running_) {
+        submitLocked();
+    } else if (parked_) {
+        parked_ = false;
+        submitLocked();
+    }
+}
+
+DataProducerThread::~DataProducerThread()
+{
+    // 任务持有this，必须等它结束
+    stop();
+    wait();
+
+    // 清理数据来源
+    if (source_) {
+        delete source_;
+        source_ = nullptr;
+    }
+    if (refillSource_) {
+        delete refillSource_;
+        refillSource_ = nullptr;
+    }
+}
+
+void DataProducerThread::execute()
+{
+    {
+        QMutexLocker locker(&rangeMutex_);
+        queuedTask_ = nullptr;
+        resumeRequested_ = false;
+    }
+
+    // 每次最多运行一个时间片，之后按调度器给出的优先级重新排入线程池队列，会话多于线程时按调度策略轮流生产
+    QElapsedTimer slice;
+    slice.start();
+    Step step = Continue;
+    while (step == Continue && slice.elapsed() < TIME_SLICE_MS) {
+        step = produceStep();
+    }
+
+    if (step == Idle && compressor_) {
+        // 压缩层的回调持有它自己的锁调用resume，不能在持有rangeMutex_时取消
+        compressor_->cancelNotify();
+    }
+    // 调度器和并发读取的锁都不能在持有rangeMutex_时获取
+    const int priority = scheduler_ ? scheduler_->runPriority(schedulerTicket_) : 0;
+    if (fetcher_) {
+        fetcher_->setRunPriority(priority);
+    }
+
+    QMutexLocker locker(&rangeMutex_);
+    runPriority_ = priority;
+    if (step == Continue || (step == Park && (resumeRequested_ || shouldStop_))) {
+        submitLocked();
+        return;
+    }
+    if (step == Park) {
+        // 让出线程，等待的条件满足后由resume重新提交
+        parked_ = true;
+        return;
+    }
+    // 检查队列为空与结束任务在同一次加锁中，之间到达的补读请求不会丢失
+    if (!shouldStop_ && !rangeRequests_.isEmpty()) {
+        submitLocked();
+        return;
+    }
+    finishTaskLocked();
+}
+
+void DataProducerThread::finishTaskLocked()
+{
+    // 之后的补读任务重新打开文件
+    if (refillSource_) {
+        refillSource_->close();
+    }
+    refillFileIndex_ = -1;
+    running_ = false;
+    idle_.wakeAll();
+}
+
+DataProducerThread::Step DataProducerThread::produceStep()
+{
+    if (shouldStop_) {
+        discardProduction();
+        return Idle;
+    }
+
+    // 先交出上一步留下的和压缩完的数据块，缓冲区超过高水位时让出线程
+    collectCompressed();
+    while (!outbox_.empty()) {
+        if (!manager_->tryEnqueueChunk(outbox_.front())) {
+            cancelSlotWait();
+            return Park;
+        }
+        outbox_.pop_front();
+    }
+    // 数据块全部入队之后再通知补读区间和顺序生产结束，消费者看到通知时数据已在队列中，
+    // 有压缩层时先等它压缩完剩余的数据块
+    if (((rangeActive_ && rangeFinished_) || completionPending_) && compressor_ && !compressor_->isEmpty()) {
+        return waitForCompressor() ? Park : Continue;
+    }
+    if (rangeActive_ && rangeFinished_) {
+        rangeActive_ = false;
+        pendingRanges_.fetch_sub(1);
+        manager_->onRangeProduced(rangeOk_);
+    }
+    if (completionPending_) {
+        completionPending_ = false;
+        manager_->onTransferComplete();
+    }
+
+    // 在途的压缩任务达到上限时等最早的压缩完再读取
+    if (compressor_ && compressor_->isFull()) {
+        cancelSlotWait();
+        return waitForCompressor() ? Park : Continue;
+    }
+
+    // 补读请求优先于预读，读取方正在等待这些数据；已扣除额度的顺序读取先完成
+    if (rangeActive_ || (readSize_ < 0 && !chunkFetched_ && takeRangeRequest())) {
+        return produceRangeStep();
+    }
+    if (producing_) {
+        return produceFileStep();
+    }
+    return Idle;
+}
+
+void DataProducerThread::discardProduction()
+{
+    if (fileOpen_) {
+        closeFile();
+    }
+    if (producing_ && started_) {
+        finishProduction(false);
+    }
+    // 第一步之前就停止时还没有经过finishProduction退出调度
+    if (scheduler_ && schedulerTicket_ >= 0) {
+        scheduler_->withdraw(schedulerTicket_);
+        schedulerTicket_ = -1;
+    }
+    producing_ = false;
+    completionPending_ = false;
+    // 未入队的数据块直接丢弃，正在处理的补读区间按失败通知
+    outbox_.clear();
+    cancelPacing();
+    cancelSlotWait();
+    if (compressor_) {
+        compressor_->cancelNotify();
+    }
+    readSize_ = -1;
+    fetchedChunk_ = DataChunk();
+    chunkFetched_ = false;
+    if (rangeActive_) {
+        rangeActive_ = false;
+        pendingRanges_.fetch_sub(1);
+        manager_->onRangeProduced(false);
+    }
+}
+
+void DataProducerThread::beginProduction()
+{
+    qDebug() << "DataProducerThread started, files:" << files_.size() << "total size:" << fileSize_;
+    started_ = true;
+    pacer_.reset();
+    createWorkerSources();
+}
+
+void DataProducerThread::finishProduction(bool completed)
+{
+    producing_ = false;
+    pacer_.finish();
+    qDebug() << "producer rate:" << pacer_.achievedBytesPerSecond() / (1024 * 1024) << "MB/s"
+             << ", target:" << pacer_.targetBytesPerSecond() / (1024 * 1024) << "MB/s";
+
+    destroyWorkerSources();
+    if (scheduler_) {
+        scheduler_->withdraw(schedulerTicket_);
+        schedulerTicket_ = -1;
+    }
+    if (completed) {
+        qDebug() << "DataProducerThread finished, total read:" << totalBytesGenerated_;
+        // 剩余数据块入队之后再通知
+        completionPending_ = true;
+    } else {
+        qDebug() << "DataProducerThread stopped early, total read:" << totalBytesGenerated_;
+    }
+}
+
+DataProducerThread::Step DataProducerThread::produceFileStep()
+{
+    if (!source_) {
+        qDebug() << "error: source is null!";
+        producing_ = false;
+        return Continue;
+    }
+    if (!started_) {
+        beginProduction();
+    }
+    // 逐个文件生产，受背压限制的预读会自然地与前一个文件的消费重叠
+    if (fileIndex_ >= files_.size()) {
+        finishProduction(true);
+        return Continue;
+    }
+    if (!fileOpen_ && !openFile(fileIndex_)) {
+        closeFile();
+        finishProduction(false);
+        return Continue;
+    }
+
+    const TransferFile& file = files_.at(fileIndex_);
+    ReadResult result = ChunkRead;
+    if (progress_.bytes < file.fileSize) {
+        result = fetcher_ ? fetchNextChunk() : readNextChunk();
+        if (result == ReadWait) {
+            // 等待期间压缩完的数据块也叫醒生产任务，及时入队
+            if (compressor_) {
+                waitForCompressor();
+            }
+            return Park;
+        }
+    }
+    if (shouldStop_) {
+        // 下一步丢弃
+        return Continue;
+    }
+    if (result == ReadFailed || progress_.bytes >= file.fileSize) {
+        closeFile();
+        if (result == ReadFailed) {
+            finishProduction(false);
+            return Continue;
+        }
+        ++fileIndex_;
+    }
+    return Continue;
+}
+
+bool DataProducerThread::openFile(int index)
+{
+    const TransferFile& file = files_.at(index);
+    fileOpen_ = true;
+    progress_.index = index;
+    // 断点之前的数据接收方已有，源文件从断点继续读取
+    progress_.bytes = resumeOffsets_[index];
+    if (progress_.bytes > 0) {
+        qDebug() << "resume file" << index << "at" << progress_.bytes;
+    }
+
+    // 检查点从断点继续记录，另一个会话正在使用同一个检查点时本次不记录；
+    // 记录由校验线程写入，与端到端校验共用每个数据块的CRC
+    progress_.checkpointed = false;
+    if (!checkpointDirectory_.isEmpty() && verifier_) {
+        std::unique_ptr<TransferCheckpoint> checkpoint(new TransferCheckpoint());
+        if (!checkpoint->open(checkpointDirectory_, file)) {
+            qWarning() << "open checkpoint failed, resume disabled:" << checkpoint->errorString();
+        } else if (!checkpoint->resumeAt(progress_.bytes)) {
+            qWarning() << "checkpoint disabled:" << checkpoint->errorString();
+            checkpoint->close();
+        } else {
+            verifier_->attachCheckpoint(index, std::move(checkpoint));
+            progress_.checkpointed = true;
+        }
+    }
+    if (progress_.bytes >= file.fileSize) {
+        return true;
+    }
+
+    // 大于一个区间的文件由多个工作任务分区间读取，按偏移顺序入队
+    if (!workerSources_.empty() && file.fileSize - progress_.bytes > rangeSize_) {
+        fetcher_.reset(new ParallelRangeFetcher(manager_, workerSources_, rangeSize_, shouldStop_));
+        fetcher_->setScheduler(scheduler_, schedulerTicket_);
+        fetcher_->setThreadPool(threadPool());
+        fetcher_->setWakeup([this]() { resume(); });
+        fetcher_->setRunPriority(scheduler_ ? scheduler_->runPriority(schedulerTicket_) : 0);
+        fetcher_->start(file.filePath, file.fileSize, progress_.bytes);
+        return true;
+    }
+
+    // 打开文件
+    if (!source_->open(file.filePath)) {
+        qDebug() << "error: can't open file " << file.filePath << ":" << source_->errorString();
+        return false;
+    }
+    if (progress_.bytes > 0 && !source_->seek(progress_.bytes)) {
+        qDebug() << "error: can't seek to resume offset" << progress_.bytes << ":" << source_->errorString();
+        return false;
+    }
+    return true;
+}
+
+void DataProducerThread::closeFile()
+{
+    fileOpen_ = false;
+    if (fetcher_) {
+        fetchedChunk_ = DataChunk();
+        chunkFetched_ = false;
+        fetcher_->finish();
+        ParallelRangeFetcher::Statistics stats = fetcher_->statistics();
+        fetcher_.reset();
+        QMutexLocker locker(&rangeMutex_);
+        rangeStats_.ranges += stats.ranges;
+        rangeStats_.outOfOrderChunks += stats.outOfOrderChunks;
+        rangeStats_.peakReassemblyBytes = qMax(rangeStats_.peakReassemblyBytes, stats.peakReassemblyBytes);
+    } else {
+        // 内存映射窗口在引用它的数据块都被读取后才解除映射
+        source_->close();
+    }
+
+    // 排在该文件所有数据块之后关闭
+    if (progress_.checkpointed) {
+        verifier_->closeCheckpoint(progress_.index);
+        progress_.checkpointed = false;
+    }
+}
+
+DataProducerThread::ReadResult DataProducerThread::readNextChunk()
+{
+    const TransferFile& file = files_.at(progress_.index);
+    TransferMetrics& metrics = manager_->metrics();
+
+    // 确定本次读取的大小，由FileBufferManager根据消费者的读取情况自适应调整；
+    // 等待额度或时隙期间保持不变，扣除的额度与读取的字节数一致
+    if (readSize_ < 0) {
+        readSize_ = qMin(manager_->nextChunkSize(), file.fileSize - progress_.bytes);
+    }
+
+    // 按节流策略等待发送额度，再按调度策略等待I/O时隙，读完即归还，等待背压时不占用
+    if (!pace(readSize_) || !acquireSlot()) {
+        return ReadWait;
+    }
+    const qint64 chunkSize = readSize_;
+    readSize_ = -1;
+
+    // 从文件读取数据
+    DataChunk chunk;
+    const qint64 readStart = metrics.now();
+    const bool read = source_->readChunk(chunkSize, chunk);
+    releaseSlot(read ? chunk.size() : 0);
+    if (!read) {
+        if (source_->atEnd()) {
+            qDebug() << "file end, but size wrong!" << file.filePath;
+        } else {
+            qDebug() << "read file failed:" << source_->errorString();
+        }
+        return ReadFailed;
+    }
+    metrics.record(TransferMetrics::SourceRead, metrics.now() - readStart, chunk.size());
+
+    emitFileChunk(std::move(chunk));
+    return ChunkRead;
+}
+
+DataProducerThread::ReadResult DataProducerThread::fetchNextChunk()
+{
+    // 连续前缀增长时由工作任务resume，数据块在这里恢复偏移顺序
+    if (!chunkFetched_) {
+        const ParallelRangeFetcher::TakeResult taken = fetcher_->takeNext(fetchedChunk_);
+        if (taken == ParallelRangeFetcher::Pending) {
+            return ReadWait;
+        }
+        if (taken == ParallelRangeFetcher::Finished) {
+            if (!shouldStop_) {
+                qDebug() << "parallel read failed:" << fetcher_->errorString();
+            }
+            return ReadFailed;
+        }
+        chunkFetched_ = true;
+    }
+    if (!pace(fetchedChunk_.size())) {
+        return ReadWait;
+    }
+    chunkFetched_ = false;
+
+    emitFileChunk(std::move(fetchedChunk_));
+    fetchedChunk_ = DataChunk();
+    return ChunkRead;
+}
+
+void DataProducerThread::emitFileChunk(DataChunk&& chunk)
+{
+    const qint64 chunkBytes = chunk.size();
+    chunk.fileIndex = progress_.index;
+    chunk.offset = progress_.bytes;
+    progress_.bytes += chunkBytes;
+    totalBytesGenerated_ += chunkBytes;
+
+    // 校验线程计算CRC后同时记入检查点
+    submitSource(chunk, true);
+    emitChunk(std::move(chunk));
+}
+
+bool DataProducerThread::takeRangeRequest()
+{
+    QMutexLocker locker(&rangeMutex_);
+    if (rangeRequests_.isEmpty()) {
+        return false;
+    }
+    range_ = rangeRequests_.dequeue();
+    rangeActive_ = true;
+    rangeOpened_ = false;
+    rangeFinished_ = false;
+    rangeOk_ = false;
+    rangePosition_ = range_.offset;
+    return true;
+}
+
+DataProducerThread::Step DataProducerThread::produceRangeStep()
+{
+    if (rangeFinished_) {
+        // 区间已读完，等待剩余数据块入队
+        return Continue;
+    }
+    if (!rangeOpened_) {
+        rangeOpened_ = true;
+        if (!openRange()) {
+            finishRange(false);
+            return Continue;
+        }
+    }
+
+    const TransferFile& file = files_.at(range_.fileIndex);
+    const qint64 end = qMin(range_.offset + range_.length, file.fileSize);
+    if (rangePosition_ < end) {
+        if (readSize_ < 0) {
+            readSize_ = qMin(manager_->nextChunkSize(), end - rangePosition_);
+        }
+        if (!pace(readSize_)) {
+            if (compressor_) {
+                waitForCompressor();
+            }
+            return Park;
+        }
+        const qint64 chunkSize = readSize_;
+        readSize_ = -1;
+
+        DataChunk chunk;
+        TransferMetrics& metrics = manager_->metrics();
+        const qint64 readStart = metrics.now();
+        if (!refillSource_->readChunk(chunkSize, chunk)) {
+            qDebug() << "refill read failed:" << refillSource_->errorString();
+            finishRange(false);
+            return Continue;
+        }
+        metrics.record(TransferMetrics::SourceRead, metrics.now() - readStart, chunk.size());
+        chunk.fileIndex = range_.fileIndex;
+        chunk.offset = rangePosition_;
+        rangePosition_ += chunk.size();
+        submitSource(chunk, false);
+        emitChunk(std::move(chunk));
+    }
+    if (rangePosition_ >= end) {
+        qDebug() << "refill file:" << range_.fileIndex << "range:" << range_.offset << "-" << rangePosition_;
+        finishRange(true);
+    }
+    return Continue;
+}
+
+bool DataProducerThread::openRange()
+{
+    const TransferFile& file = files_.at(range_.fileIndex);
+    if (refillFileIndex_ != range_.fileIndex) {
+        refillSource_->close();
+        refillFileIndex_ = -1;
+        if (!refillSource_->open(file.filePath)) {
+            qDebug() << "error: can't open file for refill" << file.filePath << ":" << refillSource_->errorString();
+            return false;
+        }
+        refillFileIndex_ = range_.fileIndex;
+    }
+    if (!refillSource_->seekRange(range_.offset, range_.length)) {
+        qDebug() << "refill seek failed:" << range_.offset << refillSource_->errorString();
+        return false;
+    }
+    return true;
+}
+
+void DataProducerThread::finishRange(bool ok)
+{
+    // 补读计数减少之前数据块须已入队，由produceStep在outbox_和压缩层清空后通知
+    readSize_ = -1;
+    rangeFinished_ = true;
+    rangeOk_ = ok;
+}
+
+void DataProducerThread::emitChunk(DataChunk&& chunk)
+{
+    if (!compressor_) {
+        outbox_.push_back(std::move(chunk));
+        return;
+    }
+    // 在途数据块的上限由produceStep在读取前检查
+    compressor_->submit(std::move(chunk));
+    collectCompressed();
+}
+
+void DataProducerThread::collectCompressed()
+{
+    if (!compressor_) {
+        return;
+    }
+    DataChunk done;
+    while (compressor_->takeNext(done)) {
+        outbox_.push_back(std::move(done));
+    }
+}
+
+bool DataProducerThread::waitForCompressor()
+{
+    return compressor_->notifyWhenReady([this]() { resume(); });
+}
+
+bool DataProducerThread::pace(qint64 bytes)
+{
+    if (paceDeadlineNs_ < 0) {
+        const qint64 delayNs = pacer_.reserve(bytes);
+        if (delayNs <= 0) {
+            return true;
+        }
+        paceDeadlineNs_ = paceClock_.nsecsElapsed() + delayNs;
+    }
+    const qint64 remainingNs = paceDeadlineNs_ - paceClock_.nsecsElapsed();
+    if (remainingNs <= 0) {
+        cancelPacing();
+        return true;
+    }
+    // 提前被其他条件叫醒时按剩余时间重新登记，已到期的回调取消时什么也不做
+    if (paceTimerId_ >= 0) {
+        WakeupTimer::instance()->cancel(paceTimerId_);
+    }
+    paceTimerId_ = WakeupTimer::instance()->schedule(remainingNs, [this]() { resume(); });
+    return false;
+}
+
+void DataProducerThread::cancelPacing()
+{
+    if (paceTimerId_ >= 0) {
+        WakeupTimer::instance()->cancel(paceTimerId_);
+        paceTimerId_ = -1;
+    }
+    paceDeadlineNs_ = -1;
+}
+
+void DataProducerThread::createWorkerSources()
+{
+    QMutexLocker locker(&rangeMutex_);
+    if (rangeWorkers_ <= 1) {
+        return;
+    }
+    for (int i = 0; i < rangeWorkers_; ++i) {
+        ChunkSource* source = ChunkSource::create(sourceMode_, networkPeer_, ioQueueDepth_, prefetchBudgetPerSource());
+        source->setBufferPool(bufferPool_);
+        workerSources_.push_back(source);
+    }
+}
+
+void DataProducerThread::destroyWorkerSources()
+{
+    QMutexLocker locker(&rangeMutex_);
+    for (ChunkSource* source : workerSources_) {
+        delete source;
+    }
+    workerSources_.clear();
+}
+
+bool DataProducerThread::acquireSlot()
+{
+    if (!scheduler_) {
+        return true;
+    }
+    TransferMetrics& metrics = manager_->metrics();
+    if (slotWaitStart_ < 0) {
+        slotWaitStart_ = metrics.now();
+    }
+    if (!scheduler_->tryAcquire(schedulerTicket_, this, [this]() { resume(); })) {
+        return false;
+    }
+    metrics.record(TransferMetrics::SchedulerWait, metrics.now() - slotWaitStart_);
+    slotWaitStart_ = -1;
+    return true;
+}
+
+void DataProducerThread::cancelSlotWait()
+{
+    if (scheduler_ && slotWaitStart_ >= 0) {
+        scheduler_->cancelWait(schedulerTicket_, this);
+        slotWaitStart_ = -1;
+    }
+}
+
+void DataProducerThread::releaseSlot(qint64 bytes)
+{
+    if (scheduler_) {
+        scheduler_->release(schedulerTicket_, bytes);
+    }
+}
+
+void DataProducerThread::submitSource(DataChunk& chunk, bool sequential)
+{
+    // 在压缩之前提交，校验的是readData一侧解压后还原出的原始数据；CRC由校验线程计算
+    if (verifier_) {
+        verifier_->submitSource(chunk, sequential);
+    }
+}
+
+} // namespace clipboard
@@ -1,37 +1,268 @@
 #ifndef DATAPRODUCERTHREAD_H
 #define DATAPRODUCERTHREAD_H
 
-#include <QThread>
-#include <QFile>
+#include <QElapsedTimer>
+#include <QObject>
+#include <QThreadPool>
+#include <QMutex>
+#include <QQueue>
+#include <QWaitCondition>
+#include <atomic>
+#include "Pacer.h"
+#include "ChunkSource.h"
+#include "ChunkCompressor.h"
+#include "ChunkVerifier.h"
+#include "ParallelRangeFetcher.h"
+#include "TransferCheckpoint.h"
+#include "TransferScheduler.h"
+#include "TransferFile.h"
+#include <deque>
+#include <memory>
+#include <vector>
 
 namespace clipboard {
 
-// 工作线程类，用于生产数据
-class DataProducerThread : public QThread
+class FileBufferManager;
+
+// 生产者，为一个传输会话读取数据并送入manager的队列。生产按数据块分步进行，作为任务在线程池中运行：
+// 每个任务最多运行一个时间片后重新排队。需要等待时任务不阻塞线程，而是直接返回、让出线程，
+// 由等待的对象调用resume重新提交：缓冲区超过高水位时由消费者腾出空间后，等待节流额度时由WakeupTimer到期后，
+// 等待I/O时隙时由调度器，等待压缩层或并发读取的数据块时由它们在数据块就绪后。
+// 多个会话共用一个有上限的线程池时，会话数多于线程数也都能推进
+class DataProducerThread : public QObject
 {
     Q_OBJECT
 public:
-    explicit DataProducerThread(QObject* parent = nullptr);
+    explicit DataProducerThread(FileBufferManager* manager, QObject* parent = nullptr);
     ~DataProducerThread();
-    void setParameters(const QString& filePath, const QString& fileName, qint64 fileSize);
+    // 运行生产任务的线程池，为空时使用自己的单线程池；须在start前调用
+    void setThreadPool(QThreadPool* pool);
+    // 在调度器中登记本次传输，把生产任务提交到线程池
+    void start();
+    // 生产任务等待的条件满足后调用（消费者腾出缓冲空间、节流到期、得到时隙、数据块就绪），
+    // 重新提交让出线程的生产任务；多余的调用只多运行一步。线程安全
+    void resume();
+    // 等待生产任务和补读任务结束，msecs为-1时一直等待，超时返回false
+    bool wait(int msecs = -1);
+    bool isRunning() const;
+    // 按顺序生产files中的每个文件，前一个文件还在被消费时即开始预读下一个文件
+    void setParameters(const TransferFileList& files,
+                       ChunkSource::Mode sourceMode = ChunkSource::Buffered,
+                       ChunkBufferPool* bufferPool = nullptr,
+                       const NetworkPeer& peer = NetworkPeer());
+    // IoUring模式下每个数据来源同时在途的读请求数，以及本生产者所有数据来源的预读缓冲区合计不超过的字节数
+    // （0为不限），由顺序来源、补读来源和并发读取的工作来源平分；须在setRangeWorkers之后、setParameters之前调用
+    void setIoQueueDepth(int depth, qint64 prefetchBudget = 0);
+    // 设置节流策略，须在线程启动前调用
+    void setPacingPolicy(const PacingPolicy& policy);
+    // 设置后数据块经压缩层压缩后再入队，为空时直接入队；须在线程启动前调用
+    void setCompressor(ChunkCompressor* compressor);
+    // 设置后每个数据块在压缩之前交给verifier，由校验线程计算CRC32C和源文件摘要；
+    // 为空时不校验。须在线程启动前调用
+    void setVerifier(ChunkVerifier* verifier);
+    // workerCount大于1时，大于一个区间的文件由workerCount个工作任务按rangeSize分区间并发读取，
+    // 再按偏移顺序入队；工作任务与生产任务在同一个线程池中运行。须在线程启动前调用
+    void setRangeWorkers(int workerCount, qint64 rangeSize);
+    // directory不为空时为每个文件在其中保存检查点，同一个源文件再次传输时从检查点续传；
+    // 检查点打开后交给setVerifier设置的校验线程写入，因此须同时设置verifier。须在线程启动前调用
+    void setCheckpointDirectory(const QString& directory);
+    // 第i个文件从offsets[i]开始读取，之前的部分接收方已从检查点续传；须在setParameters之后、start之前调用
+    void setResumeOffsets(const std::vector<qint64>& offsets);
+    // 设置后每次从数据来源读取数据块前向scheduler申请I/O时隙，priority为本次传输的优先级；
+    // 为空时不经过调度。补读不申请时隙。须在start前调用
+    void setScheduler(TransferScheduler* scheduler, int priority);
+    // 本次传输中并发读取的区间与重组情况，各文件累计
+    ParallelRangeFetcher::Statistics rangeStatistics() const;
     void stop();
 
-protected:
-    void run() override;
+    // 请求重新读取第fileIndex个文件的[offset, offset + length)，用于补齐缓存中被淘汰的区间
+    // 线程安全，生产者在顺序生产的数据块之间处理这些请求；顺序生产结束后任务已退出，
+    // 此时重新提交一个只处理补读的任务，不在等待中占用线程池的线程
+    void requestRange(int fileIndex, qint64 offset, qint64 length);
+    // 已请求但尚未全部入队的补读区间个数
+    int pendingRanges() const {
+        return pendingRanges_.load();
+    }
+
+    // 目标速率与实际达到的速率（字节/秒）
+    qint64 targetBytesPerSecond() const;
+    double achievedBytesPerSecond() const;
 
 signals:
 //    void dataChunkGenerated(const QByteArray& chunk);
 //    void transferComplete();
 
 private:
-    QString filePath_;
-    QString fileName_;
+    class Task;
+
+    enum Step {
+        Continue,   // 还有数据要生产
+        Park,       // 缓冲区已满或在等待节流额度、时隙、数据块，等待resume
+        Idle        // 顺序生产和补读都已结束，或传输已停止
+    };
+
+    // 读取一个数据块的结果
+    enum ReadResult {
+        ChunkRead,  // 读到了数据块
+        ReadWait,   // 在等待节流额度、时隙或并发读取的数据块，已登记resume
+        ReadFailed  // 出错或已停止
+    };
+
+    // 线程池中执行的任务：运行produceStep直到时间片用完、缓冲区已满或没有工作
+    void execute();
+    // 处理一步：先把上一步留下的数据块和压缩完的数据块入队，再读取一个补读或顺序生产的数据块
+    Step produceStep();
+    // 传输停止时关闭文件、退出调度并丢弃未入队的数据块，没有任务在运行时调用
+    void discardProduction();
+    QThreadPool* threadPool();
+    // 提交任务，调用时须持有rangeMutex_
+    void submitLocked();
+    // 任务结束，通知wait；调用时须持有rangeMutex_
+    void finishTaskLocked();
+
+    struct RangeRequest
+    {
+        int fileIndex;
+        qint64 offset;
+        qint64 length;
+    };
+
+    // 正在生产的文件：已生产的字节数，以及是否已把检查点交给校验线程
+    struct FileProgress
+    {
+        int index = 0;
+        qint64 bytes = 0;
+        bool checkpointed = false;
+    };
+
+    // 顺序生产开始与结束：节流计时、工作任务的数据来源和调度器登记
+    void beginProduction();
+    // completed为true时在剩余数据块入队后通知manager生产已完成
+    void finishProduction(bool completed);
+    // 顺序生产当前文件的一个数据块，文件结束时转到下一个文件
+    Step produceFileStep();
+    // 打开第index个文件，从续传位置开始读取；大于一个区间的文件由多个工作任务分区间读取
+    bool openFile(int index);
+    void closeFile();
+    // 由数据来源读取下一个数据块
+    ReadResult readNextChunk();
+    // 从并发读取的工作任务按偏移顺序取下一个数据块
+    ReadResult fetchNextChunk();
+    // 文件的下一个数据块交出，有检查点时同时记入日志
+    void emitFileChunk(DataChunk&& chunk);
+    // 数据块放入outbox_，有压缩层时先提交压缩，并交出已按顺序压缩完的数据块
+    void emitChunk(DataChunk&& chunk);
+    // 把压缩层中已按顺序压缩完的数据块移到outbox_，不等待
+    void collectCompressed();
+    // 压缩层中还有未压缩完的数据块时登记就绪回调并返回true
+    bool waitForCompressor();
+    // 按节流策略扣除bytes的额度；额度不足时登记到期回调并返回false，到期后再次调用返回true
+    bool pace(qint64 bytes);
+    // 放弃等待中的节流到期回调
+    void cancelPacing();
+    // 按调度策略申请I/O时隙，没有调度器时立即返回true；没有轮到时登记等待并返回false，由调度器resume
+    bool acquireSlot();
+    // 放弃登记中的时隙等待，生产任务因其他原因让出线程时调用，不占着按策略留给它的时隙
+    void cancelSlotWait();
+    // 归还时隙，bytes为这次读取的字节数
+    void releaseSlot(qint64 bytes);
+    // 有校验层时把数据块交给校验线程计算期望值，sequential表示它参与源文件摘要
+    void submitSource(DataChunk& chunk, bool sequential);
+    void createWorkerSources();
+    // 每个数据来源分到的预读缓冲区字节数，0为不限
+    qint64 prefetchBudgetPerSource() const;
+    void destroyWorkerSources();
+    // 取出下一个补读请求，没有时返回false
+    bool takeRangeRequest();
+    // 读取当前补读区间的一个数据块
+    Step produceRangeStep();
+    bool openRange();
+    // 区间读取结束，数据块全部入队后再减少补读计数
+    void finishRange(bool ok);
+
+    FileBufferManager* manager_;
+    QThreadPool* threadPool_;
+    QThreadPool ownThreadPool_;
+    TransferFileList files_;
     qint64 fileSize_;
     qint64 totalBytesGenerated_;
-    bool shouldStop_;
-    QFile* file_;
-    static const int CHUNK_SIZE = 512 * 1024; // 512KB chunks
-    static const int SLEEP_INTERVAL = 20; // 10ms intervals
+    std::atomic<bool> shouldStop_;
+    ChunkSource* source_;
+    Pacer pacer_;
+    // 压缩层由FileBufferManager持有
+    ChunkCompressor* compressor_;
+    // 校验层由FileBufferManager持有
+    ChunkVerifier* verifier_;
+    // 调度器由TransferSessionManager持有，schedulerTicket_为本次生产在调度器中的编号
+    TransferScheduler* scheduler_;
+    int priority_;
+    int schedulerTicket_;
+
+    // 并发读取区间的工作任务各自使用一个数据来源，在顺序生产开始和结束时创建和销毁，受rangeMutex_保护
+    ChunkSource::Mode sourceMode_;
+    NetworkPeer networkPeer_;
+    ChunkBufferPool* bufferPool_;
+    int ioQueueDepth_;
+    qint64 prefetchBudget_;
+    int rangeWorkers_;
+    qint64 rangeSize_;
+    std::vector<ChunkSource*> workerSources_;
+    ParallelRangeFetcher::Statistics rangeStats_;
+    // 检查点目录为空时不保存检查点
+    QString checkpointDirectory_;
+    // 每个文件的续传位置，由setParameters清零
+    std::vector<qint64> resumeOffsets_;
+
+    // 补读使用独立的数据来源，不打断顺序读取的位置
+    ChunkSource* refillSource_;
+    int refillFileIndex_;
+    mutable QMutex rangeMutex_;
+    QQueue<RangeRequest> rangeRequests_;
+    std::atomic<int> pendingRanges_;
+    // 有任务已提交或正在运行，受rangeMutex_保护；任务结束时通过idle_通知wait
+    bool running_;
+    // 已提交但线程池还未开始执行的任务，停止时从队列中取回，不必等到有空闲线程
+    QRunnable* queuedTask_;
+    // 提交任务时在线程池队列中的优先级，由调度器按策略给出，每个时间片结束时更新，受rangeMutex_保护
+    int runPriority_;
+    // start之后、stop之前为true，受rangeMutex_保护，期间的补读请求可以重新提交任务
+    bool active_;
+    // 任务因背压返回、等待resume，受rangeMutex_保护；此时running_仍为true
+    bool parked_;
+    // 任务运行期间收到resume，受rangeMutex_保护
+    bool resumeRequested_;
+    QWaitCondition idle_;
+
+    // 以下为跨任务保存的生产进度，同一时刻只有一个任务访问
+    bool started_;
+    bool producing_;
+    int fileIndex_;
+    bool fileOpen_;
+    FileProgress progress_;
+    std::unique_ptr<ParallelRangeFetcher> fetcher_;
+    bool rangeActive_;
+    RangeRequest range_;
+    bool rangeOpened_;
+    bool rangeFinished_;
+    bool rangeOk_;
+    qint64 rangePosition_;
+    bool completionPending_;
+    // 已生产但缓冲区已满、尚未入队的数据块，下一步先入队
+    std::deque<DataChunk> outbox_;
+    // 已扣除节流额度、还在等待额度或时隙的读取大小，没有时为-1；等待期间不切换到补读
+    qint64 readSize_;
+    // 节流额度到期的时间（paceClock_的纳秒数）和登记的到期回调，没有在等待时为-1
+    QElapsedTimer paceClock_;
+    qint64 paceDeadlineNs_;
+    int paceTimerId_;
+    // 开始等待I/O时隙的时间，没有在等待时为-1
+    qint64 slotWaitStart_;
+    // 从并发读取取出、还在等待节流额度的数据块
+    DataChunk fetchedChunk_;
+    bool chunkFetched_;
+
+    // 一个任务最多连续运行的时间（毫秒）
+    static const int TIME_SLICE_MS = 10;
 };
 }
 #endif // DATAPRODUCERTHREAD_H
@@ -1,40 +1,63 @@
 
 #include "FileBufferManager.h"
 #include "DataProducerThread.h"
-#include "VirtualFileSrcStream.h"
 #include <QDebug>
 #include <QtGlobal>
 #include <QWaitCondition>
 #include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QDir>
+#include <climits>
 
 namespace clipboard {
 
-// 静态成员初始化
-FileBufferManager* FileBufferManager::instance_ = nullptr;
-
-FileBufferManager* FileBufferManager::instance()
-{
-    if (!instance_) {
-        instance_ = new FileBufferManager();
-    }
-    return instance_;
-}
-
-void FileBufferManager::destroyInstance()
-{
-    if (instance_) {
-        delete instance_;
-        instance_ = nullptr;
-    }
-}
-
 FileBufferManager::FileBufferManager(QObject *parent)
     : QObject(parent)
+    , dataQueue_(MAX_QUEUE_SIZE)
     , fileSize_(0)
     , totalBytesRead_(0)
+    , refillFileIndex_(-1)
+    , refillBegin_(0)
+    , refillEnd_(0)
+    , refillFailures_(0)
     , transferActive_(false)
-    , m_pVFSS(nullptr)
-    , producerThread_(new DataProducerThread(this))
+    , next_expected_file_(0)
+    , producerThread_(new DataProducerThread(this, this))
+    , threadPool_(nullptr)
+    , scheduler_(nullptr)
+    , priority_(TransferScheduler::DEFAULT_PRIORITY)
+    , streamSink_(nullptr)
+    , consumersWaiting_(0)
+    , readCancelled_(false)
+    , readTimeout_(-1)
+    , producerWaiting_(false)
+    , producerWaitStartNs_(-1)
+    , bufferedBytes_(0)
+    , peakBufferedBytes_(0)
+    , highWatermark_(DEFAULT_HIGH_WATERMARK)
+    , lowWatermark_(DEFAULT_LOW_WATERMARK)
+    , producerThrottled_(false)
+    , spillFile_(nullptr)
+    , chunkCompressor_(nullptr)
+    , compressionEnabled_(false)
+    , compressionThreads_(0)
+    , compressionLevel_(ChunkCompressor::DEFAULT_LEVEL)
+    , chunkVerifier_(nullptr)
+    , checksumsEnabled_(false)
+    , checkpointsEnabled_(false)
+    , pendingInvalidBytes_(0)
+    , spillEnabled_(false)
+    , maxSpillBytes_(0)
+    , spilling_(false)
+    , sourceMode_(ChunkSource::Buffered)
+    , ioQueueDepth_(ChunkSource::DEFAULT_QUEUE_DEPTH)
+    , rangeWorkers_(1)
+    , rangeSize_(ParallelRangeFetcher::DEFAULT_RANGE_SIZE)
+    , gatherEnabled_(true)
+    , minimumFill_(0)
+    , readCalls_(0)
+    , chunksConsumed_(0)
+    , refillRequests_(0)
 {
     m_transferComplete.store(false);
     // 连接信号和槽
@@ -44,24 +67,51 @@ FileBufferManager::FileBufferManager(QObject *parent)
 //            this, &FileBufferManager::onTransferComplete);
     //connect(producerThread_, &QThread::finished, 
     //        this, &FileBufferManager::onProducerFinished);
+    connect(&progress_, &ProgressAggregator::progressUpdated,
+            this, &FileBufferManager::transferProgress);
+}
 
-    createVFS();
+std::shared_ptr<FileBufferManager> FileBufferManager::create()
+{
+    // 剪贴板可能在其他线程释放最后一个引用，QObject须在所属线程中销毁
+    return std::shared_ptr<FileBufferManager>(new FileBufferManager(), [](FileBufferManager* manager) {
+        if (manager->thread() == QThread::currentThread()) {
+            delete manager;
+        } else {
+            manager->deleteLater();
+        }
+    });
 }
 
 FileBufferManager::~FileBufferManager()
 {
     stopTransfer();
 
-    // 确保线程已停止
-    if (producerThread_->isRunning()) {
-        producerThread_->stop();
-        producerThread_->wait(3000); // 最多等待3秒
-    }
+    // 生产任务访问本对象的成员，必须等它结束
+    producerThread_->stop();
+    producerThread_->wait();
+
+    delete spillFile_;
+    spillFile_ = nullptr;
+    delete chunkCompressor_;
+    chunkCompressor_ = nullptr;
+    delete chunkVerifier_;
+    chunkVerifier_ = nullptr;
 }
 
 void FileBufferManager::startTransfer(const QString& filePath, const QString& fileName, qint64 fileSize)
+{
+    TransferFile file;
+    file.filePath = filePath;
+    file.fileName = fileName;
+    file.fileSize = fileSize;
+    startTransfer(TransferFileList() << file);
+}
+
+void FileBufferManager::startTransfer(const TransferFileList& files, int priority)
 {
     QMutexLocker locker(&m_mutex);
+    priority_ = priority;
 
     // 如果已有传输在进行，先停止
     if (transferActive_) {
@@ -69,64 +119,180 @@ void FileBufferManager::startTransfer(const QString& filePath, const QString& fi
     }
 
     // 重置状态
-    fileName_ = fileName;
-    fileSize_ = fileSize;
-    totalBytesRead_ = 0;
+    files_ = files;
+    fileSize_ = 0;
+    for (const TransferFile& file : files_) {
+        fileSize_ += file.fileSize;
+    }
+    // resumeFile校验过的文件从续传位置开始，之前的数据接收方已有
+    std::vector<qint64> resumeOffsets(files_.size(), 0);
+    resumeStats_ = TransferCheckpoint::Statistics();
+    if (checkpointsEnabled_) {
+        for (int index = 0; index < files_.size(); ++index) {
+            const TransferFile& file = files_.at(index);
+            resumeOffsets[index] = qBound((qint64)0, pendingResume_.value(file.filePath, 0), file.fileSize);
+            resumeStats_.resumedBytes += resumeOffsets[index];
+        }
+        resumeStats_.invalidBytes = pendingInvalidBytes_;
+    }
+    pendingResume_.clear();
+    pendingInvalidBytes_ = 0;
+    totalBytesRead_ = resumeStats_.resumedBytes;
+    fileBytesRead_ = resumeOffsets;
+    fileBytesQueued_ = resumeOffsets;
+    refillFileIndex_ = -1;
+    file_transfer_completed_.assign(files_.size(), false);
+    for (int index = 0; index < files_.size(); ++index) {
+        file_transfer_completed_[index] = resumeOffsets[index] >= files_.at(index).fileSize;
+    }
+    next_expected_file_.store(0);
+    advanceExpectedFileLocked();
     transferActive_ = true;
     m_transferComplete.store(false);
+    readCancelled_.store(false);
 
-    // 清空队列
+    // 清空队列，此时生产者线程已停止
     dataQueue_.clear();
+    chunkCache_.clear();
+    chunkCache_.resetStatistics();
 
-    // 配置并启动生产者线程
-    producerThread_->setParameters(filePath, fileName, fileSize);
-    producerThread_->start();
-    if (!m_pVFSS) {
-        createVFS();
+    // 每次传输使用新的溢出文件，上一次的溢出数据随文件一起删除
+    delete spillFile_;
+    spillFile_ = nullptr;
+    spilling_ = false;
+    if (spillEnabled_) {
+        spillFile_ = new SpillFile();
+        if (!spillFile_->open(spillDirectory_)) {
+            qWarning() << "create spill file failed, spill disabled:" << spillFile_->errorString();
+            delete spillFile_;
+            spillFile_ = nullptr;
+        }
+    }
+    delete chunkCompressor_;
+    chunkCompressor_ = nullptr;
+    if (compressionEnabled_) {
+        chunkCompressor_ = new ChunkCompressor(compressionThreads_, compressionLevel_);
     }
-    else {
-        m_pVFSS->setFileName(fileName_);
+    delete chunkVerifier_;
+    chunkVerifier_ = nullptr;
+    // 检查点的CRC也在校验线程上计算，只开检查点时校验线程不做readData一侧的校验
+    if (checksumsEnabled_ || checkpointsEnabled_) {
+        chunkVerifier_ = new ChunkVerifier(static_cast<int>(files_.size()), checksumsEnabled_);
+        for (int index = 0; index < files_.size(); ++index) {
+            if (resumeOffsets[index] > 0) {
+                chunkVerifier_->skipPrefix(index, resumeOffsets[index]);
+            }
+            // 整个文件都已续传，不会再有readData读到它的末尾
+            if (resumeOffsets[index] > 0 && resumeOffsets[index] >= files_.at(index).fileSize) {
+                chunkVerifier_->finishFile(index, files_.at(index).fileSize);
+            }
+        }
+    }
+    bufferedBytes_.store(0);
+    peakBufferedBytes_.store(0);
+    producerThrottled_.store(false);
+    producerWaiting_.store(false);
+    producerWaitStartNs_ = -1;
+    readCalls_.store(0);
+    chunksConsumed_.store(0);
+    refillRequests_.store(0);
+    chunkSizer_.reset();
+    bufferPool_.resetStatistics();
+    updateBufferPoolLimit();
+    metrics_.reset();
+    progress_.start(fileSize_, totalBytesRead_);
+
+    // 配置并启动生产者
+    producerThread_->setThreadPool(threadPool_);
+    producerThread_->setScheduler(scheduler_, priority_);
+    // io_uring的预读缓冲区不经过缓存，合计限制在高水位的四分之一，缓存加预读不会远超会话预算
+    producerThread_->setRangeWorkers(rangeWorkers_, rangeSize_);
+    producerThread_->setIoQueueDepth(ioQueueDepth_, highWatermark_ / IO_PREFETCH_DIVISOR);
+    producerThread_->setParameters(files_, sourceMode_, &bufferPool_, networkPeer_);
+    producerThread_->setPacingPolicy(pacingPolicy_);
+    producerThread_->setCompressor(chunkCompressor_);
+    producerThread_->setVerifier(chunkVerifier_);
+    producerThread_->setCheckpointDirectory(checkpointsEnabled_ ? effectiveCheckpointDirectory() : QString());
+    producerThread_->setResumeOffsets(resumeOffsets);
+    producerThread_->start();
+    qDebug() << "files:" << files_.size() << "total size:" << fileSize_;
+
+    // 呈现端可能同步回调getFileCount等接口，先释放锁
+    StreamSink* sink = streamSink_;
+    TransferFileList published = files_;
+    locker.unlock();
+    if (sink) {
+        sink->publish(shared_from_this(), published);
     }
-    qDebug() << "file:" << fileName << "size:" << fileSize;
 }
 
 void FileBufferManager::stopTransfer()
 {
     if (transferActive_) {
         transferActive_ = false;
+        wakeConsumer();
 
-        // 停止生产者线程
+        // 停止生产者，等待背压而让出线程的生产任务在stop中直接收尾
         producerThread_->stop();
         producerThread_->wait();
+        // 读取方仍持有的缓冲区归还时按上限保留，其余立即释放
+        bufferPool_.trim();
+
+        // 等校验线程写完并关闭生产者交给它的检查点，读取方完整读完的文件不再需要续传
+        if (chunkVerifier_) {
+            chunkVerifier_->waitForIdle();
+        }
+        if (checkpointsEnabled_) {
+            const QString directory = effectiveCheckpointDirectory();
+            for (int index = 0; index < files_.size(); ++index) {
+                if (fileBytesRead_[index] >= files_.at(index).fileSize) {
+                    TransferCheckpoint::remove(directory, files_.at(index));
+                }
+            }
+        }
+
+        // 发布最终进度
+        progress_.stop();
 
-        qDebug() << "停止传输文件:" << fileName_;
+        qDebug() << "停止传输文件:" << files_.size();
     }
 }
 
-void FileBufferManager::createVFS()
+void FileBufferManager::setThreadPool(QThreadPool* pool)
 {
-    IDataObject *data_obj = nullptr;
-    m_pVFSS = new VirtualFileSrcStream();
-    m_pVFSS->setFileName(fileName_);
-    HRESULT hr = m_pVFSS ? S_OK : E_OUTOFMEMORY;
-    if (SUCCEEDED(hr))
-    {
-        m_pVFSS->onInit();
-        hr = m_pVFSS->QueryInterface(IID_IDataObject, (void**)&data_obj);
-        m_pVFSS->Release();
-        if (SUCCEEDED(hr)) {
-            ::OleSetClipboard(data_obj);
-            data_obj->Release();
-        }
+    QMutexLocker locker(&m_mutex);
+    threadPool_ = pool;
+    // 已停止的会话可能比线程池活得更久（仍被剪贴板引用），须同步解除
+    if (producerThread_) {
+        producerThread_->setThreadPool(pool);
     }
 }
 
-void FileBufferManager::clearVFS()
+void FileBufferManager::setScheduler(TransferScheduler* scheduler)
 {
-    m_pVFSS = nullptr;
+    QMutexLocker locker(&m_mutex);
+    scheduler_ = scheduler;
 }
 
-qint64 FileBufferManager::readData(char *data, qint64 maxSize)
+int FileBufferManager::priority() const
+{
+    QMutexLocker locker(&m_mutex);
+    return priority_;
+}
+
+void FileBufferManager::setStreamSink(StreamSink* sink)
+{
+    QMutexLocker locker(&m_mutex);
+    streamSink_ = sink;
+}
+
+StreamSink* FileBufferManager::streamSink() const
+{
+    QMutexLocker locker(&m_mutex);
+    return streamSink_;
+}
+
+qint64 FileBufferManager::readData(int fileIndex, qint64 offset, char *data, qint64 maxSize)
 {
     // 如果传输未激活，返回0
     if (!transferActive_) {
@@ -134,72 +300,646 @@ qint64 FileBufferManager::readData(char *data, qint64 maxSize)
         return 0;
     }
 
-    qDebug() << "------- readData maxSize: " << maxSize;
-
-    // 等待数据队列非空或传输完成
-    while (transferActive_ && !m_transferComplete.load()) {
-        m_mutex.lock();
-        if (dataQueue_.isEmpty()) {
-            qDebug() << "dataQueue_ is empty, waiting for new data...";
-            QCoreApplication::processEvents();
-            QThread::msleep(20);
-        }
-        else {
-            m_mutex.unlock();
-            break;
-        }
-        m_mutex.unlock();
+    if (fileIndex < 0 || fileIndex >= static_cast<int>(fileBytesRead_.size())) {
+        qDebug() << "readData invalid file index:" << fileIndex;
+        return 0;
     }
-    m_mutex.lock();
-    // 如果传输完成且队列仍为空，返回0
-    if (dataQueue_.isEmpty() && !transferActive_) {
-        qDebug() << "dataQueue_.isEmpty() && !transferActive_";
-        m_mutex.unlock();
+
+    // 已到达文件末尾
+    const qint64 fileSize = files_.at(fileIndex).fileSize;
+    if (offset < 0 || offset >= fileSize) {
         return 0;
     }
+
+    // 端到端校验已发现数据不一致，之后的读取都失败，读取方不会得到损坏的文件
+    if (chunkVerifier_ && chunkVerifier_->hasMismatch()) {
+        return -1;
+    }
+
+    // 不跨越文件边界
+    maxSize = qMin(maxSize, fileSize - offset);
+
+    readCalls_.fetch_add(1, std::memory_order_relaxed);
+    chunkSizer_.recordReadSize(maxSize);
+
+    QMutexLocker consumerLocker(&consumerMutex_);
+
+    // 聚合模式下最少要读到的字节数，不超过本次请求大小
+    const qint64 minimumFill = gatherEnabled_ ? qMin(minimumFill_, maxSize) : 0;
     qint64 bytesRead = 0;
+    // 本次调用从队列取出的数据块中最早的入队时间
+    qint64 firstEnqueuedNs = -1;
+
+    while (bytesRead < maxSize) {
+        // 从缓存按偏移复制，非聚合模式下每次只从一个数据块读取
+        const qint64 copyStart = metrics_.now();
+        qint64 copied = chunkCache_.read(fileIndex, offset + bytesRead, data + bytesRead,
+                                         maxSize - bytesRead, gatherEnabled_);
+        if (copied > 0) {
+            metrics_.record(TransferMetrics::Copy, metrics_.now() - copyStart, copied);
+            bytesRead += copied;
+            if (!gatherEnabled_) {
+                break;
+            }
+            continue;
+        }
+
+        // 缓存中没有该位置的数据，先把已到达的数据块移入缓存
+        if (consumeQueuedChunk(&firstEnqueuedNs)) {
+            continue;
+        }
 
-    // 每次只从队列中取出一个数据块
-    bool isEmpty = dataQueue_.isEmpty();
-    if (!isEmpty) {
-        QByteArray chunk = dataQueue_.dequeue();
-
-        // 限制读取大小不超过请求的大小
-        qint64 copySize = qMin((qint64)chunk.size(), maxSize);
-        memcpy(data, chunk.constData(), copySize);
-        bytesRead = copySize;
-
-        // 如果块比需要的大，将剩余部分放回队列前端
-        if (chunk.size() > copySize) {
-            QByteArray remaining = chunk.mid(copySize);
-            dataQueue_.prepend(remaining);
-            qDebug() << "data to big, remaining.size: " << remaining.size() << " back to queue!";
+        // 队列暂时为空：已读到数据且达到最少填充量时不再等待
+        if (bytesRead > 0 && bytesRead >= minimumFill) {
+            break;
+        }
+        if (!waitForMissingData(fileIndex, offset + bytesRead, maxSize - bytesRead, consumerLocker)) {
+            break;
         }
+    }
 
-        qDebug() << "read buffer:" << copySize << ", dataQueue_ size: " << dataQueue_.size() << " block";
-    } else {
-        qDebug() << "dataQueue_.isEmpty read";
+    // 进度按每个文件读到的最大偏移计算，重复读取不会重复计入
+    const qint64 readEnd = offset + bytesRead;
+    bool reachedEnd = false;
+    if (readEnd > fileBytesRead_[fileIndex]) {
+        totalBytesRead_ += readEnd - fileBytesRead_[fileIndex];
+        fileBytesRead_[fileIndex] = readEnd;
+        // 第一次读到文件末尾时比较整个文件的摘要，排在该文件所有数据块的校验之后
+        if (readEnd >= fileSize && chunkVerifier_) {
+            chunkVerifier_->finishFile(fileIndex, fileSize);
+            reachedEnd = true;
+        }
     }
-    m_mutex.unlock();
-    totalBytesRead_ += bytesRead;
 
-    // 发送进度信号
-    emit transferProgress(totalBytesRead_, fileSize_);
+    // 只更新计数，进度信号由GUI线程的定时器按固定频率发出
+    progress_.setCompleted(totalBytesRead_);
+
+    if (firstEnqueuedNs >= 0 && bytesRead > 0) {
+        metrics_.record(TransferMetrics::EnqueueToReturn, metrics_.now() - firstEnqueuedNs, bytesRead);
+    }
 
-    qDebug() << "------- readData bytesRead: " << bytesRead << " totalBytesRead_:" << totalBytesRead_;
     // 如果已读取所有数据且传输已完成，发送完成信号
     if (totalBytesRead_ >= fileSize_ && !transferActive_) {
         qDebug() << "transferFinished read";
         emit transferFinished();
     }
+    consumerLocker.unlock();
 
+    // 文件的最后一次读取等到摘要比较完成，不一致时不把最后的数据交给读取方
+    if (reachedEnd && chunkVerifier_->waitForFile(fileIndex).status == ChunkVerifier::FileResult::Mismatch) {
+        return -1;
+    }
+    if (chunkVerifier_ && chunkVerifier_->hasMismatch()) {
+        return -1;
+    }
     return bytesRead;
 }
 
-QString FileBufferManager::getFileName() const
+TransferMetrics& FileBufferManager::metrics()
+{
+    return metrics_;
+}
+
+QByteArray FileBufferManager::metricsJson() const
+{
+    return metrics_.toJson();
+}
+
+void FileBufferManager::setProgressInterval(int intervalMs)
+{
+    progress_.setInterval(intervalMs);
+}
+
+int FileBufferManager::progressInterval() const
+{
+    return progress_.interval();
+}
+
+ProgressAggregator::Snapshot FileBufferManager::progress() const
+{
+    return progress_.snapshot();
+}
+
+void FileBufferManager::setCacheBudget(qint64 bytes)
+{
+    chunkCache_.setBudget(bytes);
+}
+
+qint64 FileBufferManager::cacheBudget() const
+{
+    return chunkCache_.budget();
+}
+
+void FileBufferManager::setReadTimeout(int msecs)
+{
+    readTimeout_.store(msecs);
+}
+
+int FileBufferManager::readTimeout() const
+{
+    return readTimeout_.load();
+}
+
+void FileBufferManager::cancelRead()
+{
+    readCancelled_.store(true);
+    wakeConsumer();
+}
+
+void FileBufferManager::setGatherMode(bool enabled, qint64 minimumFill)
+{
+    gatherEnabled_ = enabled;
+    minimumFill_ = qMax(minimumFill, (qint64)0);
+}
+
+bool FileBufferManager::isGatherEnabled() const
+{
+    return gatherEnabled_;
+}
+
+qint64 FileBufferManager::minimumFill() const
+{
+    return minimumFill_;
+}
+
+void FileBufferManager::setPacingPolicy(const PacingPolicy& policy)
+{
+    QMutexLocker locker(&m_mutex);
+    pacingPolicy_ = policy;
+}
+
+PacingPolicy FileBufferManager::pacingPolicy() const
+{
+    QMutexLocker locker(&m_mutex);
+    return pacingPolicy_;
+}
+
+void FileBufferManager::setAdaptiveChunkSize(bool enabled, qint64 minChunkSize, qint64 maxChunkSize)
+{
+    chunkSizer_.setEnabled(enabled);
+    chunkSizer_.setBounds(minChunkSize, maxChunkSize);
+}
+
+qint64 FileBufferManager::nextChunkSize()
+{
+    return chunkSizer_.nextChunkSize(bufferedBytes_.load(), highWatermark_);
+}
+
+void FileBufferManager::setSourceMode(ChunkSource::Mode mode)
+{
+    QMutexLocker locker(&m_mutex);
+    sourceMode_ = mode;
+}
+
+ChunkSource::Mode FileBufferManager::sourceMode() const
+{
+    QMutexLocker locker(&m_mutex);
+    return sourceMode_;
+}
+
+void FileBufferManager::setRangeWorkers(int workerCount, qint64 rangeSize)
+{
+    QMutexLocker locker(&m_mutex);
+    rangeWorkers_ = qMax(workerCount, 1);
+    rangeSize_ = qMax(rangeSize, (qint64)1);
+}
+
+int FileBufferManager::rangeWorkers() const
+{
+    QMutexLocker locker(&m_mutex);
+    return rangeWorkers_;
+}
+
+qint64 FileBufferManager::rangeSize() const
+{
+    QMutexLocker locker(&m_mutex);
+    return rangeSize_;
+}
+
+void FileBufferManager::setNetworkPeer(const NetworkPeer& peer)
+{
+    QMutexLocker locker(&m_mutex);
+    networkPeer_ = peer;
+}
+
+NetworkPeer FileBufferManager::networkPeer() const
+{
+    QMutexLocker locker(&m_mutex);
+    return networkPeer_;
+}
+
+void FileBufferManager::setIoQueueDepth(int depth)
+{
+    QMutexLocker locker(&m_mutex);
+    ioQueueDepth_ = depth;
+}
+
+int FileBufferManager::ioQueueDepth() const
+{
+    QMutexLocker locker(&m_mutex);
+    return ioQueueDepth_;
+}
+
+TransferStatistics FileBufferManager::statistics() const
+{
+    TransferStatistics stats;
+    stats.bytesRead = totalBytesRead_ - resumeStats_.resumedBytes;
+    stats.readCalls = readCalls_.load(std::memory_order_relaxed);
+    stats.chunksConsumed = chunksConsumed_.load(std::memory_order_relaxed);
+    stats.bufferedBytes = bufferedBytes_.load();
+    stats.peakBufferedBytes = peakBufferedBytes_.load();
+    stats.targetBytesPerSecond = producerThread_->targetBytesPerSecond();
+    stats.achievedBytesPerSecond = producerThread_->achievedBytesPerSecond();
+    stats.chunkSize = chunkSizer_.currentChunkSize();
+    stats.pool = bufferPool_.statistics();
+    stats.cache = chunkCache_.statistics();
+    stats.refillRequests = refillRequests_.load(std::memory_order_relaxed);
+    if (spillFile_) {
+        stats.spill = spillFile_->statistics();
+    }
+    stats.ranges = producerThread_->rangeStatistics();
+    if (chunkCompressor_) {
+        stats.compression = chunkCompressor_->statistics();
+    }
+    if (chunkVerifier_ && chunkVerifier_->verifiesReceived()) {
+        stats.verification = chunkVerifier_->statistics();
+    }
+    if (chunkVerifier_) {
+        stats.checkpoint = chunkVerifier_->checkpointStatistics();
+    }
+    stats.checkpoint.resumedBytes = resumeStats_.resumedBytes;
+    stats.checkpoint.invalidBytes = resumeStats_.invalidBytes;
+    return stats;
+}
+
+void FileBufferManager::setFlowControl(qint64 highWatermark, qint64 lowWatermark)
+{
+    {
+        QMutexLocker locker(&spaceMutex_);
+        highWatermark_ = qMax(highWatermark, (qint64)1);
+        lowWatermark_ = qBound((qint64)0, lowWatermark, highWatermark_);
+    }
+    updateBufferPoolLimit();
+    // 按新的水位重新判断
+    if (producerWaiting_.exchange(false)) {
+        producerThread_->resume();
+    }
+}
+
+qint64 FileBufferManager::highWatermark() const
+{
+    return highWatermark_;
+}
+
+qint64 FileBufferManager::lowWatermark() const
+{
+    return lowWatermark_;
+}
+
+qint64 FileBufferManager::getBufferedBytes() const
+{
+    return bufferedBytes_.load();
+}
+
+void FileBufferManager::setSpill(bool enabled, const QString& directory, qint64 maxSpillBytes)
+{
+    QMutexLocker locker(&m_mutex);
+    spillEnabled_ = enabled;
+    spillDirectory_ = directory;
+    maxSpillBytes_ = qMax(maxSpillBytes, (qint64)0);
+}
+
+bool FileBufferManager::isSpillEnabled() const
+{
+    QMutexLocker locker(&m_mutex);
+    return spillEnabled_;
+}
+
+void FileBufferManager::setCompression(bool enabled, int threadCount, int level)
+{
+    QMutexLocker locker(&m_mutex);
+    compressionEnabled_ = enabled;
+    compressionThreads_ = qMax(threadCount, 0);
+    compressionLevel_ = level;
+}
+
+bool FileBufferManager::isCompressionEnabled() const
 {
     QMutexLocker locker(&m_mutex);
-    return fileName_;
+    return compressionEnabled_;
+}
+
+void FileBufferManager::setChecksums(bool enabled)
+{
+    QMutexLocker locker(&m_mutex);
+    checksumsEnabled_ = enabled;
+}
+
+bool FileBufferManager::isChecksumEnabled() const
+{
+    QMutexLocker locker(&m_mutex);
+    return checksumsEnabled_;
+}
+
+ChunkVerifier::FileResult FileBufferManager::fileVerification(int fileIndex) const
+{
+    if (!chunkVerifier_) {
+        return ChunkVerifier::FileResult();
+    }
+    return chunkVerifier_->fileResult(fileIndex);
+}
+
+void FileBufferManager::waitForVerification()
+{
+    if (chunkVerifier_) {
+        chunkVerifier_->waitForIdle();
+    }
+}
+
+void FileBufferManager::setCheckpoints(bool enabled, const QString& directory)
+{
+    QMutexLocker locker(&m_mutex);
+    checkpointsEnabled_ = enabled;
+    checkpointDirectory_ = directory;
+}
+
+bool FileBufferManager::isCheckpointEnabled() const
+{
+    QMutexLocker locker(&m_mutex);
+    return checkpointsEnabled_;
+}
+
+qint64 FileBufferManager::resumeFile(const TransferFile& file, QIODevice& partial)
+{
+    QMutexLocker locker(&m_mutex);
+    if (!checkpointsEnabled_) {
+        return 0;
+    }
+    TransferCheckpoint checkpoint;
+    if (!checkpoint.open(effectiveCheckpointDirectory(), file)) {
+        qWarning() << "open checkpoint failed, transfer from the beginning:" << checkpoint.errorString();
+        return 0;
+    }
+    const qint64 offset = checkpoint.verify(partial);
+    checkpoint.close();
+    pendingResume_.insert(file.filePath, offset);
+    pendingInvalidBytes_ += checkpoint.statistics().invalidBytes;
+    return offset;
+}
+
+void FileBufferManager::updateBufferPoolLimit()
+{
+    // 借出的缓冲区不超过高水位加上生产中的一个数据块，按2的幂分级最多放大一倍；
+    // 空闲链表保留这么多即可使预热后不再分配，更多的空闲缓冲区直接释放
+    qint64 highWatermark;
+    {
+        QMutexLocker locker(&spaceMutex_);
+        highWatermark = highWatermark_;
+    }
+    bufferPool_.setMaxFreeBytes(2 * (highWatermark + chunkSizer_.maxChunkSize()));
+}
+
+QString FileBufferManager::effectiveCheckpointDirectory() const
+{
+    return checkpointDirectory_.isEmpty()
+        ? QDir(QDir::tempPath()).filePath(QStringLiteral("ClipboardTransfer-checkpoints"))
+        : checkpointDirectory_;
+}
+
+bool FileBufferManager::hasReadableData() const
+{
+    return !dataQueue_.isEmpty();
+}
+
+bool FileBufferManager::isProductionFinished() const
+{
+    return m_transferComplete.load() && producerThread_->pendingRanges() == 0;
+}
+
+bool FileBufferManager::consumeQueuedChunk(qint64* enqueuedNs)
+{
+    DataChunk chunk;
+    if (!dataQueue_.tryPop(chunk)) {
+        return false;
+    }
+    if (enqueuedNs && (*enqueuedNs < 0 || chunk.enqueuedNs < *enqueuedNs)) {
+        *enqueuedNs = chunk.enqueuedNs;
+    }
+    metrics_.record(TransferMetrics::QueueResidency, metrics_.now() - chunk.enqueuedNs, chunk.size());
+
+    // 溢出标记不占用内存缓冲额度，压缩的数据块按压缩后的大小占用
+    const qint64 bufferedSize = chunk.size();
+    const qint64 chunkSize = chunk.isCompressed() ? chunk.rawSize
+                           : chunk.isSpilled() ? chunk.spillSize : bufferedSize;
+    // 经过溢出文件或压缩的数据块被重新生成，需要重新计算校验值
+    const bool restored = chunk.isSpilled() || chunk.isCompressed();
+    bool loaded = true;
+    if (chunk.isSpilled() && !(spillFile_ && spillFile_->load(chunk))) {
+        // 读回失败时不放入缓存，该区间之后按缓存缺失由生产者从源文件补读
+        qWarning() << "load spilled chunk failed:" << (spillFile_ ? spillFile_->errorString() : QString());
+        loaded = false;
+    }
+    if (loaded && chunk.isCompressed() && !(chunkCompressor_ && chunkCompressor_->decompress(chunk))) {
+        loaded = false;
+    }
+
+    // 顺序生产的数据块推进该文件的前沿，补读的数据块都在前沿之前
+    const int index = chunk.fileIndex;
+    const bool sequential = index >= 0 && index < static_cast<int>(fileBytesQueued_.size())
+                         && chunk.offset == fileBytesQueued_[index];
+    if (sequential) {
+        fileBytesQueued_[index] += chunkSize;
+        // 文件的数据都已离开队列，后面的文件成为当前文件
+        if (fileBytesQueued_[index] >= files_.at(index).fileSize) {
+            markFileCompleted(index);
+        }
+    }
+    if (loaded) {
+        // 校验在后台进行，数据块照常放入缓存供readData读取
+        if (chunkVerifier_) {
+            chunkVerifier_->submit(chunk, sequential, restored);
+        }
+        chunkCache_.insert(std::move(chunk));
+    } else if (chunkVerifier_) {
+        chunkVerifier_->discard(chunk);
+    }
+    chunksConsumed_.fetch_add(1, std::memory_order_relaxed);
+
+    // 数据块离开队列即归还缓冲额度，缓存有自己的预算
+    bufferedBytes_.fetch_sub(bufferedSize);
+    notifySpaceAvailable();
+    return true;
+}
+
+bool FileBufferManager::waitForMissingData(int fileIndex, qint64 position, qint64 length, QMutexLocker& consumerLocker)
+{
+    const qint64 queued = fileBytesQueued_[fileIndex];
+    if (position < queued) {
+        // 数据已从队列取出过但被缓存淘汰，请求生产者只补读缺失的部分
+        const bool requested = refillFileIndex_ == fileIndex && position >= refillBegin_
+            && position < refillEnd_ && producerThread_->pendingRanges() > 0;
+        if (!requested) {
+            qint64 end = qMin(position + qMax(length, chunkSizer_.currentChunkSize()), queued);
+            end = chunkCache_.nextCachedOffset(fileIndex, position, end);
+            refillFileIndex_ = fileIndex;
+            refillBegin_ = position;
+            refillEnd_ = end;
+            refillRequests_.fetch_add(1, std::memory_order_relaxed);
+            producerThread_->requestRange(fileIndex, position, end - position);
+        }
+    }
+    // 后面的文件还未轮到时同样等待队列非空，取出的前面文件的数据块放入缓存，
+    // 被淘汰的部分在那个文件的读取方读到时补读，不要求读取方按文件顺序串行读取
+
+    // 等待数据队列非空、生产结束、取消或超时，等待期间其他文件的readData可以取出数据块
+    const qint64 failures = refillFailures_.load();
+    const qint64 waitStart = metrics_.now();
+    consumerLocker.unlock();
+    const bool ready = waitForData();
+    consumerLocker.relock();
+    metrics_.record(TransferMetrics::ConsumerWait, metrics_.now() - waitStart);
+    // 等待期间其他readData可能已取出该数据块放入缓存
+    if (ready || chunkCache_.contains(fileIndex, position)) {
+        return true;
+    }
+    // 生产结束后等待立即返回：补读的数据块可能已被其他文件的readData移入缓存后又被淘汰，
+    // 补读没有失败时由调用方重新请求补读，而不是把缺失当作传输停止返回0
+    return position < queued && transferActive_ && isProductionFinished()
+        && refillFailures_.load() == failures;
+}
+
+bool FileBufferManager::waitForData()
+{
+    if (hasReadableData()) {
+        return true;
+    }
+
+    // COM可能在GUI线程上调用Read，此时分段等待并处理事件，避免界面卡死
+    QCoreApplication* app = QCoreApplication::instance();
+    const bool onGuiThread = app && QThread::currentThread() == app->thread();
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QMutexLocker locker(&waitMutex_);
+    consumersWaiting_.fetch_add(1);
+    // 与notifyDataAvailable中的屏障配对：要么生产者看到consumersWaiting_，要么这里看到新数据
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    while (transferActive_ && !isProductionFinished() && !readCancelled_.load()
+           && !hasReadableData()) {
+        unsigned long waitMs = ULONG_MAX;
+        const int timeout = readTimeout_.load();
+        if (timeout >= 0) {
+            qint64 remaining = timeout - timer.elapsed();
+            if (remaining <= 0) {
+                qDebug() << "readData wait timeout:" << timeout << "ms";
+                break;
+            }
+            waitMs = static_cast<unsigned long>(remaining);
+        }
+        if (onGuiThread) {
+            waitMs = qMin(waitMs, static_cast<unsigned long>(WAIT_SLICE_MS));
+        }
+
+        if (!dataAvailable_.wait(&waitMutex_, waitMs) && onGuiThread) {
+            locker.unlock();
+            QCoreApplication::processEvents();
+            locker.relock();
+        }
+    }
+
+    consumersWaiting_.fetch_sub(1);
+    // 取消只作用于当前阻塞的这次读取，之后的readData照常等待
+    readCancelled_.store(false);
+    return hasReadableData();
+}
+
+void FileBufferManager::notifyDataAvailable()
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (consumersWaiting_.load(std::memory_order_relaxed) > 0) {
+        QMutexLocker locker(&waitMutex_);
+        dataAvailable_.wakeAll();
+    }
+}
+
+void FileBufferManager::wakeConsumer()
+{
+    QMutexLocker locker(&waitMutex_);
+    dataAvailable_.wakeAll();
+}
+
+bool FileBufferManager::reserveSpace(qint64 chunkSize, bool markerOnly)
+{
+    QMutexLocker locker(&spaceMutex_);
+    if (hasSpaceLocked(chunkSize, markerOnly)) {
+        return true;
+    }
+    producerWaiting_.store(true);
+    // 与notifySpaceAvailable中的屏障配对：登记之后再检查一次，消费者在登记之前腾出的空间不会错过
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (hasSpaceLocked(chunkSize, markerOnly)) {
+        producerWaiting_.store(false);
+        return true;
+    }
+    return false;
+}
+
+bool FileBufferManager::hasSpaceLocked(qint64 chunkSize, bool markerOnly)
+{
+    const qint64 buffered = bufferedBytes_.load();
+    const bool ringFull = dataQueue_.size() >= dataQueue_.capacity();
+    // 溢出标记不占内存额度，只需要队列有空位
+    if (markerOnly) {
+        return !ringFull;
+    }
+    if (producerThrottled_.load() && buffered <= lowWatermark_) {
+        producerThrottled_.store(false);
+    }
+    // 缓冲区为空时总是允许入队，保证单个超大块也能通过
+    const bool underBudget = buffered == 0 || buffered + chunkSize <= highWatermark_;
+    if (!underBudget) {
+        producerThrottled_.store(true);
+    }
+    return !producerThrottled_.load() && underBudget && !ringFull;
+}
+
+bool FileBufferManager::shouldSpill(qint64 chunkSize)
+{
+    if (!spillFile_ || !spillFile_->isOpen()) {
+        return false;
+    }
+
+    // 与阻塞时相同的高低水位：超过高水位开始溢出，降到低水位以下回到内存
+    const qint64 buffered = bufferedBytes_.load();
+    if (spilling_ && buffered <= lowWatermark_) {
+        spilling_ = false;
+    } else if (!spilling_ && buffered > 0 && buffered + chunkSize > highWatermark_) {
+        spilling_ = true;
+    }
+    if (!spilling_) {
+        return false;
+    }
+    return maxSpillBytes_ <= 0 || spillFile_->pendingBytes() + chunkSize <= maxSpillBytes_;
+}
+
+void FileBufferManager::notifySpaceAvailable()
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!producerWaiting_.load(std::memory_order_relaxed)) {
+        return;
+    }
+    // 生产者因超过高水位而让出线程时，等降到低水位再重新提交，避免每次读取都提交一次
+    if ((!producerThrottled_.load() || bufferedBytes_.load() <= lowWatermark_)
+        && producerWaiting_.exchange(false)) {
+        producerThread_->resume();
+    }
+}
+
+QString FileBufferManager::getFileName() const
+{
+    return getFileName(0);
 }
 
 qint64 FileBufferManager::getFileSize() const
@@ -208,6 +948,54 @@ qint64 FileBufferManager::getFileSize() const
     return fileSize_;
 }
 
+int FileBufferManager::getFileCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return files_.size();
+}
+
+QString FileBufferManager::getFileName(int fileIndex) const
+{
+    QMutexLocker locker(&m_mutex);
+    return fileIndex >= 0 && fileIndex < files_.size() ? files_.at(fileIndex).fileName : QString();
+}
+
+qint64 FileBufferManager::getFileSize(int fileIndex) const
+{
+    QMutexLocker locker(&m_mutex);
+    return fileIndex >= 0 && fileIndex < files_.size() ? files_.at(fileIndex).fileSize : 0;
+}
+
+void FileBufferManager::markFileCompleted(int fileIndex)
+{
+    QMutexLocker locker(&m_mutex);
+    if (fileIndex >= 0 && fileIndex < static_cast<int>(file_transfer_completed_.size())) {
+        file_transfer_completed_[fileIndex] = true;
+        advanceExpectedFileLocked();
+    }
+}
+
+void FileBufferManager::advanceExpectedFileLocked()
+{
+    // 移动到下一个未完成的文件，空文件没有数据块，直接视为已完成
+    int next = next_expected_file_.load();
+    while (next < files_.size()
+           && (file_transfer_completed_[next] || files_.at(next).fileSize == 0)) {
+        file_transfer_completed_[next] = true;
+        ++next;
+    }
+    next_expected_file_.store(next);
+}
+
+bool FileBufferManager::isFileComplete(int fileIndex) const
+{
+    QMutexLocker locker(&m_mutex);
+    if (fileIndex < 0 || fileIndex >= static_cast<int>(file_transfer_completed_.size())) {
+        return true;
+    }
+    return file_transfer_completed_[fileIndex];
+}
+
 qint64 FileBufferManager::getTotalReadBytes() const
 {
     QMutexLocker locker(&m_mutex);
@@ -220,25 +1008,44 @@ bool FileBufferManager::isTransferComplete() const
     return (!transferActive_ && totalBytesRead_ >= fileSize_);
 }
 
-void FileBufferManager::onDataChunkGenerated(const QByteArray& chunk)
+bool FileBufferManager::tryEnqueueChunk(DataChunk& chunk)
 {
     if (!transferActive_) {
-        return;
+        return false;
     }
 
-    // 限制队列大小，避免内存占用过高
-    const int MAX_QUEUE_SIZE = 1000;
-    m_mutex.lock();
-    if (dataQueue_.size() >= MAX_QUEUE_SIZE) {
-        qDebug() << "队列已满，当前大小：" << dataQueue_.size() << "，丢弃数据块";
-        m_mutex.unlock();
-        return;
+    // 缓冲字节数超过高水位时写入溢出层，队列中只放位置标记，生产者不被读取方拖慢。
+    // 上一次因队列已满没有入队的溢出标记数据已在溢出文件中，不再写入
+    const qint64 waitStart = producerWaitStartNs_ >= 0 ? producerWaitStartNs_ : metrics_.now();
+    const qint64 chunkSize = chunk.size();
+    bool marker = chunk.isSpilled();
+    if (!marker && shouldSpill(chunkSize)) {
+        marker = spillFile_->append(chunk);
+        if (!marker) {
+            // 溢出文件写入出错，chunk未被改动，退回背压
+            qWarning() << "spill failed, fall back to backpressure:" << spillFile_->errorString();
+        }
     }
 
-    // 添加到队列
-    dataQueue_.enqueue(chunk);
-//    qDebug() << "接收到数据块，大小：" << chunk.size() << "，队列大小：" << dataQueue_.size();
-    m_mutex.unlock();
+    // 缓冲字节数超过高水位时让生产者让出线程，而不是丢弃数据块
+    if (!reserveSpace(marker ? 0 : chunkSize, marker)) {
+        producerWaitStartNs_ = waitStart;
+        return false;
+    }
+    producerWaitStartNs_ = -1;
+    chunk.enqueuedNs = metrics_.now();
+    metrics_.record(TransferMetrics::ProducerWait, chunk.enqueuedNs - waitStart, marker ? chunk.spillSize : chunkSize);
+
+    if (!marker) {
+        // 只有生产者增加缓冲字节数，不需要比较交换
+        const qint64 buffered = bufferedBytes_.fetch_add(chunkSize) + chunkSize;
+        if (buffered > peakBufferedBytes_.load(std::memory_order_relaxed)) {
+            peakBufferedBytes_.store(buffered, std::memory_order_relaxed);
+        }
+    }
+    dataQueue_.tryPush(std::move(chunk));
+    notifyDataAvailable();
+    return true;
 }
 
 void FileBufferManager::onTransferComplete()
@@ -247,6 +1054,17 @@ void FileBufferManager::onTransferComplete()
 
     // 不直接设置transferActive_为false，等待队列中的数据被消费完
     m_transferComplete.store(true);
+    // 生产已结束，只有补读还会借出缓冲区
+    bufferPool_.trim();
+    wakeConsumer();
+}
+
+void FileBufferManager::onRangeProduced(bool ok)
+{
+    if (!ok) {
+        refillFailures_.fetch_add(1);
+    }
+    wakeConsumer();
 }
 
 void FileBufferManager::onProducerFinished()
@@ -255,6 +1073,7 @@ void FileBufferManager::onProducerFinished()
 
     // 设置transferActive_为false，表示生产已完成
     transferActive_ = false;
+    wakeConsumer();
 }
 
 } // namespace clipboard
@@ -0,0 +1,378 @@
+
+#pragma once
+#include "DataProducerThread.h"
+#include "SpscChunkRing.h"
+#include "AdaptiveChunkSizer.h"
+#include "ChunkCache.h"
+#include "SpillFile.h"
+#include "ChunkCompressor.h"
+#include "ChunkVerifier.h"
+#include "TransferMetrics.h"
+#include "TransferScheduler.h"
+#include "ProgressAggregator.h"
+#include "StreamSink.h"
+
+#include <QObject>
+#include <QByteArray>
+#include <QHash>
+#include <QTimer>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QThread>
+#include <QMutexLocker>
+#include <QThreadPool>
+#include <memory>
+
+namespace clipboard {
+
+// 传输统计信息
+struct TransferStatistics
+{
+    qint64 bytesRead = 0;       // readData已返回的字节数
+    qint64 readCalls = 0;       // readData调用次数
+    qint64 chunksConsumed = 0;  // 已读完的数据块个数
+    qint64 bufferedBytes = 0;   // 当前缓冲中的字节数
+    qint64 peakBufferedBytes = 0;   // 本次传输中缓冲字节数的最大值，不超过高水位加一个数据块
+    qint64 targetBytesPerSecond = 0;    // 节流目标速率，0表示不限速
+    double achievedBytesPerSecond = 0;  // 生产者实际达到的速率
+    qint64 chunkSize = 0;               // 生产者当前选择的数据块大小
+    ChunkBufferPool::Statistics pool;   // 数据块缓冲池命中与分配情况
+    ChunkCache::Statistics cache;       // 偏移索引缓存的占用与淘汰情况
+    qint64 refillRequests = 0;          // 因缓存缺失而请求生产者补读的次数
+    SpillFile::Statistics spill;        // 磁盘溢出层的字节数和读写耗时
+    ParallelRangeFetcher::Statistics ranges;    // 并发读取的区间数和乱序重组情况
+    ChunkCompressor::Statistics compression;    // 压缩层的压缩比和压缩、解压耗时
+    ChunkVerifier::Statistics verification;     // 端到端校验的数据块、文件个数和计算耗时
+    TransferCheckpoint::Statistics checkpoint;  // 从检查点续传和写入检查点的字节数
+
+    // 每GB数据需要的readData调用次数
+    double readCallsPerGB() const {
+        return bytesRead > 0 ? readCalls * (1024.0 * 1024.0 * 1024.0) / bytesRead : 0.0;
+    }
+};
+
+// 一个传输会话：自己的队列、缓存、生产者和状态，多个会话可以同时进行。
+// 由TransferSessionManager创建并以shared_ptr持有，呈现端（剪贴板中的数据对象）
+// 通过同一个shared_ptr保持会话存活，直到粘贴方释放
+class FileBufferManager : public QObject, public std::enable_shared_from_this<FileBufferManager>
+{
+    Q_OBJECT
+
+    explicit FileBufferManager(QObject *parent = nullptr);
+
+public:
+    // 生产任务和呈现端通过shared_from_this持有会话，只能以shared_ptr创建；
+    // 通常经由TransferSessionManager::createSession，由它分配共用的线程池和调度器
+    static std::shared_ptr<FileBufferManager> create();
+    ~FileBufferManager();
+
+    // 生产者运行所在的线程池，通常是所有会话共用的I/O线程池；为空时生产者使用自己的线程。
+    // 下一次startTransfer时生效
+    void setThreadPool(QThreadPool* pool);
+    // 在多个会话之间分配I/O时隙的调度器，为空时生产者不经过调度直接读取。下一次startTransfer时生效
+    void setScheduler(TransferScheduler* scheduler);
+
+    // 开始模拟网络传输，定时向队列中添加数据块
+    void startTransfer(const QString& filePath, const QString& fileName, qint64 fileSize);
+    // 多文件传输，files中的下标即剪贴板FILEGROUPDESCRIPTOR中的lindex；
+    // priority为本次传输在调度器中的优先级，越大越优先，含义见TransferScheduler::enroll
+    void startTransfer(const TransferFileList& files, int priority = TransferScheduler::DEFAULT_PRIORITY);
+    // 最近一次startTransfer的优先级
+    int priority() const;
+
+    // 停止传输
+    void stopTransfer();
+
+    // 文件按lindex顺序经过同一个队列，当前文件之后的文件要等前面的文件入队后才有数据
+    bool isCurrentFile(int fileIndex) const {
+        return fileIndex == next_expected_file_.load();
+    }
+    void markFileCompleted(int fileIndex);
+    int getNextExpectedFile() const {
+        return next_expected_file_.load();
+    }
+    bool isFileComplete(int fileIndex) const;
+
+    // 设置传输的呈现端，startTransfer时通过它把文件列表交给读取方，不转移所有权
+    void setStreamSink(StreamSink* sink);
+    StreamSink* streamSink() const;
+
+    // 读取第fileIndex个文件从offset开始的数据，供FileStream::Read使用
+    // 已读过的数据从缓存返回，缓存中被淘汰的区间由生产者重新读取。
+    // 可以从多个线程同时读取不同的文件：后面的文件等待时把前面文件的数据块移入缓存，
+    // 只有传输停止、取消或超时时才返回0；端到端校验发现数据不一致后返回-1
+    qint64 readData(int fileIndex, qint64 offset, char *data, qint64 maxSize);
+
+    // 偏移索引缓存的字节预算，超过后按LRU淘汰
+    void setCacheBudget(qint64 bytes);
+    qint64 cacheBudget() const;
+
+    // readData等待数据的超时时间（毫秒），-1表示一直等待直到有数据、传输完成或被取消
+    void setReadTimeout(int msecs);
+    int readTimeout() const;
+
+    // 取消正在等待数据的readData，使其立即返回；没有readData在等待时作用于下一次等待。
+    // 只取消一次，之后的readData照常等待数据
+    void cancelRead();
+
+    // 聚合读取：一次readData从多个已入队的数据块填充调用方缓冲区，
+    // minimumFill大于0时，在数据不足该字节数且传输未结束前继续等待
+    void setGatherMode(bool enabled, qint64 minimumFill = 0);
+    bool isGatherEnabled() const;
+    qint64 minimumFill() const;
+
+    // 生产者节流策略，下一次startTransfer时生效
+    void setPacingPolicy(const PacingPolicy& policy);
+    PacingPolicy pacingPolicy() const;
+
+    // 自适应数据块大小：根据readData请求大小和队列占用在[minChunkSize, maxChunkSize]内调整
+    void setAdaptiveChunkSize(bool enabled,
+                              qint64 minChunkSize = AdaptiveChunkSizer::DEFAULT_MIN_CHUNK_SIZE,
+                              qint64 maxChunkSize = AdaptiveChunkSizer::DEFAULT_MAX_CHUNK_SIZE);
+    // 由生产者线程调用，获取下一个数据块的大小
+    qint64 nextChunkSize();
+
+    // 生产者读取源文件的方式，下一次startTransfer时生效
+    void setSourceMode(ChunkSource::Mode mode);
+    ChunkSource::Mode sourceMode() const;
+    // 并发读取：workerCount个工作任务按rangeSize分区间读取同一个文件，生产者按偏移顺序入队，
+    // 1表示单线程顺序读取。Network模式下每个工作任务使用自己的连接和接收窗口，下一次startTransfer时生效
+    void setRangeWorkers(int workerCount, qint64 rangeSize = ParallelRangeFetcher::DEFAULT_RANGE_SIZE);
+    int rangeWorkers() const;
+    qint64 rangeSize() const;
+    // Network模式下的对端和接收窗口，下一次startTransfer时生效
+    void setNetworkPeer(const NetworkPeer& peer);
+    NetworkPeer networkPeer() const;
+    // IoUring模式下每个数据来源同时在途的读请求数，下一次startTransfer时生效；
+    // 所有数据来源的预读缓冲区合计不超过高水位的1/IO_PREFETCH_DIVISOR，队列越深每个请求越小
+    void setIoQueueDepth(int depth);
+    int ioQueueDepth() const;
+
+    // 获取传输统计信息
+    TransferStatistics statistics() const;
+    // 各阶段的耗时直方图和字节计数，startTransfer时清零。生产者和工作任务通过它记录，
+    // 记录只做原子加，随时可以查询
+    TransferMetrics& metrics();
+    // metrics()的JSON形式
+    QByteArray metricsJson() const;
+
+    // 进度发布间隔：readData只更新计数，transferProgress由GUI线程的定时器按此间隔发出
+    void setProgressInterval(int intervalMs);
+    int progressInterval() const;
+    // 最近一次发布的进度、平滑速率和剩余时间，在GUI线程调用
+    ProgressAggregator::Snapshot progress() const;
+
+    // 流量控制：缓冲字节数超过高水位时生产者阻塞，降到低水位以下再继续
+    void setFlowControl(qint64 highWatermark, qint64 lowWatermark);
+    qint64 highWatermark() const;
+    qint64 lowWatermark() const;
+    // 当前已生产但尚未被readData取走的字节数
+    qint64 getBufferedBytes() const;
+
+    // 磁盘溢出层：缓冲字节数超过高水位时不再阻塞生产者，数据块写入directory下的溢出文件，
+    // 直到降到低水位以下；溢出未读回的数据超过maxSpillBytes（0表示不限）时恢复阻塞。
+    // directory为空时使用系统临时目录，下一次startTransfer时生效
+    void setSpill(bool enabled, const QString& directory = QString(), qint64 maxSpillBytes = 0);
+    bool isSpillEnabled() const;
+
+    // 压缩层：数据块由threadCount个工作线程（0表示按CPU核数）以level级别压缩后入队，
+    // 离开队列时解压，缓冲水位、溢出层按压缩后的大小计算。下一次startTransfer时生效
+    void setCompression(bool enabled, int threadCount = 0, int level = ChunkCompressor::DEFAULT_LEVEL);
+    bool isCompressionEnabled() const;
+
+    // 端到端校验：生产者为每个数据块计算CRC32C，readData一侧由校验线程重新计算，
+    // 读到文件末尾时比较整个文件的摘要。下一次startTransfer时生效
+    void setChecksums(bool enabled);
+    bool isChecksumEnabled() const;
+    // 第fileIndex个文件的校验结果，未启用校验时为Pending
+    ChunkVerifier::FileResult fileVerification(int fileIndex) const;
+    // 等待已提交的校验全部完成，之后fileVerification反映所有已读完文件的结果
+    void waitForVerification();
+
+    // 断点续传：在directory中为每个源文件记录已读取数据块的偏移、长度和CRC32C，不保存数据本身，
+    // CRC由校验线程计算，打开端到端校验时与校验共用。
+    // 停止或取消后再次传输同一个源文件（路径、大小、修改时间都不变）时，先用resumeFile校验接收方
+    // 已写出的部分，源文件只读取剩余部分。被readData完整读完的文件在停止传输时删除检查点。
+    // directory为空时使用系统临时目录，下一次startTransfer时生效
+    void setCheckpoints(bool enabled, const QString& directory = QString());
+    bool isCheckpointEnabled() const;
+    // 在startTransfer之前对要续传的文件调用，partial为接收方上次写出的部分文件（须可读）。
+    // 按检查点逐块校验partial，返回校验通过的前缀长度，接收方应把partial截断到这个长度再继续写入；
+    // 下一次startTransfer中该文件从这个偏移开始生产，readData也从这里开始读取。
+    // 未启用检查点、没有可用的记录或检查点正被另一个会话使用时返回0
+    qint64 resumeFile(const TransferFile& file, QIODevice& partial);
+
+    // 获取文件信息，不带下标的版本返回第一个文件名和所有文件的总大小
+    QString getFileName() const;
+    qint64 getFileSize() const;
+    int getFileCount() const;
+    QString getFileName(int fileIndex) const;
+    qint64 getFileSize(int fileIndex) const;
+    qint64 getTotalReadBytes() const;
+
+    // 检查是否传输完成
+    bool isTransferComplete() const;
+    // 传输尚未停止（未取消、未超时），数据暂时读不到时可以继续等待
+    bool isTransferActive() const {
+        return transferActive_;
+    }
+
+signals:
+    // 按固定频率发出，bytesPerSecond为平滑后的速率，etaMs为-1表示剩余时间未知
+    void transferProgress(qint64 bytesTransferred, qint64 totalBytes, qint64 bytesPerSecond, qint64 etaMs);
+    void transferFinished();
+
+public slots:
+    // 由生产者线程调用，不阻塞：数据块入队后返回true；缓冲区超过高水位或传输已停止时返回false，
+    // chunk留给下一次调用（写入溢出层后变为溢出标记），消费者腾出空间后通过DataProducerThread::resume
+    // 让生产者重新提交
+    bool tryEnqueueChunk(DataChunk& chunk);
+    void onTransferComplete();
+    // 由生产者线程调用，一个补读区间已全部入队（ok为true）或失败
+    void onRangeProduced(bool ok);
+    void onProducerFinished();
+
+private:
+    // 消费者线程是否有可读数据
+    bool hasReadableData() const;
+    // 顺序生产已结束且没有未完成的补读
+    bool isProductionFinished() const;
+    // 从队列取出一个数据块放入缓存，队列为空时返回false
+    // enqueuedNs不为空时更新为取出的数据块中最早的入队时间
+    bool consumeQueuedChunk(qint64* enqueuedNs = nullptr);
+    // 缓存缺失时按需请求补读并等待，等待期间释放consumerLocker，返回false表示本次读取应立即返回
+    bool waitForMissingData(int fileIndex, qint64 position, qint64 length, QMutexLocker& consumerLocker);
+    // 阻塞等待数据到达、传输结束、取消或超时，返回false表示没有等到数据
+    bool waitForData();
+    // 生产者入队后唤醒等待中的消费者，只有消费者在等待时才加锁
+    void notifyDataAvailable();
+    // 无条件唤醒消费者，用于完成、停止和取消
+    void wakeConsumer();
+    // 缓冲区有空间时返回true，markerOnly为true时只需要队列有空位；
+    // 没有空间时登记生产者在等待，消费者腾出空间后由notifySpaceAvailable重新提交生产者
+    bool reserveSpace(qint64 chunkSize, bool markerOnly);
+    // 按高低水位判断是否有空间，调用时须持有spaceMutex_
+    bool hasSpaceLocked(qint64 chunkSize, bool markerOnly);
+    // 由生产者调用，判断该数据块是否写入溢出层
+    bool shouldSpill(qint64 chunkSize);
+    // 消费者取走数据后重新提交因背压让出线程的生产者
+    void notifySpaceAvailable();
+    // 检查点目录，未设置时为系统临时目录下的子目录
+    QString effectiveCheckpointDirectory() const;
+    // 按高水位限制缓冲池空闲链表的大小
+    void updateBufferPoolLimit();
+    // 跳过已完成和空的文件，调用时须持有m_mutex
+    void advanceExpectedFileLocked();
+
+    // GUI线程中等待时每隔多久处理一次事件，保持界面响应
+    static const int WAIT_SLICE_MS = 50;
+
+    // 默认高低水位
+    static const qint64 DEFAULT_HIGH_WATERMARK = 64 * 1024 * 1024;
+    static const qint64 DEFAULT_LOW_WATERMARK = 32 * 1024 * 1024;
+    // io_uring预读缓冲区合计占高水位的比例的倒数
+    static const int IO_PREFETCH_DIVISOR = 4;
+
+    // 队列容量（数据块个数），队列满时生产者等待
+    static const int MAX_QUEUE_SIZE = 1024;
+
+    // 数据块缓冲池，须在队列之前构造、之后销毁
+    ChunkBufferPool bufferPool_;
+
+    // 生产者线程与readData之间的无锁队列
+    SpscChunkRing dataQueue_;
+    // 队列只允许一个消费者，同时读取多个文件的readData在取出数据块和更新读取状态时互斥，
+    // 等待数据时不持有
+    QMutex consumerMutex_;
+    // 从队列取出的数据块按偏移保存在缓存中，部分读取和重复读取都不移动或复制数据块
+    ChunkCache chunkCache_;
+    TransferFileList files_;
+    qint64 fileSize_;
+    qint64 totalBytesRead_;
+    // 每个文件被readData读到的最大偏移，用于进度，持有consumerMutex_时访问
+    std::vector<qint64> fileBytesRead_;
+    // 每个文件已从队列按顺序取出的字节数，即顺序生产的前沿，持有consumerMutex_时访问
+    std::vector<qint64> fileBytesQueued_;
+    // 最近一次补读请求，补读未完成前不重复请求同一区间
+    int refillFileIndex_;
+    qint64 refillBegin_;
+    qint64 refillEnd_;
+    // 失败的补读区间个数，补读失败后readData不再为同一缺失重试
+    std::atomic<qint64> refillFailures_;
+    std::atomic<bool> transferActive_;
+    std::atomic<bool> m_transferComplete;
+
+    std::vector<bool> file_transfer_completed_;
+    std::atomic<int> next_expected_file_;
+
+    DataProducerThread* producerThread_;
+    QThreadPool* threadPool_;
+    TransferScheduler* scheduler_;
+    int priority_;
+    StreamSink* streamSink_;
+    mutable QMutex m_mutex;
+
+    // 消费者等待数据用的条件变量，生产者不在每个数据块上争用该锁
+    QMutex waitMutex_;
+    QWaitCondition dataAvailable_;
+    // 正在等待数据的readData个数，多个文件的读取方可能同时等待
+    std::atomic<int> consumersWaiting_;
+    std::atomic<bool> readCancelled_;
+    std::atomic<int> readTimeout_;
+
+    // 背压：缓冲区超过高水位时生产者让出线程，spaceMutex_保护高低水位
+    QMutex spaceMutex_;
+    std::atomic<bool> producerWaiting_;
+    // 生产者开始等待背压的时间，没有在等待时为-1，仅生产者线程访问
+    qint64 producerWaitStartNs_;
+    std::atomic<qint64> bufferedBytes_;
+    std::atomic<qint64> peakBufferedBytes_;
+    qint64 highWatermark_;
+    qint64 lowWatermark_;
+    // 超过高水位后直到降到低水位前保持阻塞，消费者据此减少无效唤醒
+    std::atomic<bool> producerThrottled_;
+
+    // 磁盘溢出层，生产者追加、消费者读回，仅在生产者停止时创建和销毁
+    SpillFile* spillFile_;
+    // 压缩层，与溢出层一样仅在生产者停止时创建和销毁
+    ChunkCompressor* chunkCompressor_;
+    bool compressionEnabled_;
+    int compressionThreads_;
+    int compressionLevel_;
+    // 校验层，与压缩层一样仅在生产者停止时创建和销毁
+    ChunkVerifier* chunkVerifier_;
+    bool checksumsEnabled_;
+    TransferMetrics metrics_;
+    ProgressAggregator progress_;
+    bool checkpointsEnabled_;
+    QString checkpointDirectory_;
+    // resumeFile校验过的续传位置（按源文件路径）和丢弃的字节数，下一次startTransfer时取用
+    QHash<QString, qint64> pendingResume_;
+    qint64 pendingInvalidBytes_;
+    // 本次传输从续传位置开始，之前的字节数不计入readData返回的字节数
+    TransferCheckpoint::Statistics resumeStats_;
+    bool spillEnabled_;
+    QString spillDirectory_;
+    qint64 maxSpillBytes_;
+    // 正在溢出，降到低水位以下才回到内存，使溢出的数据块在文件中连续，仅生产者线程访问
+    bool spilling_;
+
+    PacingPolicy pacingPolicy_;
+    ChunkSource::Mode sourceMode_;
+    NetworkPeer networkPeer_;
+    int ioQueueDepth_;
+    int rangeWorkers_;
+    qint64 rangeSize_;
+    AdaptiveChunkSizer chunkSizer_;
+
+    // 聚合读取配置
+    bool gatherEnabled_;
+    qint64 minimumFill_;
+
+    // 统计计数，仅消费者线程写入
+    std::atomic<qint64> readCalls_;
+    std::atomic<qint64> chunksConsumed_;
+    std::atomic<qint64> refillRequests_;
+};
+
+} // namespace clipboard
@@ -0,0 +1,269 @@
+#include "FileChunkSource.h"
+#include "TcpChunkSource.h"
+#include "UringFileSource.h"
+#include <QDebug>
+
+namespace clipboard {
+
+ChunkSource* ChunkSource::create(Mode mode, const NetworkPeer& peer, int queueDepth, qint64 prefetchBudget)
+{
+    if (mode == MemoryMapped) {
+        return new MappedFileSource();
+    }
+    if (mode == Network) {
+        return new TcpChunkSource(peer);
+    }
+    if (mode == IoUring) {
+        return new UringFileSource(queueDepth, UringFileSource::blockSizeFor(queueDepth, prefetchBudget));
+    }
+    return new BufferedFileSource();
+}
+
+bool ChunkSource::readFromFile(QFile& file, qint64 maxSize, DataChunk& chunk)
+{
+    chunk.owner.reset();
+    if (!bufferPool_) {
+        chunk.buffer.reset();
+        chunk.data = file.read(maxSize);
+        return !chunk.data.isEmpty();
+    }
+
+    chunk.data.clear();
+    chunk.buffer = bufferPool_->acquire(maxSize);
+    qint64 bytesRead = file.read(chunk.buffer.data(), maxSize);
+    if (bytesRead <= 0) {
+        chunk.buffer.reset();
+        return false;
+    }
+    chunk.buffer.setSize(bytesRead);
+    return true;
+}
+
+//////////////////////////////////////////////////////
+bool BufferedFileSource::open(const QString& filePath)
+{
+    file_.setFileName(filePath);
+    return file_.open(QIODevice::ReadOnly);
+}
+
+void BufferedFileSource::close()
+{
+    file_.close();
+}
+
+bool BufferedFileSource::readChunk(qint64 maxSize, DataChunk& chunk)
+{
+    return readFromFile(file_, maxSize, chunk);
+}
+
+bool BufferedFileSource::seek(qint64 offset)
+{
+    return file_.seek(offset);
+}
+
+bool BufferedFileSource::atEnd() const
+{
+    return file_.atEnd();
+}
+
+QString BufferedFileSource::errorString() const
+{
+    return file_.errorString();
+}
+
+//////////////////////////////////////////////////////
+// 映射窗口与生产者共享的文件对象，QFile不是线程安全的，map/unmap需要加锁
+struct MappedFileSource::SharedFile
+{
+    QMutex mutex;
+    QFile file;
+};
+
+class MappedFileSource::Window
+{
+public:
+    Window(const std::shared_ptr<SharedFile>& file, uchar* data, qint64 size)
+        : file_(file)
+        , data_(data)
+        , size_(size)
+    {
+    }
+
+    ~Window()
+    {
+        QMutexLocker locker(&file_->mutex);
+        file_->file.unmap(data_);
+    }
+
+    const char* data() const {
+        return reinterpret_cast<const char*>(data_);
+    }
+    qint64 size() const {
+        return size_;
+    }
+
+private:
+    std::shared_ptr<SharedFile> file_;
+    uchar* data_;
+    qint64 size_;
+};
+
+MappedFileSource::MappedFileSource(qint64 windowSize)
+    : windowSize_(windowSize)
+    , windowOffset_(0)
+    , position_(0)
+    , fileSize_(0)
+    , fallback_(false)
+{
+}
+
+MappedFileSource::~MappedFileSource()
+{
+    close();
+}
+
+bool MappedFileSource::open(const QString& filePath)
+{
+    close();
+
+    file_ = std::make_shared<SharedFile>();
+    file_->file.setFileName(filePath);
+    if (!file_->file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    fileSize_ = file_->file.size();
+    position_ = 0;
+    windowOffset_ = 0;
+    fallback_ = false;
+    error_.clear();
+
+    // 顺序设备（管道、套接字等）无法映射，直接退回缓冲读取
+    if (file_->file.isSequential() || (fileSize_ > 0 && !mapNextWindow())) {
+        qDebug() << "map file failed, fallback to buffered read:" << filePath;
+        fallback_ = true;
+    }
+    return true;
+}
+
+void MappedFileSource::close()
+{
+    // 只释放自己的引用，仍被数据块引用的窗口和文件在数据块释放后关闭
+    window_.reset();
+    file_.reset();
+}
+
+bool MappedFileSource::readChunk(qint64 maxSize, DataChunk& chunk)
+{
+    if (!file_) {
+        return false;
+    }
+    if (fallback_) {
+        return readBuffered(maxSize, chunk);
+    }
+    if (position_ >= fileSize_) {
+        return false;
+    }
+
+    if (!window_ || position_ >= windowOffset_ + window_->size()) {
+        if (!mapNextWindow()) {
+            qDebug() << "map window failed at" << position_ << ", fallback to buffered read";
+            fallback_ = true;
+            return readBuffered(maxSize, chunk);
+        }
+    }
+
+    qint64 offsetInWindow = position_ - windowOffset_;
+    qint64 size = qMin(maxSize, window_->size() - offsetInWindow);
+    // 映射之后被截断的部分访问时会触发SIGBUS，交出视图前确认文件仍然足够大
+    if (!coversRange(position_ + size)) {
+        return false;
+    }
+    chunk.buffer.reset();
+    chunk.data = QByteArray::fromRawData(window_->data() + offsetInWindow, static_cast<int>(size));
+    chunk.owner = window_;
+    position_ += size;
+    return true;
+}
+
+bool MappedFileSource::seek(qint64 offset)
+{
+    if (!file_ || offset < 0 || offset > fileSize_) {
+        return false;
+    }
+    // 新位置不在当前窗口内时，下一次readChunk从offset处映射新窗口
+    if (window_ && (offset < windowOffset_ || offset >= windowOffset_ + window_->size())) {
+        window_.reset();
+    }
+    position_ = offset;
+    return true;
+}
+
+bool MappedFileSource::atEnd() const
+{
+    return position_ >= fileSize_;
+}
+
+QString MappedFileSource::errorString() const
+{
+    if (!file_) {
+        return QString();
+    }
+    if (!error_.isEmpty()) {
+        return error_;
+    }
+    QMutexLocker locker(&file_->mutex);
+    return file_->file.errorString();
+}
+
+bool MappedFileSource::mapNextWindow()
+{
+    window_.reset();
+    qint64 size = qMin(windowSize_, fileSize_ - position_);
+    if (size <= 0) {
+        return false;
+    }
+
+    uchar* data = nullptr;
+    {
+        QMutexLocker locker(&file_->mutex);
+        data = file_->file.map(position_, size);
+    }
+    if (!data) {
+        return false;
+    }
+
+    window_ = std::make_shared<Window>(file_, data, size);
+    windowOffset_ = position_;
+    return true;
+}
+
+bool MappedFileSource::coversRange(qint64 end)
+{
+    qint64 size = 0;
+    {
+        QMutexLocker locker(&file_->mutex);
+        size = file_->file.size();
+    }
+    if (size < end) {
+        error_ = QStringLiteral("file truncated to %1 bytes while mapped").arg(size);
+        qWarning() << "mapped file truncated:" << size << "<" << end;
+        return false;
+    }
+    return true;
+}
+
+bool MappedFileSource::readBuffered(qint64 maxSize, DataChunk& chunk)
+{
+    QMutexLocker locker(&file_->mutex);
+    if (!file_->file.seek(position_)) {
+        return false;
+    }
+    if (!readFromFile(file_->file, maxSize, chunk)) {
+        return false;
+    }
+    position_ += chunk.size();
+    return true;
+}
+
+} // namespace clipboard
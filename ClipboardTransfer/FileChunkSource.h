@@ -0,0 +1,69 @@
+#pragma once
+#include "ChunkSource.h"
+#include <QFile>
+#include <QMutex>
+#include <memory>
+
+namespace clipboard {
+
+// 普通缓冲读取：每个数据块一次堆分配和一次内核到用户态的复制
+class BufferedFileSource : public ChunkSource
+{
+public:
+    bool open(const QString& filePath) override;
+    void close() override;
+    bool readChunk(qint64 maxSize, DataChunk& chunk) override;
+    bool seek(qint64 offset) override;
+    bool atEnd() const override;
+    QString errorString() const override;
+
+private:
+    QFile file_;
+};
+
+// 内存映射读取：按窗口映射源文件，数据块是映射内存上的零拷贝视图
+// 每个窗口在引用它的最后一个数据块释放后才解除映射
+// 视图在readData复制之前（包括在缓存中）一直引用映射内存，源文件在此期间被截断时访问视图会触发SIGBUS；
+// readChunk在交出视图前检查文件大小，发现截断时报错，但无法覆盖交出之后的截断，
+// 因此只应在传输期间不会被其他进程改写的文件上使用该模式
+class MappedFileSource : public ChunkSource
+{
+public:
+    explicit MappedFileSource(qint64 windowSize = DEFAULT_WINDOW_SIZE);
+    ~MappedFileSource();
+
+    bool open(const QString& filePath) override;
+    void close() override;
+    bool readChunk(qint64 maxSize, DataChunk& chunk) override;
+    bool seek(qint64 offset) override;
+    bool atEnd() const override;
+    QString errorString() const override;
+
+    // 是否因文件不可映射而退回了缓冲读取
+    bool isFallback() const {
+        return fallback_;
+    }
+
+    // 单个映射窗口的大小，限制占用的地址空间
+    static const qint64 DEFAULT_WINDOW_SIZE = 64 * 1024 * 1024;
+
+private:
+    struct SharedFile;
+    class Window;
+
+    bool mapNextWindow();
+    bool readBuffered(qint64 maxSize, DataChunk& chunk);
+    // 文件当前大小是否仍覆盖[position_, end)
+    bool coversRange(qint64 end);
+
+    std::shared_ptr<SharedFile> file_;
+    std::shared_ptr<Window> window_;
+    qint64 windowSize_;
+    qint64 windowOffset_;
+    qint64 position_;
+    qint64 fileSize_;
+    bool fallback_;
+    QString error_;
+};
+
+} // namespace clipboard
@@ -0,0 +1,10 @@
+# 不含Windows界面和剪贴板的构建：传输核心静态库、基准测试程序和单元测试
+TEMPLATE = subdirs
+
+SUBDIRS = core bench tests
+
+core.file = TransferCore.pro
+bench.file = bench/TransferBench.pro
+bench.depends = core
+tests.file = tests/tests.pro
+tests.depends = core
@@ -0,0 +1,310 @@
+#include "LazyMimeData.h"
+#include "FileBufferManager.h"
+#include <QBuffer>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QMimeDatabase>
+#include <QPointer>
+#include <QStorageInfo>
+#include <QThread>
+#include <QTimer>
+#include <atomic>
+#include <vector>
+
+namespace clipboard {
+
+namespace {
+const char* const kUriListMimeType = "text/uri-list";
+// GNOME系文件管理器粘贴文件时读取的格式
+const char* const kGnomeCopiedFilesMimeType = "x-special/gnome-copied-files";
+// 每次readData请求的大小
+const qint64 kRenderBlockSize = 1024 * 1024;
+// 等待渲染时检查进度的间隔
+const int kRenderPollMs = 100;
+}
+
+// 渲染线程与等待它的retrieveData共享，LazyMimeData在等待期间析构时仍然有效
+struct LazyMimeData::RenderState
+{
+    std::atomic<bool> cancelled{false};
+    std::atomic<qint64> renderedBytes{0};
+    // 渲染线程的结果，线程结束后读取
+    bool succeeded = false;
+    QThread* worker = nullptr;
+};
+
+LazyMimeData::LazyMimeData(const std::shared_ptr<FileBufferManager>& session, const TransferFileList& files,
+                           const QString& stagingDirectory)
+    : session_(session)
+    , files_(files)
+    , stagingDirectory_(stagingDirectory)
+    , renderTimeout_(DEFAULT_RENDER_TIMEOUT_MS)
+    , stagingEnabled_(false)
+    , renderedBytes_(0)
+{
+    if (files_.size() == 1 && files_.first().fileSize <= MAX_INLINE_CONTENT_SIZE) {
+        QMimeType type = QMimeDatabase().mimeTypeForFile(files_.first().fileName, QMimeDatabase::MatchExtension);
+        if (type.isValid() && type.name() != QLatin1String(kUriListMimeType)) {
+            contentMimeType_ = type.name();
+        }
+    }
+}
+
+LazyMimeData::~LazyMimeData()
+{
+    // 等待渲染期间剪贴板被其他程序接管：取消渲染，等渲染线程不再写落地目录后再随stagingDir_删除
+    if (activeRender_) {
+        activeRender_->cancelled.store(true);
+        session_->cancelRead();
+        activeRender_->worker->wait();
+    }
+}
+
+void LazyMimeData::setRenderTimeout(int msecs)
+{
+    renderTimeout_ = msecs;
+}
+
+int LazyMimeData::renderTimeout() const
+{
+    return renderTimeout_;
+}
+
+void LazyMimeData::setStagingEnabled(bool enabled)
+{
+    stagingEnabled_ = enabled;
+}
+
+bool LazyMimeData::isStagingEnabled() const
+{
+    return stagingEnabled_;
+}
+
+QStringList LazyMimeData::formats() const
+{
+    QStringList result;
+    if (stagingEnabled_) {
+        result << QLatin1String(kUriListMimeType) << QLatin1String(kGnomeCopiedFilesMimeType);
+    }
+    if (!contentMimeType_.isEmpty()) {
+        result << contentMimeType_;
+    }
+    return result;
+}
+
+bool LazyMimeData::hasFormat(const QString& mimeType) const
+{
+    return formats().contains(mimeType);
+}
+
+QVariant LazyMimeData::retrieveData(const QString& mimeType, QVariant::Type preferredType) const
+{
+    qDebug() << "retrieveData:" << mimeType << preferredType;
+
+    if (!stagingEnabled_
+        && (mimeType == QLatin1String(kUriListMimeType) || mimeType == QLatin1String(kGnomeCopiedFilesMimeType))) {
+        return QVariant();
+    }
+
+    if (mimeType == QLatin1String(kUriListMimeType)) {
+        QList<QUrl> urls = materialize();
+        if (preferredType == QVariant::List) {
+            QList<QVariant> list;
+            for (const QUrl& url : urls) {
+                list << url;
+            }
+            return list;
+        }
+        QByteArray data;
+        for (const QUrl& url : urls) {
+            data += url.toEncoded() + "\r\n";
+        }
+        return data;
+    }
+
+    if (mimeType == QLatin1String(kGnomeCopiedFilesMimeType)) {
+        QByteArray data("copy");
+        for (const QUrl& url : materialize()) {
+            data += '\n' + url.toEncoded();
+        }
+        return data;
+    }
+
+    if (!contentMimeType_.isEmpty() && mimeType == contentMimeType_) {
+        const std::shared_ptr<FileBufferManager> session = session_;
+        const TransferFile file = files_.first();
+        // runRender返回前渲染线程已经结束
+        QByteArray data;
+        const bool rendered = runRender([session, file, &data](RenderState& state) {
+            data.reserve(static_cast<int>(file.fileSize));
+            QBuffer buffer(&data);
+            buffer.open(QIODevice::WriteOnly);
+            return renderFile(*session, file, 0, buffer, state);
+        });
+        if (!rendered) {
+            return QVariant();
+        }
+        return data;
+    }
+
+    return QVariant();
+}
+
+bool LazyMimeData::runRender(const std::function<bool(RenderState&)>& job) const
+{
+    if (activeRender_) {
+        // 等待渲染的局部事件循环中再次请求数据，不嵌套渲染
+        qWarning() << "retrieveData re-entered while rendering";
+        return false;
+    }
+
+    std::shared_ptr<RenderState> state = std::make_shared<RenderState>();
+    std::shared_ptr<FileBufferManager> session = session_;
+    const int timeout = renderTimeout_;
+    QThread* worker = QThread::create([job, state]() {
+        state->succeeded = job(*state);
+    });
+    state->worker = worker;
+    activeRender_ = state;
+    QPointer<LazyMimeData> guard(const_cast<LazyMimeData*>(this));
+    worker->start();
+
+    // 渲染有进展就一直等待，超过timeout没有新数据时取消，取消会打断阻塞在readData中的渲染线程
+    qint64 lastRendered = 0;
+    QElapsedTimer sinceProgress;
+    sinceProgress.start();
+    auto checkProgress = [&]() {
+        const qint64 rendered = state->renderedBytes.load();
+        if (rendered != lastRendered) {
+            lastRendered = rendered;
+            sinceProgress.restart();
+        } else if (timeout >= 0 && sinceProgress.elapsed() > timeout && !state->cancelled.exchange(true)) {
+            qWarning() << "render stalled for" << timeout << "ms, cancel";
+            session->cancelRead();
+        }
+    };
+
+    QCoreApplication* app = QCoreApplication::instance();
+    if (app && QThread::currentThread() == app->thread()) {
+        // GUI线程：局部事件循环保持界面刷新，不处理用户输入，避免等待中再次发起粘贴
+        QEventLoop loop;
+        QTimer poll;
+        QObject::connect(worker, &QThread::finished, &loop, &QEventLoop::quit);
+        QObject::connect(&poll, &QTimer::timeout, checkProgress);
+        poll.start(kRenderPollMs);
+        if (!worker->isFinished()) {
+            loop.exec(QEventLoop::ExcludeUserInputEvents);
+        }
+    } else {
+        while (!worker->wait(kRenderPollMs)) {
+            checkProgress();
+        }
+    }
+    worker->wait();
+    delete worker;
+
+    const bool succeeded = state->succeeded && !state->cancelled.load();
+    if (!guard) {
+        // 等待期间本对象已被剪贴板释放，析构函数已取消渲染
+        return false;
+    }
+    activeRender_.reset();
+    renderedBytes_ += state->renderedBytes.load();
+    return succeeded;
+}
+
+bool LazyMimeData::renderFile(FileBufferManager& session, const TransferFile& file, int index,
+                              QIODevice& out, RenderState& state)
+{
+    const qint64 fileSize = file.fileSize;
+    std::vector<char> block(static_cast<size_t>(kRenderBlockSize));
+
+    qint64 offset = 0;
+    while (offset < fileSize) {
+        if (state.cancelled.load()) {
+            qWarning() << "render file cancelled:" << file.fileName << offset << "/" << fileSize;
+            return false;
+        }
+        // readData一直等到有数据，返回0说明传输已停止、被取消或超时，返回负数说明读取出错
+        qint64 bytesRead = session.readData(index, offset, block.data(), qMin(kRenderBlockSize, fileSize - offset));
+        if (bytesRead <= 0) {
+            qWarning() << "render file stopped:" << file.fileName << offset << "/" << fileSize;
+            return false;
+        }
+        if (out.write(block.data(), bytesRead) != bytesRead) {
+            qWarning() << "render file write failed:" << out.errorString();
+            return false;
+        }
+        offset += bytesRead;
+        state.renderedBytes.fetch_add(bytesRead);
+    }
+    return true;
+}
+
+QList<QUrl> LazyMimeData::materialize() const
+{
+    if (!urls_.isEmpty()) {
+        return urls_;
+    }
+
+    QString base = stagingDirectory_.isEmpty() ? QDir::tempPath() : stagingDirectory_;
+    // 所有文件都要完整写入暂存目录，空间不足时直接失败，不写到一半才出错
+    qint64 totalSize = 0;
+    for (const TransferFile& file : files_) {
+        totalSize += file.fileSize;
+    }
+    QStorageInfo storage(base);
+    if (storage.isValid() && storage.bytesAvailable() < totalSize) {
+        qWarning() << "not enough space to stage files:" << base << storage.bytesAvailable() << "<" << totalSize;
+        return QList<QUrl>();
+    }
+    stagingDir_.reset(new QTemporaryDir(QDir(base).filePath("ClipboardTransfer-XXXXXX")));
+    if (!stagingDir_->isValid()) {
+        qWarning() << "create staging directory failed:" << stagingDir_->errorString();
+        return QList<QUrl>();
+    }
+
+    QStringList paths;
+    for (const TransferFile& file : files_) {
+        paths << stagingDir_->filePath(file.fileName);
+    }
+
+    // 文件按lindex顺序经过同一个队列，也按这个顺序渲染
+    const std::shared_ptr<FileBufferManager> session = session_;
+    const TransferFileList files = files_;
+    QPointer<LazyMimeData> guard(const_cast<LazyMimeData*>(this));
+    const bool rendered = runRender([session, files, &paths](RenderState& state) {
+        for (int index = 0; index < files.size(); ++index) {
+            QFile file(paths.at(index));
+            if (!file.open(QIODevice::WriteOnly)) {
+                qWarning() << "create staged file failed:" << paths.at(index) << file.errorString();
+                return false;
+            }
+            if (!renderFile(*session, files.at(index), index, file, state)) {
+                return false;
+            }
+        }
+        return true;
+    });
+    if (!guard) {
+        return QList<QUrl>();
+    }
+    if (!rendered) {
+        // 删除部分写出的文件，粘贴方不会拿到截断的文件，下次请求重新渲染
+        stagingDir_.reset();
+        return QList<QUrl>();
+    }
+
+    QList<QUrl> urls;
+    for (const QString& path : paths) {
+        urls << QUrl::fromLocalFile(path);
+    }
+    urls_ = urls;
+    return urls_;
+}
+
+} // namespace clipboard
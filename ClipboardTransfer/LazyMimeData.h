@@ -0,0 +1,86 @@
+#pragma once
+#include "TransferFile.h"
+#include <QMimeData>
+#include <QStringList>
+#include <QTemporaryDir>
+#include <QUrl>
+#include <functional>
+#include <memory>
+
+class QIODevice;
+
+namespace clipboard {
+
+class FileBufferManager;
+
+// 按需渲染的剪贴板数据，与VirtualFileSrcStream并列的另一种呈现方式（Linux等非Windows平台）
+// 只声明text/uri-list和文件的MIME类型，粘贴方真正调用retrieveData时才从FileBufferManager
+// 读取数据，发布一个数GB的文件在粘贴之前不产生任何读取
+//
+// 数据在单独的渲染线程中读取，GUI线程上的retrieveData只运行不处理用户输入的局部事件循环等待它，
+// readData不会在GUI线程上阻塞。传输停止、被取消或超过渲染超时没有进展时retrieveData返回空的QVariant，
+// 已写出的部分文件被删除，粘贴方不会拿到截断的文件
+//
+// QMimeData只能一次返回完整的数据，无法边读边交给粘贴方：文件的MIME类型把整个文件读入内存，
+// 因此只对不超过MAX_INLINE_CONTENT_SIZE的单个文件提供；text/uri-list需要先把所有文件完整写入暂存目录，
+// 粘贴方在此期间一直等待，暂存目录须有与文件总大小相同的空闲空间，磁盘上同时存在一份副本。
+// 暂存需要用setStagingEnabled显式打开，关闭时不提供text/uri-list，暂存目录空间不足时粘贴失败
+class LazyMimeData : public QMimeData
+{
+public:
+    // 从session读取files的数据；stagingDirectory为text/uri-list落地文件的目录，为空时使用系统临时目录
+    LazyMimeData(const std::shared_ptr<FileBufferManager>& session, const TransferFileList& files,
+                 const QString& stagingDirectory = QString());
+    // 正在渲染时取消并等待渲染线程退出
+    ~LazyMimeData();
+
+    QStringList formats() const override;
+    bool hasFormat(const QString& mimeType) const override;
+
+    // 已经渲染（从FileBufferManager读出）的字节数
+    qint64 renderedBytes() const {
+        return renderedBytes_;
+    }
+
+    // 是否提供需要把文件落地到暂存目录的text/uri-list，默认关闭；须在发布到剪贴板之前设置
+    void setStagingEnabled(bool enabled);
+    bool isStagingEnabled() const;
+
+    // 渲染连续多久读不到数据即放弃（毫秒），-1表示一直等待直到传输停止
+    void setRenderTimeout(int msecs);
+    int renderTimeout() const;
+
+    // 单个文件不超过该大小时才直接以文件的MIME类型提供内容，QByteArray和选择区传输都有上限
+    static const qint64 MAX_INLINE_CONTENT_SIZE = 512 * 1024 * 1024;
+    static const int DEFAULT_RENDER_TIMEOUT_MS = 30 * 1000;
+
+protected:
+    QVariant retrieveData(const QString& mimeType, QVariant::Type preferredType) const override;
+
+private:
+    struct RenderState;
+
+    // 在渲染线程中运行job并等待它结束，失败、取消或超时返回false
+    bool runRender(const std::function<bool(RenderState&)>& job) const;
+    // 把第index个文件的全部数据从session读到out，在渲染线程中调用
+    static bool renderFile(FileBufferManager& session, const TransferFile& file, int index,
+                           QIODevice& out, RenderState& state);
+    // 在临时目录中按原文件名写出所有文件，返回它们的URL，只渲染一次
+    QList<QUrl> materialize() const;
+
+    std::shared_ptr<FileBufferManager> session_;
+    TransferFileList files_;
+    QString stagingDirectory_;
+    // 可以直接提供内容的MIME类型，只对单个文件有效
+    QString contentMimeType_;
+    int renderTimeout_;
+    bool stagingEnabled_;
+
+    mutable std::unique_ptr<QTemporaryDir> stagingDir_;
+    mutable QList<QUrl> urls_;
+    mutable qint64 renderedBytes_;
+    // 正在进行的渲染，析构时据此取消
+    mutable std::shared_ptr<RenderState> activeRender_;
+};
+
+} // namespace clipboard
@@ -0,0 +1,11 @@
+# 按需渲染的QMimeData呈现端，非Windows程序、基准测试和它的单元测试共用；
+# 不属于传输核心，渲染线程和等待粘贴方的事件循环都在呈现一侧
+
+INCLUDEPATH += $$PWD
+DEPENDPATH += $$PWD
+
+SOURCES += \
+     $$PWD/LazyMimeData.cpp
+
+HEADERS += \
+     $$PWD/LazyMimeData.h
@@ -0,0 +1,19 @@
+#include "MimeDataSink.h"
+#include "LazyMimeData.h"
+#include <QClipboard>
+#include <QDebug>
+#include <QGuiApplication>
+
+namespace clipboard {
+
+void MimeDataSink::publish(const std::shared_ptr<FileBufferManager>& session, const TransferFileList& files)
+{
+    // 文件管理器只接受text/uri-list，粘贴时文件先完整落地到临时目录
+    LazyMimeData* mimeData = new LazyMimeData(session, files);
+    mimeData->setStagingEnabled(true);
+    // 剪贴板接管LazyMimeData的所有权，下次setMimeData或程序退出时释放，会话随之释放
+    QGuiApplication::clipboard()->setMimeData(mimeData);
+    qDebug() << "publish files to clipboard:" << files.size();
+}
+
+} // namespace clipboard
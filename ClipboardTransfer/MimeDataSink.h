@@ -0,0 +1,13 @@
+#pragma once
+#include "StreamSink.h"
+
+namespace clipboard {
+
+// 通过QClipboard发布LazyMimeData，粘贴方取数据时才从传输队列读取（非Windows平台）
+class MimeDataSink : public StreamSink
+{
+public:
+    void publish(const std::shared_ptr<FileBufferManager>& session, const TransferFileList& files) override;
+};
+
+} // namespace clipboard
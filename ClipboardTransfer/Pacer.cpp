@@ -0,0 +1,125 @@
+#include "Pacer.h"
+#include <QRandomGenerator>
+
+namespace clipboard {
+
+PacingPolicy PacingPolicy::unlimited()
+{
+    return PacingPolicy();
+}
+
+PacingPolicy PacingPolicy::tokenBucket(qint64 bytesPerSecond, qint64 burstBytes)
+{
+    PacingPolicy policy;
+    policy.mode = TokenBucket;
+    policy.bytesPerSecond = bytesPerSecond;
+    policy.burstBytes = burstBytes;
+    return policy;
+}
+
+PacingPolicy PacingPolicy::simulatedNetwork(qint64 bytesPerSecond, int latencyMs, int jitterMs)
+{
+    PacingPolicy policy;
+    policy.mode = SimulatedNetwork;
+    policy.bytesPerSecond = bytesPerSecond;
+    policy.latencyMs = latencyMs;
+    policy.jitterMs = jitterMs;
+    return policy;
+}
+
+Pacer::Pacer()
+    : tokens_(0)
+    , lastRefillNs_(0)
+    , bytesPaced_(0)
+    , startedAtMs_(0)
+    , finishedAtMs_(-1)
+    , finishedBytes_(0)
+{
+    clock_.start();
+}
+
+void Pacer::setPolicy(const PacingPolicy& policy)
+{
+    policy_ = policy;
+}
+
+PacingPolicy Pacer::policy() const
+{
+    return policy_;
+}
+
+void Pacer::reset()
+{
+    // 令牌桶初始为满，允许开始时的突发
+    tokens_ = static_cast<double>(policy_.burstBytes);
+    lastRefillNs_ = clock_.nsecsElapsed();
+    bytesPaced_.store(0);
+    startedAtMs_.store(clock_.elapsed());
+    finishedAtMs_.store(-1);
+}
+
+void Pacer::finish()
+{
+    // 先写字节数，读取方看到结束时间时字节数已经有效
+    finishedBytes_.store(bytesPaced_.load());
+    finishedAtMs_.store(clock_.elapsed());
+}
+
+qint64 Pacer::reserve(qint64 bytes)
+{
+    bytesPaced_.fetch_add(bytes);
+
+    if (policy_.mode == PacingPolicy::Unlimited || policy_.bytesPerSecond <= 0) {
+        return 0;
+    }
+
+    qint64 waitNs = 0;
+    if (policy_.mode == PacingPolicy::SimulatedNetwork && policy_.latencyMs > 0) {
+        // 模拟每个数据块一次请求往返
+        int latencyMs = policy_.latencyMs;
+        if (policy_.jitterMs > 0) {
+            latencyMs += QRandomGenerator::global()->bounded(-policy_.jitterMs, policy_.jitterMs + 1);
+        }
+        waitNs += qMax(latencyMs, 0) * 1000000LL;
+    }
+
+    // 令牌不足时允许透支，按欠额等待，保证单个大块也能通过
+    refill();
+    tokens_ -= bytes;
+    if (tokens_ < 0) {
+        waitNs += static_cast<qint64>(-tokens_ * 1e9 / policy_.bytesPerSecond);
+    }
+    return waitNs;
+}
+
+qint64 Pacer::targetBytesPerSecond() const
+{
+    return policy_.mode == PacingPolicy::Unlimited ? 0 : policy_.bytesPerSecond;
+}
+
+double Pacer::achievedBytesPerSecond() const
+{
+    // 之后的补读也经过节流，但不计入生产阶段的速率
+    const qint64 finishedAtMs = finishedAtMs_.load();
+    const bool finished = finishedAtMs >= 0;
+    const qint64 elapsedMs = (finished ? finishedAtMs : clock_.elapsed()) - startedAtMs_.load();
+    if (elapsedMs <= 0) {
+        return 0.0;
+    }
+    return (finished ? finishedBytes_.load() : bytesPaced_.load()) * 1000.0 / elapsedMs;
+}
+
+void Pacer::refill()
+{
+    qint64 now = clock_.nsecsElapsed();
+    tokens_ += (now - lastRefillNs_) * policy_.bytesPerSecond / 1e9;
+    lastRefillNs_ = now;
+
+    // 模拟网络模式没有额外突发，桶容量为0
+    double capacity = policy_.mode == PacingPolicy::TokenBucket ? static_cast<double>(policy_.burstBytes) : 0.0;
+    if (tokens_ > capacity) {
+        tokens_ = capacity;
+    }
+}
+
+} // namespace clipboard
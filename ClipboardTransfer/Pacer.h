@@ -0,0 +1,65 @@
+#pragma once
+#include <QtGlobal>
+#include <QElapsedTimer>
+#include <atomic>
+
+namespace clipboard {
+
+// 生产者节流策略配置
+struct PacingPolicy
+{
+    enum Mode {
+        Unlimited,          // 不限速，由磁盘和消费者速度决定吞吐
+        TokenBucket,        // 令牌桶：平均bytesPerSecond，允许burstBytes的突发
+        SimulatedNetwork    // 模拟网络：带宽限制加上每个数据块的往返延迟和抖动
+    };
+
+    Mode mode = Unlimited;
+    qint64 bytesPerSecond = 0;
+    qint64 burstBytes = 0;
+    int latencyMs = 0;
+    int jitterMs = 0;
+
+    static PacingPolicy unlimited();
+    static PacingPolicy tokenBucket(qint64 bytesPerSecond, qint64 burstBytes);
+    static PacingPolicy simulatedNetwork(qint64 bytesPerSecond, int latencyMs, int jitterMs = 0);
+};
+
+// 按PacingPolicy对生产者进行节流，并统计实际达到的速率
+class Pacer
+{
+public:
+    Pacer();
+
+    void setPolicy(const PacingPolicy& policy);
+    PacingPolicy policy() const;
+
+    // 每次传输开始前调用，重置令牌和计时
+    void reset();
+    // 顺序生产结束时调用，之后的实际速率按结束时的字节数和时间计算，不再随时间下降
+    void finish();
+
+    // 生产者发送bytes字节前调用，扣除额度并返回发送前还需等待的纳秒数，0表示可以立即发送。
+    // 不休眠：生产任务据此登记到期回调后让出线程
+    qint64 reserve(qint64 bytes);
+
+    // 目标速率（字节/秒），不限速时返回0
+    qint64 targetBytesPerSecond() const;
+    // 自reset到finish（未结束时到现在）实际达到的速率（字节/秒）
+    double achievedBytesPerSecond() const;
+
+private:
+    void refill();
+
+    PacingPolicy policy_;
+    QElapsedTimer clock_;
+    double tokens_;
+    qint64 lastRefillNs_;
+    std::atomic<qint64> bytesPaced_;
+    std::atomic<qint64> startedAtMs_;
+    // finish时的时间和字节数，未结束时为-1
+    std::atomic<qint64> finishedAtMs_;
+    std::atomic<qint64> finishedBytes_;
+};
+
+} // namespace clipboard
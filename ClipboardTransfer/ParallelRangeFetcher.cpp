@@ -0,0 +1,368 @@
+#include "ParallelRangeFetcher.h"
+#include "FileBufferManager.h"
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QRunnable>
+
+namespace clipboard {
+
+class ParallelRangeFetcher::Task : public QRunnable
+{
+public:
+    Task(ParallelRangeFetcher* fetcher, Worker* worker)
+        : fetcher_(fetcher)
+        , worker_(worker)
+    {
+    }
+
+    void run() override {
+        fetcher_->runWorker(*worker_);
+    }
+
+private:
+    ParallelRangeFetcher* fetcher_;
+    Worker* worker_;
+};
+
+ParallelRangeFetcher::ParallelRangeFetcher(FileBufferManager* manager, const std::vector<ChunkSource*>& sources,
+                                           qint64 rangeSize, const std::atomic<bool>& stopFlag)
+    : manager_(manager)
+    , sources_(sources)
+    , threadPool_(nullptr)
+    , rangeSize_(qMax(rangeSize, (qint64)1))
+    , windowSize_(rangeSize_ * WINDOW_RANGES_PER_WORKER * static_cast<qint64>(qMax(sources.size(), (size_t)1)))
+    , stopFlag_(stopFlag)
+    , scheduler_(nullptr)
+    , schedulerTicket_(-1)
+    , fileSize_(0)
+    , runPriority_(0)
+    , consumerWaiting_(false)
+    , reassemblyBytes_(0)
+    , nextRangeOffset_(0)
+    , frontier_(0)
+    , cancelled_(false)
+    , failed_(false)
+{
+    ownThreadPool_.setMaxThreadCount(qMax(static_cast<int>(sources.size()), 1));
+}
+
+ParallelRangeFetcher::~ParallelRangeFetcher()
+{
+    finish();
+}
+
+void ParallelRangeFetcher::setScheduler(TransferScheduler* scheduler, int ticket)
+{
+    scheduler_ = scheduler;
+    schedulerTicket_ = ticket;
+}
+
+void ParallelRangeFetcher::setThreadPool(QThreadPool* pool)
+{
+    threadPool_ = pool;
+}
+
+void ParallelRangeFetcher::setWakeup(const std::function<void()>& wakeup)
+{
+    wakeup_ = wakeup;
+}
+
+void ParallelRangeFetcher::setRunPriority(int priority)
+{
+    QMutexLocker locker(&mutex_);
+    runPriority_ = priority;
+}
+
+QThreadPool* ParallelRangeFetcher::threadPool()
+{
+    return threadPool_ ? threadPool_ : &ownThreadPool_;
+}
+
+void ParallelRangeFetcher::start(const QString& filePath, qint64 fileSize, qint64 startOffset)
+{
+    filePath_ = filePath;
+    fileSize_ = fileSize;
+    nextRangeOffset_ = startOffset;
+    frontier_ = startOffset;
+
+    QMutexLocker locker(&mutex_);
+    for (ChunkSource* source : sources_) {
+        std::unique_ptr<Worker> worker(new Worker());
+        worker->source = source;
+        workers_.push_back(std::move(worker));
+        submitLocked(*workers_.back());
+    }
+}
+
+ParallelRangeFetcher::TakeResult ParallelRangeFetcher::takeNext(DataChunk& chunk)
+{
+    QMutexLocker locker(&mutex_);
+    if (frontier_ >= fileSize_ || failed_ || stopFlag_) {
+        return Finished;
+    }
+    auto it = reassembly_.find(frontier_);
+    if (it == reassembly_.end()) {
+        // 前沿的数据块到达时由工作任务回调
+        consumerWaiting_ = true;
+        return Pending;
+    }
+    chunk = std::move(it->second);
+    reassembly_.erase(it);
+    const qint64 size = chunk.size();
+    reassemblyBytes_ -= size;
+    frontier_ += size;
+    // 前沿推进，等待窗口的工作任务可以领取新区间
+    for (const std::unique_ptr<Worker>& worker : workers_) {
+        if (worker->waitingWindow) {
+            worker->waitingWindow = false;
+            resumeLocked(*worker);
+        }
+    }
+    return Taken;
+}
+
+void ParallelRangeFetcher::finish()
+{
+    {
+        QMutexLocker locker(&mutex_);
+        cancelled_ = true;
+        consumerWaiting_ = false;
+        if (workers_.empty()) {
+            return;
+        }
+        // 提前结束时工作任务可能阻塞在网络来源上
+        if (frontier_ < fileSize_) {
+            for (ChunkSource* source : sources_) {
+                source->interrupt();
+            }
+        }
+    }
+
+    // 调度器在持有自己的锁时回调，不能在持有mutex_时取消
+    if (scheduler_) {
+        for (const std::unique_ptr<Worker>& worker : workers_) {
+            scheduler_->cancelWait(schedulerTicket_, worker.get());
+        }
+    }
+
+    // 让出线程的和还在排队的任务直接收尾，正在运行的任务看到cancelled_后返回
+    std::vector<ChunkSource*> idleSources;
+    QMutexLocker locker(&mutex_);
+    for (const std::unique_ptr<Worker>& worker : workers_) {
+        if (!worker->running) {
+            continue;
+        }
+        bool idle = worker->parked;
+        if (worker->queued && threadPool()->tryTake(worker->queued)) {
+            delete worker->queued;
+            worker->queued = nullptr;
+            idle = true;
+        }
+        if (idle) {
+            worker->parked = false;
+            worker->running = false;
+            if (worker->opened) {
+                worker->opened = false;
+                idleSources.push_back(worker->source);
+            }
+        }
+    }
+    for (;;) {
+        bool running = false;
+        for (const std::unique_ptr<Worker>& worker : workers_) {
+            running = running || worker->running;
+        }
+        if (!running) {
+            break;
+        }
+        workersIdle_.wait(&mutex_);
+    }
+    workers_.clear();
+    reassembly_.clear();
+    reassemblyBytes_ = 0;
+    locker.unlock();
+
+    for (ChunkSource* source : idleSources) {
+        source->close();
+    }
+}
+
+QString ParallelRangeFetcher::errorString() const
+{
+    QMutexLocker locker(&mutex_);
+    return error_;
+}
+
+ParallelRangeFetcher::Statistics ParallelRangeFetcher::statistics() const
+{
+    QMutexLocker locker(&mutex_);
+    return stats_;
+}
+
+void ParallelRangeFetcher::submitLocked(Worker& worker)
+{
+    worker.running = true;
+    worker.queued = new Task(this, &worker);
+    threadPool()->start(worker.queued, runPriority_);
+}
+
+void ParallelRangeFetcher::resumeLocked(Worker& worker)
+{
+    if (worker.parked) {
+        worker.parked = false;
+        submitLocked(worker);
+    } else if (worker.running) {
+        // 任务还在运行，它结束时据此重新提交而不是让出线程
+        worker.resumeRequested = true;
+    }
+}
+
+void ParallelRangeFetcher::resumeWorker(Worker& worker)
+{
+    QMutexLocker locker(&mutex_);
+    resumeLocked(worker);
+}
+
+void ParallelRangeFetcher::runWorker(Worker& worker)
+{
+    {
+        QMutexLocker locker(&mutex_);
+        worker.queued = nullptr;
+        worker.resumeRequested = false;
+    }
+
+    // 每次最多运行一个时间片，之后按runPriority_重新排入线程池队列，与各会话的生产任务轮流使用线程
+    QElapsedTimer slice;
+    slice.start();
+    Step step = Continue;
+    while (step == Continue && slice.elapsed() < TIME_SLICE_MS) {
+        step = workerStep(worker);
+    }
+    if (step == Exit && worker.opened) {
+        worker.opened = false;
+        worker.source->close();
+    }
+
+    QMutexLocker locker(&mutex_);
+    if (step == Exit) {
+        worker.running = false;
+        workersIdle_.wakeAll();
+        return;
+    }
+    if (step == Continue || worker.resumeRequested || shouldExit()) {
+        submitLocked(worker);
+        return;
+    }
+    worker.parked = true;
+}
+
+ParallelRangeFetcher::Step ParallelRangeFetcher::workerStep(Worker& worker)
+{
+    if (shouldExit()) {
+        return Exit;
+    }
+    if (!worker.opened) {
+        if (!worker.source->open(filePath_)) {
+            fail(QStringLiteral("open %1 failed: %2").arg(filePath_).arg(worker.source->errorString()));
+            return Exit;
+        }
+        worker.opened = true;
+    }
+    if (worker.position >= worker.end) {
+        const Step claimed = claimRange(worker);
+        if (claimed != Continue) {
+            return claimed;
+        }
+        if (!worker.source->seekRange(worker.position, worker.end - worker.position)) {
+            fail(QStringLiteral("seek to %1 failed: %2").arg(worker.position).arg(worker.source->errorString()));
+            return Exit;
+        }
+    }
+
+    TransferMetrics& metrics = manager_->metrics();
+    const qint64 chunkSize = qMin(manager_->nextChunkSize(), worker.end - worker.position);
+    if (scheduler_) {
+        if (worker.slotWaitStart < 0) {
+            worker.slotWaitStart = metrics.now();
+        }
+        Worker* waiter = &worker;
+        if (!scheduler_->tryAcquire(schedulerTicket_, waiter, [this, waiter]() { resumeWorker(*waiter); })) {
+            return Park;
+        }
+        metrics.record(TransferMetrics::SchedulerWait, metrics.now() - worker.slotWaitStart);
+        worker.slotWaitStart = -1;
+    }
+    DataChunk chunk;
+    const qint64 readStart = metrics.now();
+    const bool read = worker.source->readChunk(chunkSize, chunk);
+    if (scheduler_) {
+        scheduler_->release(schedulerTicket_, read ? chunk.size() : 0);
+    }
+    if (!read) {
+        fail(QStringLiteral("read at %1 failed: %2").arg(worker.position).arg(worker.source->errorString()));
+        return Exit;
+    }
+    metrics.record(TransferMetrics::SourceRead, metrics.now() - readStart, chunk.size());
+    chunk.offset = worker.position;
+    worker.position += chunk.size();
+
+    QMutexLocker locker(&mutex_);
+    const bool atFrontier = chunk.offset == frontier_;
+    if (!atFrontier) {
+        stats_.outOfOrderChunks++;
+    }
+    reassemblyBytes_ += chunk.size();
+    stats_.peakReassemblyBytes = qMax(stats_.peakReassemblyBytes, reassemblyBytes_);
+    reassembly_.emplace(chunk.offset, std::move(chunk));
+    if (atFrontier) {
+        wakeConsumerLocked();
+    }
+    return Continue;
+}
+
+ParallelRangeFetcher::Step ParallelRangeFetcher::claimRange(Worker& worker)
+{
+    QMutexLocker locker(&mutex_);
+    if (shouldExit() || nextRangeOffset_ >= fileSize_) {
+        return Exit;
+    }
+    // 只领取重组窗口内的区间，限制前沿被慢区间卡住时缓冲的数据量
+    if (nextRangeOffset_ >= frontier_ + windowSize_) {
+        worker.waitingWindow = true;
+        return Park;
+    }
+    worker.position = nextRangeOffset_;
+    worker.end = qMin(worker.position + rangeSize_, fileSize_);
+    nextRangeOffset_ = worker.end;
+    stats_.ranges++;
+    return Continue;
+}
+
+void ParallelRangeFetcher::wakeConsumerLocked()
+{
+    if (consumerWaiting_) {
+        consumerWaiting_ = false;
+        if (wakeup_) {
+            wakeup_();
+        }
+    }
+}
+
+bool ParallelRangeFetcher::shouldExit() const
+{
+    return cancelled_ || failed_ || stopFlag_;
+}
+
+void ParallelRangeFetcher::fail(const QString& message)
+{
+    QMutexLocker locker(&mutex_);
+    if (!failed_) {
+        failed_ = true;
+        error_ = message;
+        qDebug() << "parallel range fetch failed:" << message;
+    }
+    // 生产者由takeNext得知失败后结束读取，finish收尾让出线程的工作任务
+    wakeConsumerLocked();
+}
+
+} // namespace clipboard
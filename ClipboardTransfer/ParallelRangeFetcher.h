@@ -0,0 +1,153 @@
+#pragma once
+#include "ChunkSource.h"
+#include "TransferScheduler.h"
+#include <QMutex>
+#include <QString>
+#include <QThreadPool>
+#include <QWaitCondition>
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace clipboard {
+
+class FileBufferManager;
+
+// 多个工作任务并发读取同一个文件的不相交区间，数据块按偏移放入重组缓冲，
+// 生产者通过takeNext严格按偏移顺序取出，连续前缀一增长就能交出。
+// 一个慢的区间只阻塞它之后的数据，其他工作任务在重组窗口内继续读取。
+// 工作任务与生产任务一样在线程池中按时间片运行，等待重组窗口或I/O时隙时让出线程，不另外创建线程
+class ParallelRangeFetcher
+{
+public:
+    struct Statistics
+    {
+        qint64 ranges = 0;                  // 已领取的区间个数
+        qint64 outOfOrderChunks = 0;        // 到达时不在前沿、需要在重组缓冲中等待的数据块个数
+        qint64 peakReassemblyBytes = 0;     // 重组缓冲同时持有的最大字节数
+    };
+
+    // takeNext的结果
+    enum TakeResult {
+        Taken,      // 取出了一个数据块
+        Pending,    // 前沿的数据块还没到，到达时调用setWakeup设置的回调
+        Finished    // 读完、出错或停止
+    };
+
+    // sources为每个工作任务各自使用的数据来源，由调用方持有；stopFlag置位时尽快退出。
+    // 数据块大小和读取耗时统计来自manager所在的传输会话
+    ParallelRangeFetcher(FileBufferManager* manager, const std::vector<ChunkSource*>& sources,
+                         qint64 rangeSize, const std::atomic<bool>& stopFlag);
+    ~ParallelRangeFetcher();
+
+    ParallelRangeFetcher(const ParallelRangeFetcher&) = delete;
+    ParallelRangeFetcher& operator=(const ParallelRangeFetcher&) = delete;
+
+    // 设置后工作任务每读取一个数据块前以ticket向scheduler申请I/O时隙；须在start前调用
+    void setScheduler(TransferScheduler* scheduler, int ticket);
+    // 运行工作任务的线程池，为空时使用自己的线程池；须在start前调用
+    void setThreadPool(QThreadPool* pool);
+    // takeNext返回Pending之后，前沿的数据块到达或读取失败时调用一次wakeup（持有内部锁时调用，
+    // 应当只重新提交生产任务）；须在start前调用
+    void setWakeup(const std::function<void()>& wakeup);
+    // 工作任务提交到线程池时的优先级，与生产任务一样取自TransferScheduler::runPriority，之后提交的任务生效
+    void setRunPriority(int priority);
+    // 提交工作任务读取filePath的[startOffset, fileSize)，startOffset之前的部分已从检查点读回
+    void start(const QString& filePath, qint64 fileSize, qint64 startOffset = 0);
+    // 按偏移顺序取出下一个数据块，chunk.offset为其在文件中的偏移；不等待
+    TakeResult takeNext(DataChunk& chunk);
+    // 结束读取并等待正在运行的工作任务返回，未读完时打断阻塞中的数据来源
+    void finish();
+
+    QString errorString() const;
+    Statistics statistics() const;
+
+    static const qint64 DEFAULT_RANGE_SIZE = 4 * 1024 * 1024;
+    // 重组窗口为每个工作任务的区间数，领取的区间不超过前沿之后这么多个区间
+    static const int WINDOW_RANGES_PER_WORKER = 2;
+
+private:
+    class Task;
+
+    enum Step {
+        Continue,   // 读取了一个数据块
+        Park,       // 等待重组窗口或I/O时隙，由takeNext或调度器重新提交
+        Exit        // 没有区间可领、出错或应退出
+    };
+
+    // 一个工作任务的状态，除source的读取外受mutex_保护
+    struct Worker
+    {
+        ChunkSource* source = nullptr;
+        bool opened = false;
+        // 正在读取的区间，position达到end后领取下一个
+        qint64 position = 0;
+        qint64 end = 0;
+        // 任务已提交或正在运行
+        bool running = false;
+        // 任务让出了线程，等待重新提交
+        bool parked = false;
+        bool resumeRequested = false;
+        // 在等待重组窗口，前沿推进时重新提交
+        bool waitingWindow = false;
+        // 开始等待I/O时隙的时间，没有在等待时为-1
+        qint64 slotWaitStart = -1;
+        // 已提交但线程池还未开始执行的任务，finish时取回
+        QRunnable* queued = nullptr;
+    };
+
+    QThreadPool* threadPool();
+    // 线程池中执行的任务：运行workerStep直到时间片用完、需要等待或退出
+    void runWorker(Worker& worker);
+    Step workerStep(Worker& worker);
+    // 领取下一个区间，窗口已满时返回Park，没有区间可领或应退出时返回Exit
+    Step claimRange(Worker& worker);
+    // 提交工作任务，调用时须持有mutex_
+    void submitLocked(Worker& worker);
+    // 让出线程的工作任务重新提交，运行中的任务结束时据此继续；调用时须持有mutex_
+    void resumeLocked(Worker& worker);
+    void resumeWorker(Worker& worker);
+    // 生产者在等待前沿时回调它，调用时须持有mutex_
+    void wakeConsumerLocked();
+    bool shouldExit() const;
+    void fail(const QString& message);
+
+    FileBufferManager* manager_;
+    std::vector<ChunkSource*> sources_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+    QThreadPool* threadPool_;
+    QThreadPool ownThreadPool_;
+    std::function<void()> wakeup_;
+    qint64 rangeSize_;
+    qint64 windowSize_;
+    const std::atomic<bool>& stopFlag_;
+    TransferScheduler* scheduler_;
+    int schedulerTicket_;
+    QString filePath_;
+    qint64 fileSize_;
+
+    mutable QMutex mutex_;
+    // 工作任务全部返回时通知finish
+    QWaitCondition workersIdle_;
+    // 提交工作任务时在线程池队列中的优先级
+    int runPriority_;
+    // 生产者的takeNext返回了Pending，等待回调
+    bool consumerWaiting_;
+    // 重组缓冲：按偏移排序的已到达但还不连续的数据块
+    std::map<qint64, DataChunk> reassembly_;
+    qint64 reassemblyBytes_;
+    qint64 nextRangeOffset_;
+    // 下一个交出的偏移，即连续前缀的末尾
+    qint64 frontier_;
+    std::atomic<bool> cancelled_;
+    std::atomic<bool> failed_;
+    QString error_;
+    Statistics stats_;
+
+    // 一个工作任务最多连续运行的时间（毫秒）
+    static const int TIME_SLICE_MS = 10;
+};
+
+} // namespace clipboard
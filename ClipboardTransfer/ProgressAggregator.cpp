@@ -0,0 +1,95 @@
+#include "ProgressAggregator.h"
+#include <cmath>
+
+namespace clipboard {
+
+ProgressAggregator::ProgressAggregator(QObject* parent)
+    : QObject(parent)
+    , completed_(0)
+    , totalBytes_(0)
+    , lastSampleNs_(0)
+    , lastSampleBytes_(0)
+    , published_(false)
+{
+    timer_.setInterval(DEFAULT_INTERVAL_MS);
+    connect(&timer_, &QTimer::timeout, this, [this]() { publish(); });
+}
+
+void ProgressAggregator::setInterval(int intervalMs)
+{
+    timer_.setInterval(qMax(1, intervalMs));
+}
+
+int ProgressAggregator::interval() const
+{
+    return timer_.interval();
+}
+
+void ProgressAggregator::start(qint64 totalBytes, qint64 completedBytes)
+{
+    completed_.store(completedBytes, std::memory_order_relaxed);
+    totalBytes_ = totalBytes;
+    last_ = Snapshot();
+    last_.bytes = completedBytes;
+    last_.totalBytes = totalBytes;
+    lastSampleNs_ = 0;
+    lastSampleBytes_ = completedBytes;
+    published_ = false;
+    clock_.start();
+    timer_.start();
+}
+
+void ProgressAggregator::stop()
+{
+    if (!timer_.isActive()) {
+        return;
+    }
+    timer_.stop();
+    publish(true);
+}
+
+void ProgressAggregator::publish(bool force)
+{
+    const qint64 bytes = completed_.load(std::memory_order_relaxed);
+    const qint64 nowNs = clock_.nsecsElapsed();
+    if (published_ && !force && bytes == last_.bytes) {
+        return;
+    }
+
+    // 按本次采样间隔的瞬时速率做指数平滑，间隔越长新样本权重越大，与发布频率无关
+    const qint64 intervalNs = nowNs - lastSampleNs_;
+    if (intervalNs > 0) {
+        const double rate = (bytes - lastSampleBytes_) * 1e9 / intervalNs;
+        if (lastSampleNs_ == 0) {
+            last_.bytesPerSecond = rate;
+        } else {
+            const double alpha = 1.0 - std::exp(-intervalNs / (SMOOTHING_WINDOW_MS * 1e6));
+            last_.bytesPerSecond += alpha * (rate - last_.bytesPerSecond);
+        }
+        lastSampleNs_ = nowNs;
+        lastSampleBytes_ = bytes;
+    }
+
+    last_.bytes = bytes;
+    last_.totalBytes = totalBytes_;
+    last_.elapsedMs = nowNs / 1000000;
+    const qint64 remaining = qMax((qint64)0, totalBytes_ - bytes);
+    if (remaining == 0) {
+        last_.etaMs = 0;
+    } else if (last_.bytesPerSecond > 0) {
+        last_.etaMs = static_cast<qint64>(remaining * 1000.0 / last_.bytesPerSecond);
+    } else {
+        last_.etaMs = -1;
+    }
+    published_ = true;
+
+    emit progressUpdated(last_.bytes, last_.totalBytes,
+                         static_cast<qint64>(last_.bytesPerSecond), last_.etaMs);
+}
+
+ProgressAggregator::Snapshot ProgressAggregator::snapshot() const
+{
+    return last_;
+}
+
+} // namespace clipboard
@@ -0,0 +1,67 @@
+#pragma once
+#include <QObject>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <atomic>
+
+namespace clipboard {
+
+// 传输进度汇总：读取线程只更新原子计数，由所属线程（GUI线程）的定时器按固定频率发布进度，
+// 同时计算平滑后的速率和剩余时间。读取方调用再频繁，界面每秒也只收到约1000/interval次更新
+class ProgressAggregator : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Snapshot
+    {
+        qint64 bytes = 0;
+        qint64 totalBytes = 0;
+        qint64 elapsedMs = 0;
+        // 指数平滑后的速率（字节/秒）
+        double bytesPerSecond = 0.0;
+        // 按平滑速率估计的剩余时间，速率未知时为-1
+        qint64 etaMs = -1;
+    };
+
+    explicit ProgressAggregator(QObject* parent = nullptr);
+
+    // 发布间隔，默认约30Hz
+    void setInterval(int intervalMs);
+    int interval() const;
+
+    // 以下三个在所属线程调用：开始计时并启动定时器、停止定时器并发布最终进度。
+    // completedBytes为续传之前已有的字节数，计入进度但不计入速率
+    void start(qint64 totalBytes, qint64 completedBytes = 0);
+    void stop();
+    // 立即按当前计数计算并发布一次，进度没有变化时只在force为true时发布
+    void publish(bool force = false);
+
+    // 任意线程调用，已完成的字节数只增不减
+    void setCompleted(qint64 bytes) {
+        completed_.store(bytes, std::memory_order_relaxed);
+    }
+
+    // 最近一次发布的进度，在所属线程调用
+    Snapshot snapshot() const;
+
+    static const int DEFAULT_INTERVAL_MS = 33;
+    // 速率平滑的时间常数，越大ETA越稳定、对速率变化反应越慢
+    static const int SMOOTHING_WINDOW_MS = 2000;
+
+signals:
+    void progressUpdated(qint64 bytesTransferred, qint64 totalBytes, qint64 bytesPerSecond, qint64 etaMs);
+
+private:
+    QTimer timer_;
+    QElapsedTimer clock_;
+    std::atomic<qint64> completed_;
+    qint64 totalBytes_;
+    // 以下仅在所属线程访问
+    Snapshot last_;
+    qint64 lastSampleNs_;
+    qint64 lastSampleBytes_;
+    bool published_;
+};
+
+} // namespace clipboard
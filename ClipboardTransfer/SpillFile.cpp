@@ -0,0 +1,280 @@
+#include "SpillFile.h"
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+
+namespace clipboard {
+
+SpillFile::SpillFile(qint64 writeBehindLimit, qint64 readAheadSize)
+    : writeBehindLimit_(qMax(writeBehindLimit, (qint64)1))
+    , readAheadSize_(qMax(readAheadSize, (qint64)0))
+    , writeFile_(nullptr)
+    , writer_(nullptr)
+    , queuedBytes_(0)
+    , appendOffset_(0)
+    , writtenOffset_(0)
+    , loadedOffset_(0)
+    , closing_(false)
+    , readAheadOffset_(0)
+{
+}
+
+SpillFile::~SpillFile()
+{
+    close();
+}
+
+bool SpillFile::open(const QString& directory)
+{
+    close();
+
+    QString dir = directory.isEmpty() ? QDir::tempPath() : directory;
+    writeFile_ = new QTemporaryFile(QDir(dir).filePath("ClipboardTransfer-XXXXXX.spill"));
+    writeFile_->setAutoRemove(true);
+    if (!writeFile_->open()) {
+        error_ = writeFile_->errorString();
+        delete writeFile_;
+        writeFile_ = nullptr;
+        return false;
+    }
+
+    // 读写使用各自的文件句柄，写入线程和消费者互不影响文件位置
+    readFile_.setFileName(writeFile_->fileName());
+    if (!readFile_.open(QIODevice::ReadOnly)) {
+        error_ = readFile_.errorString();
+        delete writeFile_;
+        writeFile_ = nullptr;
+        return false;
+    }
+
+    {
+        QMutexLocker locker(&mutex_);
+        writeQueue_.clear();
+        queuedBytes_ = 0;
+        appendOffset_ = 0;
+        writtenOffset_ = 0;
+        loadedOffset_ = 0;
+        closing_ = false;
+        error_.clear();
+        stats_ = Statistics();
+    }
+    readAhead_.clear();
+    readAheadOffset_ = 0;
+
+    writer_ = QThread::create([this]() { writeLoop(); });
+    writer_->start();
+    qDebug() << "spill file:" << writeFile_->fileName();
+    return true;
+}
+
+void SpillFile::close()
+{
+    if (!writer_) {
+        return;
+    }
+
+    {
+        QMutexLocker locker(&mutex_);
+        closing_ = true;
+        writeRequested_.wakeAll();
+        writeDone_.wakeAll();
+    }
+    writer_->wait();
+    delete writer_;
+    writer_ = nullptr;
+
+    QMutexLocker locker(&mutex_);
+    writeQueue_.clear();
+    queuedBytes_ = 0;
+    readAhead_.clear();
+    readFile_.close();
+    // 自动删除临时文件
+    delete writeFile_;
+    writeFile_ = nullptr;
+}
+
+bool SpillFile::isOpen() const
+{
+    QMutexLocker locker(&mutex_);
+    return writer_ && !closing_ && error_.isEmpty();
+}
+
+bool SpillFile::append(DataChunk& chunk)
+{
+    const qint64 size = chunk.size();
+    if (size <= 0) {
+        return false;
+    }
+
+    QMutexLocker locker(&mutex_);
+    // 写入积压受限，溢出层的内存占用不随传输大小增长
+    while (!closing_ && error_.isEmpty() && queuedBytes_ > 0
+           && queuedBytes_ + size > writeBehindLimit_) {
+        writeDone_.wait(&mutex_);
+    }
+    if (closing_ || !error_.isEmpty()) {
+        return false;
+    }
+
+    WriteRequest request;
+    request.offset = appendOffset_;
+    request.chunk = std::move(chunk);
+
+    // 原数据块变为标记，保留文件下标和偏移
+    chunk = DataChunk();
+    chunk.fileIndex = request.chunk.fileIndex;
+    chunk.offset = request.chunk.offset;
+    chunk.rawSize = request.chunk.rawSize;
+    chunk.spillOffset = appendOffset_;
+    chunk.spillSize = size;
+
+    appendOffset_ += size;
+    queuedBytes_ += size;
+    stats_.spilledChunks++;
+    stats_.spilledBytes += size;
+    stats_.pendingBytes += size;
+    writeQueue_.push_back(std::move(request));
+    writeRequested_.wakeAll();
+    return true;
+}
+
+bool SpillFile::load(DataChunk& chunk)
+{
+    if (!chunk.isSpilled()) {
+        return true;
+    }
+    const qint64 offset = chunk.spillOffset;
+    const qint64 size = chunk.spillSize;
+    const qint64 end = offset + size;
+
+    // 预读缓冲区之外时从磁盘读取一大段，后续标记通常落在这段数据里
+    if (offset < readAheadOffset_ || end > readAheadOffset_ + readAhead_.size()) {
+        qint64 readSize = 0;
+        {
+            QMutexLocker locker(&mutex_);
+            while (!closing_ && error_.isEmpty() && writtenOffset_ < end) {
+                writeDone_.wait(&mutex_);
+            }
+            if (writtenOffset_ < end) {
+                return false;
+            }
+            readSize = qMin(qMax(size, readAheadSize_), writtenOffset_ - offset);
+        }
+
+        QElapsedTimer timer;
+        timer.start();
+        if (!readFile_.seek(offset)) {
+            return false;
+        }
+        readAhead_ = readFile_.read(readSize);
+        readAheadOffset_ = offset;
+        const qint64 elapsed = timer.nsecsElapsed() / 1000;
+
+        QMutexLocker locker(&mutex_);
+        stats_.readCount++;
+        stats_.readMicros += elapsed;
+        stats_.maxReadMicros = qMax(stats_.maxReadMicros, elapsed);
+        if (readAhead_.size() < size) {
+            error_ = readFile_.errorString();
+            readAhead_.clear();
+            return false;
+        }
+    }
+
+    // 复制出独立的数据块，不让缓存中的小块引用整个预读缓冲区，保证内存预算准确
+    chunk.data = QByteArray(readAhead_.constData() + (offset - readAheadOffset_), static_cast<int>(size));
+    chunk.spillOffset = -1;
+    chunk.spillSize = 0;
+
+    QMutexLocker locker(&mutex_);
+    loadedOffset_ = end;
+    stats_.pendingBytes -= size;
+    if (loadedOffset_ == appendOffset_) {
+        rewindLocked();
+    }
+    return true;
+}
+
+qint64 SpillFile::pendingBytes() const
+{
+    QMutexLocker locker(&mutex_);
+    return stats_.pendingBytes;
+}
+
+QString SpillFile::errorString() const
+{
+    QMutexLocker locker(&mutex_);
+    return error_;
+}
+
+SpillFile::Statistics SpillFile::statistics() const
+{
+    QMutexLocker locker(&mutex_);
+    return stats_;
+}
+
+void SpillFile::writeLoop()
+{
+    QMutexLocker locker(&mutex_);
+    for (;;) {
+        while (!closing_ && writeQueue_.empty()) {
+            writeRequested_.wait(&mutex_);
+        }
+        if (closing_) {
+            break;
+        }
+
+        // 写入期间不持锁，生产者可以继续追加
+        WriteRequest request = std::move(writeQueue_.front());
+        writeQueue_.pop_front();
+        locker.unlock();
+
+        QElapsedTimer timer;
+        timer.start();
+        bool ok = true;
+        if (writeFile_->pos() != request.offset) {
+            ok = writeFile_->seek(request.offset);
+        }
+        if (ok) {
+            ok = writeFile_->write(request.chunk.constData(), request.chunk.size()) == request.chunk.size();
+        }
+        // QTemporaryFile带用户态缓冲，不刷新时小数据块留在缓冲区里，readFile_读回会读不全
+        if (ok) {
+            ok = writeFile_->flush();
+        }
+        const qint64 elapsed = timer.nsecsElapsed() / 1000;
+        const qint64 size = request.chunk.size();
+        // 数据已落盘，立即归还数据块缓冲区
+        request.chunk = DataChunk();
+
+        locker.relock();
+        stats_.writeCount++;
+        stats_.writeMicros += elapsed;
+        stats_.maxWriteMicros = qMax(stats_.maxWriteMicros, elapsed);
+        queuedBytes_ -= size;
+        if (ok) {
+            writtenOffset_ = request.offset + size;
+        } else {
+            error_ = writeFile_->errorString();
+            qWarning() << "spill write failed:" << error_;
+            writeQueue_.clear();
+            queuedBytes_ = 0;
+        }
+        writeDone_.wakeAll();
+        if (!ok) {
+            break;
+        }
+    }
+}
+
+void SpillFile::rewindLocked()
+{
+    // 只在没有未写入和未读回的数据时调用，下一次追加从文件开头开始覆盖
+    appendOffset_ = 0;
+    writtenOffset_ = 0;
+    loadedOffset_ = 0;
+    readAhead_.clear();
+    readAheadOffset_ = 0;
+}
+
+} // namespace clipboard
@@ -0,0 +1,112 @@
+#pragma once
+#include "DataChunk.h"
+#include <QString>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QFile>
+#include <QTemporaryFile>
+#include <QThread>
+#include <deque>
+
+namespace clipboard {
+
+// 传输缓冲的磁盘溢出层：热层（内存队列）超过预算后，数据块追加写入临时目录中的溢出文件，
+// 队列中只保留记录位置的标记。写入由后台线程顺序进行（write-behind），
+// 读回时一次读取一大段（read-ahead），后续标记直接从这段数据取得
+class SpillFile
+{
+public:
+    struct Statistics
+    {
+        qint64 spilledChunks = 0;       // 写入溢出文件的数据块个数
+        qint64 spilledBytes = 0;        // 写入溢出文件的总字节数
+        qint64 pendingBytes = 0;        // 已溢出但尚未读回的字节数
+        qint64 writeCount = 0;          // 后台写入次数
+        qint64 writeMicros = 0;         // 写入总耗时（微秒）
+        qint64 maxWriteMicros = 0;      // 单次写入最大耗时
+        qint64 readCount = 0;           // 从磁盘读回的次数（不含命中预读的）
+        qint64 readMicros = 0;          // 读回总耗时（微秒）
+        qint64 maxReadMicros = 0;       // 单次读回最大耗时
+
+        double averageWriteMicros() const {
+            return writeCount > 0 ? double(writeMicros) / writeCount : 0.0;
+        }
+        double averageReadMicros() const {
+            return readCount > 0 ? double(readMicros) / readCount : 0.0;
+        }
+    };
+
+    explicit SpillFile(qint64 writeBehindLimit = DEFAULT_WRITE_BEHIND_LIMIT,
+                       qint64 readAheadSize = DEFAULT_READ_AHEAD_SIZE);
+    ~SpillFile();
+
+    SpillFile(const SpillFile&) = delete;
+    SpillFile& operator=(const SpillFile&) = delete;
+
+    // 在directory中创建溢出文件并启动写入线程，directory为空时使用系统临时目录
+    bool open(const QString& directory = QString());
+    // 停止写入线程并删除溢出文件，唤醒所有等待者
+    void close();
+    bool isOpen() const;
+
+    // 由生产者调用：把chunk的数据交给写入线程，chunk变为只记录溢出位置的标记
+    // 尚未写入的数据超过writeBehindLimit时阻塞，返回false表示写入出错或已关闭
+    bool append(DataChunk& chunk);
+
+    // 由消费者按标记入队的顺序调用：读回标记对应的数据，必要时等待后台写入完成
+    bool load(DataChunk& chunk);
+
+    // 已溢出但尚未读回的字节数
+    qint64 pendingBytes() const;
+    QString errorString() const;
+
+    Statistics statistics() const;
+
+    static const qint64 DEFAULT_WRITE_BEHIND_LIMIT = 16 * 1024 * 1024;
+    static const qint64 DEFAULT_READ_AHEAD_SIZE = 4 * 1024 * 1024;
+
+private:
+    struct WriteRequest
+    {
+        qint64 offset;
+        DataChunk chunk;
+    };
+
+    // 写入线程主循环
+    void writeLoop();
+    // 所有溢出数据都已读回时从文件开头重新使用，溢出文件不会无限增长
+    void rewindLocked();
+
+    qint64 writeBehindLimit_;
+    qint64 readAheadSize_;
+
+    // 每次open创建新的临时文件，close时删除
+    QTemporaryFile* writeFile_;
+    QFile readFile_;
+    QThread* writer_;
+
+    mutable QMutex mutex_;
+    // 有新的写入请求或正在关闭
+    QWaitCondition writeRequested_;
+    // 一次写入完成，唤醒等待积压下降的生产者和等待数据落盘的消费者
+    QWaitCondition writeDone_;
+    // DataChunk只能移动，不能放进QQueue
+    std::deque<WriteRequest> writeQueue_;
+    qint64 queuedBytes_;
+    // 下一个数据块在溢出文件中的位置
+    qint64 appendOffset_;
+    // [0, writtenOffset_)已写入磁盘
+    qint64 writtenOffset_;
+    // [0, loadedOffset_)已被读回
+    qint64 loadedOffset_;
+    bool closing_;
+    QString error_;
+
+    // 预读缓冲区，仅消费者线程访问
+    QByteArray readAhead_;
+    qint64 readAheadOffset_;
+
+    Statistics stats_;
+};
+
+} // namespace clipboard
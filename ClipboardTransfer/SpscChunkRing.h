@@ -0,0 +1,106 @@
+#pragma once
+#include "DataChunk.h"
+#include <atomic>
+#include <vector>
+#include <cstddef>
+
+namespace clipboard {
+
+// 单生产者/单消费者无锁环形队列
+// tail_ 只由生产者(DataProducerThread)写入，head_ 只由消费者(readData)写入，
+// 两个索引放在不同的缓存行中，避免两个线程之间的伪共享
+class SpscChunkRing
+{
+public:
+    explicit SpscChunkRing(size_t capacity)
+        : head_(0)
+        , tail_(0)
+        , cachedHead_(0)
+        , cachedTail_(0)
+    {
+        // 容量向上取整为2的幂，用掩码代替取模
+        size_t size = 2;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        slots_.resize(size);
+        mask_ = size - 1;
+    }
+
+    SpscChunkRing(const SpscChunkRing&) = delete;
+    SpscChunkRing& operator=(const SpscChunkRing&) = delete;
+
+    // 仅生产者线程调用，队列满时返回false
+    bool tryPush(DataChunk&& chunk)
+    {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - cachedHead_ > mask_) {
+            cachedHead_ = head_.load(std::memory_order_acquire);
+            if (tail - cachedHead_ > mask_) {
+                return false;
+            }
+        }
+        slots_[tail & mask_] = std::move(chunk);
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 仅消费者线程调用，队列空时返回false
+    bool tryPop(DataChunk& chunk)
+    {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        if (head == cachedTail_) {
+            cachedTail_ = tail_.load(std::memory_order_acquire);
+            if (head == cachedTail_) {
+                return false;
+            }
+        }
+        chunk = std::move(slots_[head & mask_]);
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool isEmpty() const
+    {
+        return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+    }
+
+    size_t size() const
+    {
+        return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+    }
+
+    size_t capacity() const
+    {
+        return mask_ + 1;
+    }
+
+    // 只能在生产者和消费者都不再访问队列时调用
+    void clear()
+    {
+        for (DataChunk& slot : slots_) {
+            slot = DataChunk();
+        }
+        head_.store(0, std::memory_order_relaxed);
+        tail_.store(0, std::memory_order_relaxed);
+        cachedHead_ = 0;
+        cachedTail_ = 0;
+    }
+
+private:
+    static constexpr size_t kCacheLineSize = 64;
+
+    // 消费者写入的读索引
+    alignas(kCacheLineSize) std::atomic<size_t> head_;
+    // 生产者写入的写索引
+    alignas(kCacheLineSize) std::atomic<size_t> tail_;
+    // 生产者本地缓存的读索引，减少对head_缓存行的访问
+    alignas(kCacheLineSize) size_t cachedHead_;
+    // 消费者本地缓存的写索引
+    alignas(kCacheLineSize) size_t cachedTail_;
+
+    alignas(kCacheLineSize) std::vector<DataChunk> slots_;
+    size_t mask_;
+};
+
+} // namespace clipboard
@@ -0,0 +1,21 @@
+#pragma once
+#include "TransferFile.h"
+#include <memory>
+
+namespace clipboard {
+
+class FileBufferManager;
+
+// 传输数据的呈现端：把文件列表交给读取方，读取方随后通过session的FileBufferManager::readData
+// 按文件下标和偏移拉取数据。Windows上是剪贴板中的虚拟文件，基准测试中是直接读取的线程
+class StreamSink
+{
+public:
+    virtual ~StreamSink() {}
+
+    // 每次startTransfer时调用，此时生产者已开始预读。读取方持有session直到不再读取，
+    // 同一个呈现端可能先后发布多个同时进行的会话
+    virtual void publish(const std::shared_ptr<FileBufferManager>& session, const TransferFileList& files) = 0;
+};
+
+} // namespace clipboard
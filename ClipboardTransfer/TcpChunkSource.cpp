@@ -0,0 +1,308 @@
+#include "TcpChunkSource.h"
+#include "ChunkBufferPool.h"
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QTcpSocket>
+#include <cstring>
+
+namespace clipboard {
+
+TcpChunkSource::TcpChunkSource(const NetworkPeer& peer)
+    : peer_(peer)
+    , socket_(nullptr)
+    , fileSize_(0)
+    , position_(0)
+    , requestOffset_(0)
+    , requestEnd_(0)
+    , inFlightBytes_(0)
+    , inFlightRequests_(0)
+    , interrupted_(false)
+{
+}
+
+TcpChunkSource::~TcpChunkSource()
+{
+    close();
+}
+
+bool TcpChunkSource::open(const QString& filePath)
+{
+    close();
+    error_.clear();
+    if (interrupted_) {
+        return fail(QStringLiteral("interrupted"));
+    }
+
+    socket_ = new QTcpSocket();
+    socket_->connectToHost(peer_.host, peer_.port);
+    if (!socket_->waitForConnected(peer_.timeoutMs)) {
+        return fail(QStringLiteral("connect to %1:%2 failed: %3").arg(peer_.host).arg(peer_.port).arg(socket_->errorString()));
+    }
+    // 读取请求很小且需要立即发出，关闭Nagle算法
+    socket_->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+
+    if (!sendFrame(ChunkProtocol::openRequest(filePath))) {
+        return false;
+    }
+    ChunkProtocol::FrameType type;
+    quint32 bodySize;
+    if (!readHeader(type, bodySize)) {
+        return false;
+    }
+    char body[ChunkProtocol::OFFSET_SIZE];
+    if (type != ChunkProtocol::OpenReply || bodySize != sizeof(body)) {
+        return fail(QStringLiteral("unexpected open reply"));
+    }
+    if (!readExact(body, sizeof(body))) {
+        return false;
+    }
+
+    fileSize_ = qFromBigEndian<qint64>(body);
+    position_ = 0;
+    requestOffset_ = 0;
+    requestEnd_ = fileSize_;
+    inFlightBytes_ = 0;
+    inFlightRequests_ = 0;
+    pending_.clear();
+    return true;
+}
+
+void TcpChunkSource::close()
+{
+    if (socket_) {
+        // 直接断开，在途的应答随连接一起丢弃
+        socket_->abort();
+        delete socket_;
+        socket_ = nullptr;
+    }
+    pending_.clear();
+    inFlightBytes_ = 0;
+    inFlightRequests_ = 0;
+}
+
+bool TcpChunkSource::readChunk(qint64 maxSize, DataChunk& chunk)
+{
+    if (!socket_ || maxSize <= 0 || position_ >= fileSize_) {
+        return false;
+    }
+
+    chunk.owner.reset();
+    char* target = nullptr;
+    auto prepare = [&](qint64 size) {
+        if (bufferPool_) {
+            chunk.data.clear();
+            chunk.buffer = bufferPool_->acquire(maxSize);
+            chunk.buffer.setSize(size);
+            target = chunk.buffer.data();
+        } else {
+            chunk.buffer.reset();
+            chunk.data.resize(static_cast<int>(size));
+            target = chunk.data.data();
+        }
+    };
+
+    // 上一个应答剩下的数据
+    if (!pending_.isEmpty()) {
+        qint64 take = qMin(maxSize, (qint64)pending_.size());
+        prepare(take);
+        memcpy(target, pending_.constData(), static_cast<size_t>(take));
+        pending_.remove(0, static_cast<int>(take));
+        position_ += take;
+        return true;
+    }
+
+    // 读到了seekRange给出的区间之外，恢复为读到文件末尾
+    if (position_ >= requestEnd_) {
+        requestEnd_ = fileSize_;
+    }
+    if (!fillWindow(maxSize)) {
+        return false;
+    }
+
+    for (;;) {
+        ChunkProtocol::FrameType type;
+        quint32 bodySize;
+        if (!readHeader(type, bodySize)) {
+            return false;
+        }
+        char offsetBytes[ChunkProtocol::OFFSET_SIZE];
+        if (type != ChunkProtocol::DataReply || bodySize < sizeof(offsetBytes)) {
+            return fail(QStringLiteral("unexpected frame type %1").arg(type));
+        }
+        if (!readExact(offsetBytes, sizeof(offsetBytes))) {
+            return false;
+        }
+        const qint64 offset = qFromBigEndian<qint64>(offsetBytes);
+        const qint64 length = bodySize - sizeof(offsetBytes);
+        inFlightBytes_ -= length;
+        --inFlightRequests_;
+
+        // 接收数据之前先补上窗口，让对端在我们复制数据时继续发送
+        if (!fillWindow(maxSize)) {
+            return false;
+        }
+
+        if (offset != position_ || length == 0) {
+            // seek之前发出的请求的应答，文件内容不变，偏移对不上的直接丢弃
+            QByteArray discard(static_cast<int>(length), Qt::Uninitialized);
+            if (!readExact(discard.data(), length)) {
+                return false;
+            }
+            continue;
+        }
+
+        qint64 take = qMin(length, maxSize);
+        prepare(take);
+        if (!readExact(target, take)) {
+            chunk.buffer.reset();
+            chunk.data.clear();
+            return false;
+        }
+        if (length > take) {
+            pending_.resize(static_cast<int>(length - take));
+            if (!readExact(pending_.data(), pending_.size())) {
+                return false;
+            }
+        }
+        position_ += take;
+        return true;
+    }
+}
+
+bool TcpChunkSource::seek(qint64 offset)
+{
+    if (!socket_ || offset < 0 || offset > fileSize_) {
+        return fail(QStringLiteral("seek out of range: %1").arg(offset));
+    }
+    requestEnd_ = fileSize_;
+    if (offset >= position_ && offset - position_ < pending_.size()) {
+        pending_.remove(0, static_cast<int>(offset - position_));
+        position_ = offset;
+        return true;
+    }
+    if (offset == position_) {
+        return true;
+    }
+
+    // 之前的请求仍在途并占用窗口，它们的应答在readChunk中按偏移丢弃
+    pending_.clear();
+    position_ = offset;
+    requestOffset_ = offset;
+    return true;
+}
+
+bool TcpChunkSource::seekRange(qint64 offset, qint64 length)
+{
+    if (!seek(offset)) {
+        return false;
+    }
+    requestEnd_ = qMin(fileSize_, offset + qMax(length, (qint64)0));
+    return true;
+}
+
+bool TcpChunkSource::atEnd() const
+{
+    return position_ >= fileSize_;
+}
+
+QString TcpChunkSource::errorString() const
+{
+    return error_;
+}
+
+void TcpChunkSource::interrupt()
+{
+    interrupted_ = true;
+}
+
+bool TcpChunkSource::fillWindow(qint64 requestSize)
+{
+    requestSize = qBound((qint64)1, requestSize, (qint64)ChunkProtocol::MAX_READ_LENGTH);
+    QByteArray requests;
+    while (requestOffset_ < requestEnd_) {
+        qint64 length = qMin(requestSize, requestEnd_ - requestOffset_);
+        // 窗口小于一个请求时也至少保持一个请求在途
+        if (inFlightRequests_ > 0 && inFlightBytes_ + length > peer_.receiveWindow) {
+            break;
+        }
+        requests += ChunkProtocol::readRequest(requestOffset_, static_cast<quint32>(length));
+        requestOffset_ += length;
+        inFlightBytes_ += length;
+        ++inFlightRequests_;
+    }
+    return requests.isEmpty() || sendFrame(requests);
+}
+
+bool TcpChunkSource::sendFrame(const QByteArray& frame)
+{
+    if (socket_->write(frame) != frame.size()) {
+        return fail(socket_->errorString());
+    }
+    // 尽量立即写出，没写完的部分在waitForReadyRead中继续写
+    socket_->flush();
+    return true;
+}
+
+bool TcpChunkSource::readExact(char* data, qint64 size)
+{
+    while (size > 0) {
+        if (socket_->bytesAvailable() == 0 && !waitForReadyRead()) {
+            return false;
+        }
+        qint64 bytesRead = socket_->read(data, size);
+        if (bytesRead < 0) {
+            return fail(socket_->errorString());
+        }
+        data += bytesRead;
+        size -= bytesRead;
+    }
+    return true;
+}
+
+bool TcpChunkSource::waitForReadyRead()
+{
+    QElapsedTimer timer;
+    timer.start();
+    while (!interrupted_) {
+        if (socket_->waitForReadyRead(WAIT_SLICE_MS)) {
+            return true;
+        }
+        if (socket_->state() != QAbstractSocket::ConnectedState) {
+            return fail(socket_->errorString());
+        }
+        if (timer.elapsed() >= peer_.timeoutMs) {
+            return fail(QStringLiteral("read timeout"));
+        }
+    }
+    return fail(QStringLiteral("interrupted"));
+}
+
+bool TcpChunkSource::readHeader(ChunkProtocol::FrameType& type, quint32& bodySize)
+{
+    char header[ChunkProtocol::HEADER_SIZE];
+    if (!readExact(header, sizeof(header))) {
+        return false;
+    }
+    if (!ChunkProtocol::parseHeader(header, type, bodySize)) {
+        return fail(QStringLiteral("frame too large: %1").arg(bodySize));
+    }
+    if (type == ChunkProtocol::ErrorReply) {
+        QByteArray message(static_cast<int>(bodySize), Qt::Uninitialized);
+        if (readExact(message.data(), message.size())) {
+            fail(QString::fromUtf8(message));
+        }
+        return false;
+    }
+    return true;
+}
+
+bool TcpChunkSource::fail(const QString& message)
+{
+    if (error_.isEmpty()) {
+        error_ = message;
+        qDebug() << "network source error:" << message;
+    }
+    return false;
+}
+
+} // namespace clipboard
@@ -0,0 +1,65 @@
+#pragma once
+#include "ChunkSource.h"
+#include "ChunkProtocol.h"
+#include <QByteArray>
+#include <atomic>
+
+class QTcpSocket;
+
+namespace clipboard {
+
+// 网络读取：通过ChunkProtocol从对端拉取文件，每个打开的文件使用一个TCP连接
+// 读取请求以流水线方式发送，在途字节数不超过接收窗口，往返延迟被连续的请求掩盖。
+// 套接字在调用open的线程（生产者线程）上创建和使用，不需要事件循环
+class TcpChunkSource : public ChunkSource
+{
+public:
+    explicit TcpChunkSource(const NetworkPeer& peer);
+    ~TcpChunkSource();
+
+    bool open(const QString& filePath) override;
+    void close() override;
+    bool readChunk(qint64 maxSize, DataChunk& chunk) override;
+    bool seek(qint64 offset) override;
+    bool seekRange(qint64 offset, qint64 length) override;
+    bool atEnd() const override;
+    QString errorString() const override;
+    void interrupt() override;
+
+    // 对端报告的文件大小
+    qint64 fileSize() const {
+        return fileSize_;
+    }
+
+private:
+    // 在接收窗口内为[requestOffset_, requestEnd_)继续发送读取请求，每个请求不超过requestSize
+    bool fillWindow(qint64 requestSize);
+    bool sendFrame(const QByteArray& frame);
+    // 读满size字节，超时、断开或被打断时返回false
+    bool readExact(char* data, qint64 size);
+    bool waitForReadyRead();
+    // 读取下一个应答帧头，ErrorReply在这里转换为错误信息
+    bool readHeader(ChunkProtocol::FrameType& type, quint32& bodySize);
+    bool fail(const QString& message);
+
+    NetworkPeer peer_;
+    QTcpSocket* socket_;
+    qint64 fileSize_;
+    // 下一次readChunk返回的数据在文件中的偏移
+    qint64 position_;
+    // 下一个读取请求的起始偏移，请求不超过requestEnd_
+    qint64 requestOffset_;
+    qint64 requestEnd_;
+    // 已发出但尚未收到应答的读取请求字节数和个数
+    qint64 inFlightBytes_;
+    int inFlightRequests_;
+    // 应答比本次readChunk请求的大时剩下的数据，起始于position_
+    QByteArray pending_;
+    QString error_;
+    std::atomic<bool> interrupted_;
+
+    // 等待数据时每次阻塞的时长，便于及时响应interrupt
+    static const int WAIT_SLICE_MS = 50;
+};
+
+} // namespace clipboard
@@ -0,0 +1,284 @@
+#include "TransferCheckpoint.h"
+#include "Crc32c.h"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QLockFile>
+
+namespace clipboard {
+
+namespace {
+const char kJournalMagic[] = "ClipboardTransfer-checkpoint 2";
+}
+
+TransferCheckpoint::TransferCheckpoint()
+    : modified_(0)
+    , completed_(0)
+    , pendingBytes_(0)
+{
+}
+
+TransferCheckpoint::~TransferCheckpoint()
+{
+    close();
+}
+
+bool TransferCheckpoint::open(const QString& directory, const TransferFile& file)
+{
+    close();
+    file_ = file;
+    modified_ = modificationTime(file);
+    records_.clear();
+    completed_ = 0;
+    pendingRecords_.clear();
+    pendingBytes_ = 0;
+    error_.clear();
+    stats_ = Statistics();
+
+    if (!QDir().mkpath(directory)) {
+        error_ = QStringLiteral("can't create checkpoint directory ") + directory;
+        return false;
+    }
+    const QString base = basePath(directory, file);
+    // 锁不按时间过期，持有它的进程退出后才视为失效
+    lock_.reset(new QLockFile(base + QStringLiteral(".lock")));
+    lock_->setStaleLockTime(0);
+    if (!lock_->tryLock(0)) {
+        error_ = QStringLiteral("checkpoint is in use by another transfer: ") + file.filePath;
+        lock_.reset();
+        return false;
+    }
+    journal_.setFileName(base + QStringLiteral(".journal"));
+    if (!journal_.open(QIODevice::ReadWrite)) {
+        error_ = journal_.errorString();
+        lock_.reset();
+        return false;
+    }
+
+    // 没有日志、源文件已改变或日志损坏时从头开始
+    if (!loadJournal()) {
+        records_.clear();
+        completed_ = 0;
+        if (!rewrite(0)) {
+            close();
+            return false;
+        }
+    }
+    sinceFlush_.start();
+    return true;
+}
+
+void TransferCheckpoint::close()
+{
+    if (!isOpen()) {
+        return;
+    }
+    if (!flush()) {
+        qWarning() << "flush checkpoint failed:" << error_;
+    }
+    journal_.close();
+    // 删除锁文件
+    lock_.reset();
+}
+
+bool TransferCheckpoint::isOpen() const
+{
+    return journal_.isOpen();
+}
+
+qint64 TransferCheckpoint::completedBytes() const
+{
+    return completed_;
+}
+
+qint64 TransferCheckpoint::verify(QIODevice& partial)
+{
+    // 记录首尾相接，按顺序读取部分文件即可逐块比对
+    const qint64 available = partial.size();
+    qint64 valid = 0;
+    if (isOpen() && partial.seek(0)) {
+        for (const Record& record : records_) {
+            if (record.offset + record.length > available) {
+                break;
+            }
+            const QByteArray data = partial.read(record.length);
+            if (data.size() != record.length
+                || Crc32c::compute(data.constData(), data.size()) != record.checksum) {
+                break;
+            }
+            valid += record.length;
+        }
+    }
+    stats_.resumedBytes += valid;
+    stats_.invalidBytes += qMax((qint64)0, available - valid);
+
+    // 之后的记录不再可信，由源文件重新读取
+    if (valid < completed_ && !rewrite(valid)) {
+        qWarning() << "truncate checkpoint failed:" << error_;
+    }
+    return valid;
+}
+
+bool TransferCheckpoint::resumeAt(qint64 offset)
+{
+    if (offset < completed_ && !rewrite(offset)) {
+        return false;
+    }
+    if (completed_ != offset) {
+        error_ = QStringLiteral("checkpoint does not cover resume offset ") + QString::number(offset);
+        return false;
+    }
+    return true;
+}
+
+bool TransferCheckpoint::append(qint64 offset, qint64 length, quint32 checksum)
+{
+    if (!isOpen() || offset != completed_ || length <= 0) {
+        return true;
+    }
+
+    Record record;
+    record.offset = offset;
+    record.length = length;
+    record.checksum = checksum;
+    records_.push_back(record);
+    completed_ += length;
+    stats_.writtenBytes += length;
+
+    pendingRecords_ += recordLine(record);
+    pendingBytes_ += length;
+    if (pendingBytes_ >= FLUSH_BYTES || sinceFlush_.elapsed() >= FLUSH_INTERVAL_MS) {
+        return flush();
+    }
+    return true;
+}
+
+QString TransferCheckpoint::errorString() const
+{
+    return error_;
+}
+
+TransferCheckpoint::Statistics TransferCheckpoint::statistics() const
+{
+    return stats_;
+}
+
+void TransferCheckpoint::remove(const QString& directory, const TransferFile& file)
+{
+    const QString base = basePath(directory, file);
+    QLockFile lock(base + QStringLiteral(".lock"));
+    lock.setStaleLockTime(0);
+    // 另一个会话正在续传同一个源文件
+    if (!lock.tryLock(0)) {
+        return;
+    }
+    QFile::remove(base + QStringLiteral(".journal"));
+}
+
+QString TransferCheckpoint::basePath(const QString& directory, const TransferFile& file)
+{
+    const QByteArray key = QCryptographicHash::hash(file.filePath.toUtf8(), QCryptographicHash::Sha1);
+    return QDir(directory).filePath(QStringLiteral("ClipboardTransfer-") + QString::fromLatin1(key.toHex()));
+}
+
+qint64 TransferCheckpoint::modificationTime(const TransferFile& file)
+{
+    // 网络来源的路径在对端，本机上不存在时只按路径和大小判断
+    QFileInfo info(file.filePath);
+    return info.exists() ? info.lastModified().toMSecsSinceEpoch() : 0;
+}
+
+QByteArray TransferCheckpoint::headerLine() const
+{
+    return QByteArray(kJournalMagic) + ' ' + QByteArray::number(file_.fileSize) + ' '
+         + QByteArray::number(modified_) + ' ' + file_.filePath.toUtf8() + '\n';
+}
+
+QByteArray TransferCheckpoint::recordLine(const Record& record)
+{
+    return QByteArray::number(record.offset) + ' ' + QByteArray::number(record.length)
+         + ' ' + QByteArray::number(record.checksum, 16) + '\n';
+}
+
+bool TransferCheckpoint::loadJournal()
+{
+    if (!journal_.seek(0)) {
+        return false;
+    }
+    const QByteArray content = journal_.readAll();
+    const QByteArray header = headerLine();
+    if (!content.startsWith(header)) {
+        return false;
+    }
+
+    // 只接受从0开始首尾相接、不超出源文件大小的记录，遇到不完整的最后一行或不连续的记录即停止
+    int validEnd = header.size();
+    for (int lineEnd = content.indexOf('\n', validEnd); lineEnd >= 0; lineEnd = content.indexOf('\n', validEnd)) {
+        const QList<QByteArray> fields = content.mid(validEnd, lineEnd - validEnd).split(' ');
+        if (fields.size() != 3) {
+            break;
+        }
+        bool offsetOk = false;
+        bool lengthOk = false;
+        bool checksumOk = false;
+        Record record;
+        record.offset = fields.at(0).toLongLong(&offsetOk);
+        record.length = fields.at(1).toLongLong(&lengthOk);
+        record.checksum = fields.at(2).toUInt(&checksumOk, 16);
+        if (!offsetOk || !lengthOk || !checksumOk || record.offset != completed_
+            || record.length <= 0 || record.offset + record.length > file_.fileSize) {
+            break;
+        }
+        records_.push_back(record);
+        completed_ += record.length;
+        validEnd = lineEnd + 1;
+    }
+
+    // 去掉无效的尾部，之后的记录追加在有效记录之后
+    if (validEnd < content.size() && !journal_.resize(validEnd)) {
+        return false;
+    }
+    return journal_.seek(validEnd);
+}
+
+bool TransferCheckpoint::rewrite(qint64 from)
+{
+    while (!records_.empty() && records_.back().offset + records_.back().length > from) {
+        records_.pop_back();
+    }
+    completed_ = records_.empty() ? 0 : records_.back().offset + records_.back().length;
+    pendingRecords_.clear();
+    pendingBytes_ = 0;
+
+    QByteArray content = headerLine();
+    for (const Record& record : records_) {
+        content += recordLine(record);
+    }
+    if (!journal_.resize(0) || !journal_.seek(0)
+        || journal_.write(content) != content.size() || !journal_.flush()) {
+        error_ = journal_.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool TransferCheckpoint::flush()
+{
+    if (pendingRecords_.isEmpty()) {
+        return true;
+    }
+    if (!journal_.seek(journal_.size()) || journal_.write(pendingRecords_) != pendingRecords_.size()
+        || !journal_.flush()) {
+        error_ = journal_.errorString();
+        return false;
+    }
+    pendingRecords_.clear();
+    pendingBytes_ = 0;
+    sinceFlush_.restart();
+    stats_.flushes++;
+    return true;
+}
+
+} // namespace clipboard
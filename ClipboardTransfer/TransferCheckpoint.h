@@ -0,0 +1,99 @@
+#pragma once
+#include "TransferFile.h"
+#include <QElapsedTimer>
+#include <QFile>
+#include <QString>
+#include <memory>
+#include <vector>
+
+class QIODevice;
+class QLockFile;
+
+namespace clipboard {
+
+// 断点续传的检查点：在日志文件（.journal）中记录顺序读取的每个数据块的偏移、长度和CRC32C，
+// 不保存数据本身。生产者打开检查点后交给ChunkVerifier，记录由校验线程写入，CRC与端到端校验共用。日志开头记录源文件的路径、大小和修改时间，三者都一致时接收方用verify把
+// 上次写出的部分文件与日志逐块比对，校验通过的前缀不再传输，生产者从断点处定位源文件继续读取。
+// 日志按字节数或时间间隔批量刷新，进程被强行结束时最多丢失最后一批未刷新的记录。
+// 打开期间持有同名的锁文件，同一个源文件同时只有一个会话（或一个进程）使用它的检查点
+class TransferCheckpoint
+{
+public:
+    struct Statistics
+    {
+        qint64 resumedBytes = 0;        // 部分文件中校验通过、不再传输的字节数
+        qint64 writtenBytes = 0;        // 本次记入日志的字节数
+        qint64 invalidBytes = 0;        // 部分文件中因校验失败或没有日志记录而丢弃的字节数
+        qint64 flushes = 0;             // 日志刷新次数
+    };
+
+    TransferCheckpoint();
+    ~TransferCheckpoint();
+
+    TransferCheckpoint(const TransferCheckpoint&) = delete;
+    TransferCheckpoint& operator=(const TransferCheckpoint&) = delete;
+
+    // 打开file在directory中的检查点，目录不存在时创建；源文件身份与日志不一致时丢弃旧记录重新开始。
+    // 另一个会话或进程正在使用同一个检查点时返回false
+    bool open(const QString& directory, const TransferFile& file);
+    // 刷新未写入的日志记录并关闭文件、释放锁，检查点保留在磁盘上
+    void close();
+    bool isOpen() const;
+
+    // 日志中从偏移0开始连续的已完成字节数，即可以续传的位置
+    qint64 completedBytes() const;
+
+    // 按日志逐块校验接收方已写出的部分文件partial（须可读），返回校验通过的前缀长度，即续传的位置；
+    // 日志截断到该位置，partial中其后的数据应丢弃
+    qint64 verify(QIODevice& partial);
+    // 从offset继续记录：丢弃offset之后的记录，已完成前缀不足offset时返回false
+    bool resumeAt(qint64 offset);
+    // 记录紧接已完成前缀的数据块（checksum为它的CRC32C），其他位置的数据块忽略；返回false表示写入出错
+    bool append(qint64 offset, qint64 length, quint32 checksum);
+
+    QString errorString() const;
+    Statistics statistics() const;
+
+    // 删除file在directory中的检查点，文件完整传输后调用；检查点正被使用时保留
+    static void remove(const QString& directory, const TransferFile& file);
+
+    // 两次日志刷新之间最多积累的数据量和时间
+    static const qint64 FLUSH_BYTES = 8 * 1024 * 1024;
+    static const int FLUSH_INTERVAL_MS = 1000;
+
+private:
+    struct Record
+    {
+        qint64 offset;
+        qint64 length;
+        quint32 checksum;
+    };
+
+    // 检查点文件名由源文件路径的SHA-1决定，同一个源文件的新旧版本使用同一组文件
+    static QString basePath(const QString& directory, const TransferFile& file);
+    static qint64 modificationTime(const TransferFile& file);
+    QByteArray headerLine() const;
+    // 日志中的一条记录："偏移 长度 CRC32C"
+    static QByteArray recordLine(const Record& record);
+    // 解析日志，返回false表示身份不一致或格式不对
+    bool loadJournal();
+    // 重写日志，只保留from之前的记录
+    bool rewrite(qint64 from);
+    bool flush();
+
+    QFile journal_;
+    std::unique_ptr<QLockFile> lock_;
+    TransferFile file_;
+    qint64 modified_;
+    // 已完成前缀中的记录，按偏移递增且首尾相接
+    std::vector<Record> records_;
+    qint64 completed_;
+    // 尚未写入日志的记录
+    QByteArray pendingRecords_;
+    qint64 pendingBytes_;
+    QElapsedTimer sinceFlush_;
+    QString error_;
+    Statistics stats_;
+};
+
+} // namespace clipboard
@@ -0,0 +1,58 @@
+# 与平台无关的传输核心：生产者、队列、缓存、溢出层和readData读取路径
+# 不依赖Win32/OLE，Windows程序和Linux下的无界面基准测试共用
+
+# 网络数据来源和回环测试服务端使用QtNetwork
+QT += network
+
+INCLUDEPATH += $$PWD
+DEPENDPATH += $$PWD
+
+SOURCES += \
+     $$PWD/DataProducerThread.cpp \
+     $$PWD/FileBufferManager.cpp \
+     $$PWD/Pacer.cpp \
+     $$PWD/AdaptiveChunkSizer.cpp \
+     $$PWD/FileChunkSource.cpp \
+     $$PWD/ChunkBufferPool.cpp \
+     $$PWD/ChunkCache.cpp \
+     $$PWD/SpillFile.cpp \
+     $$PWD/TcpChunkSource.cpp \
+     $$PWD/ParallelRangeFetcher.cpp \
+     $$PWD/ChunkCompressor.cpp \
+     $$PWD/Crc32c.cpp \
+     $$PWD/ChunkVerifier.cpp \
+     $$PWD/TransferCheckpoint.cpp \
+     $$PWD/TransferMetrics.cpp \
+     $$PWD/ProgressAggregator.cpp \
+     $$PWD/TransferSessionManager.cpp \
+     $$PWD/TransferScheduler.cpp \
+     $$PWD/WakeupTimer.cpp \
+     $$PWD/UringFileSource.cpp
+
+HEADERS += \
+     $$PWD/DataProducerThread.h \
+     $$PWD/FileBufferManager.h \
+     $$PWD/SpscChunkRing.h \
+     $$PWD/Pacer.h \
+     $$PWD/AdaptiveChunkSizer.h \
+     $$PWD/DataChunk.h \
+     $$PWD/ChunkSource.h \
+     $$PWD/FileChunkSource.h \
+     $$PWD/ChunkBufferPool.h \
+     $$PWD/TransferFile.h \
+     $$PWD/ChunkCache.h \
+     $$PWD/SpillFile.h \
+     $$PWD/StreamSink.h \
+     $$PWD/ChunkProtocol.h \
+     $$PWD/TcpChunkSource.h \
+     $$PWD/ParallelRangeFetcher.h \
+     $$PWD/ChunkCompressor.h \
+     $$PWD/Crc32c.h \
+     $$PWD/ChunkVerifier.h \
+     $$PWD/TransferCheckpoint.h \
+     $$PWD/TransferMetrics.h \
+     $$PWD/ProgressAggregator.h \
+     $$PWD/TransferSessionManager.h \
+     $$PWD/TransferScheduler.h \
+     $$PWD/WakeupTimer.h \
+     $$PWD/UringFileSource.h
@@ -0,0 +1,12 @@
+# 传输核心静态库，qmake TransferCore.pro 可在Linux下单独构建
+QT = core
+CONFIG += c++17 staticlib
+
+TARGET = TransferCore
+TEMPLATE = lib
+
+CODECFORTR = UTF-8
+CODECFORSRC = UTF-8
+DESTDIR = $$PWD/lib
+
+include(TransferCore.pri)
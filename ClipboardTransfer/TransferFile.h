@@ -0,0 +1,17 @@
+#pragma once
+#include <QString>
+#include <QList>
+
+namespace clipboard {
+
+// 一次传输中的一个文件，在FILEGROUPDESCRIPTOR中的下标即lindex
+struct TransferFile
+{
+    QString filePath;   // 源文件完整路径
+    QString fileName;   // 粘贴时显示的文件名
+    qint64 fileSize = 0;
+};
+
+using TransferFileList = QList<TransferFile>;
+
+} // namespace clipboard
@@ -0,0 +1,177 @@
+#include "TransferMetrics.h"
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QtAlgorithms>
+
+namespace clipboard {
+
+LatencyHistogram::LatencyHistogram()
+{
+    reset();
+}
+
+int LatencyHistogram::bucketIndex(qint64 value)
+{
+    if (value < SUB_BUCKETS) {
+        return value < 0 ? 0 : static_cast<int>(value);
+    }
+    // 最高位之后保留SUB_BUCKET_BITS位作为桶内的位置
+    const int exponent = 63 - qCountLeadingZeroBits(static_cast<quint64>(value));
+    const int shift = exponent - SUB_BUCKET_BITS;
+    const int sub = static_cast<int>(value >> shift) & (SUB_BUCKETS - 1);
+    return (shift + 1) * SUB_BUCKETS + sub;
+}
+
+qint64 LatencyHistogram::bucketUpperBound(int index)
+{
+    if (index < SUB_BUCKETS) {
+        return index;
+    }
+    const int shift = index / SUB_BUCKETS - 1;
+    const qint64 sub = index % SUB_BUCKETS;
+    return ((SUB_BUCKETS + sub + 1) << shift) - 1;
+}
+
+void LatencyHistogram::record(qint64 ns)
+{
+    ns = qMax(ns, (qint64)0);
+    buckets_[bucketIndex(ns)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    totalNs_.fetch_add(ns, std::memory_order_relaxed);
+    qint64 max = maxNs_.load(std::memory_order_relaxed);
+    while (ns > max && !maxNs_.compare_exchange_weak(max, ns, std::memory_order_relaxed)) {
+    }
+}
+
+LatencyHistogram::Snapshot LatencyHistogram::snapshot() const
+{
+    Snapshot snapshot;
+    snapshot.buckets.resize(BUCKET_COUNT);
+    for (int i = 0; i < BUCKET_COUNT; ++i) {
+        snapshot.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+    }
+    snapshot.count = count_.load(std::memory_order_relaxed);
+    snapshot.totalNs = totalNs_.load(std::memory_order_relaxed);
+    snapshot.maxNs = maxNs_.load(std::memory_order_relaxed);
+    return snapshot;
+}
+
+void LatencyHistogram::reset()
+{
+    for (std::atomic<qint64>& bucket : buckets_) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    count_.store(0, std::memory_order_relaxed);
+    totalNs_.store(0, std::memory_order_relaxed);
+    maxNs_.store(0, std::memory_order_relaxed);
+}
+
+qint64 LatencyHistogram::Snapshot::percentile(double p) const
+{
+    qint64 total = 0;
+    for (qint64 n : buckets) {
+        total += n;
+    }
+    if (total == 0) {
+        return 0;
+    }
+    const qint64 rank = qMax((qint64)1, static_cast<qint64>(qBound(0.0, p, 1.0) * total + 0.5));
+    qint64 seen = 0;
+    for (size_t i = 0; i < buckets.size(); ++i) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            return qMin(bucketUpperBound(static_cast<int>(i)), maxNs);
+        }
+    }
+    return maxNs;
+}
+
+TransferMetrics::TransferMetrics()
+{
+    reset();
+}
+
+void TransferMetrics::reset()
+{
+    for (int stage = 0; stage < StageCount; ++stage) {
+        histograms_[stage].reset();
+        bytes_[stage].store(0, std::memory_order_relaxed);
+    }
+    clock_.start();
+}
+
+void TransferMetrics::record(Stage stage, qint64 ns, qint64 bytes)
+{
+    histograms_[stage].record(ns);
+    if (bytes > 0) {
+        bytes_[stage].fetch_add(bytes, std::memory_order_relaxed);
+    }
+}
+
+LatencyHistogram::Snapshot TransferMetrics::histogram(Stage stage) const
+{
+    return histograms_[stage].snapshot();
+}
+
+qint64 TransferMetrics::bytes(Stage stage) const
+{
+    return bytes_[stage].load(std::memory_order_relaxed);
+}
+
+QByteArray TransferMetrics::toJson() const
+{
+    const qint64 elapsed = elapsedNs();
+    QJsonObject stages;
+    for (int i = 0; i < StageCount; ++i) {
+        const Stage stage = static_cast<Stage>(i);
+        const LatencyHistogram::Snapshot snapshot = histogram(stage);
+        const qint64 stageBytes = bytes(stage);
+
+        QJsonObject object;
+        object.insert(QStringLiteral("count"), snapshot.count);
+        object.insert(QStringLiteral("bytes"), stageBytes);
+        object.insert(QStringLiteral("totalMs"), snapshot.totalNs / 1e6);
+        object.insert(QStringLiteral("meanUs"), snapshot.meanNs() / 1e3);
+        object.insert(QStringLiteral("p50Us"), snapshot.percentile(0.50) / 1e3);
+        object.insert(QStringLiteral("p90Us"), snapshot.percentile(0.90) / 1e3);
+        object.insert(QStringLiteral("p99Us"), snapshot.percentile(0.99) / 1e3);
+        object.insert(QStringLiteral("p999Us"), snapshot.percentile(0.999) / 1e3);
+        object.insert(QStringLiteral("maxUs"), snapshot.maxNs / 1e3);
+        // 累计耗时占传输时间的比例，接近1的阶段即瓶颈；并发读取或多个数据块同时在队列中时可能超过1
+        object.insert(QStringLiteral("utilization"), elapsed > 0 ? double(snapshot.totalNs) / elapsed : 0.0);
+        // 只算该阶段自身耗时的速率，即该阶段单独能达到的吞吐
+        object.insert(QStringLiteral("stageBytesPerSecond"),
+                      snapshot.totalNs > 0 ? stageBytes * 1e9 / snapshot.totalNs : 0.0);
+        object.insert(QStringLiteral("bytesPerSecond"), elapsed > 0 ? stageBytes * 1e9 / elapsed : 0.0);
+        stages.insert(QLatin1String(stageName(stage)), object);
+    }
+
+    QJsonObject root;
+    root.insert(QStringLiteral("elapsedMs"), elapsed / 1e6);
+    root.insert(QStringLiteral("stages"), stages);
+    return QJsonDocument(root).toJson(QJsonDocument::Compact);
+}
+
+const char* TransferMetrics::stageName(Stage stage)
+{
+    switch (stage) {
+    case SourceRead:
+        return "sourceRead";
+    case ProducerWait:
+        return "producerWait";
+    case SchedulerWait:
+        return "schedulerWait";
+    case QueueResidency:
+        return "queueResidency";
+    case ConsumerWait:
+        return "consumerWait";
+    case Copy:
+        return "copy";
+    case EnqueueToReturn:
+        return "enqueueToReturn";
+    default:
+        return "unknown";
+    }
+}
+
+} // namespace clipboard
@@ -0,0 +1,100 @@
+#pragma once
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <atomic>
+#include <vector>
+
+namespace clipboard {
+
+// 对数线性分桶的延迟直方图（HDR风格）：小于16纳秒的值各占一个桶，之后每个2的幂区间
+// 再均分为16个桶，相对误差不超过1/16。记录只做几次无锁的原子加，可以在热路径上调用
+class LatencyHistogram
+{
+public:
+    struct Snapshot
+    {
+        qint64 count = 0;
+        qint64 totalNs = 0;
+        qint64 maxNs = 0;
+        std::vector<qint64> buckets;
+
+        double meanNs() const {
+            return count > 0 ? double(totalNs) / count : 0.0;
+        }
+        // 第p（0~1）分位数所在桶的上界，不超过最大值
+        qint64 percentile(double p) const;
+    };
+
+    LatencyHistogram();
+
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+    void record(qint64 ns);
+    // 各计数分别读取，与并发的record之间不保证是同一时刻的快照
+    Snapshot snapshot() const;
+    void reset();
+
+    static int bucketIndex(qint64 value);
+    // 桶中最大的值
+    static qint64 bucketUpperBound(int index);
+
+    static const int SUB_BUCKET_BITS = 4;
+    static const int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static const int BUCKET_COUNT = (64 - SUB_BUCKET_BITS) * SUB_BUCKETS;
+
+private:
+    std::atomic<qint64> buckets_[BUCKET_COUNT];
+    std::atomic<qint64> count_;
+    std::atomic<qint64> totalNs_;
+    std::atomic<qint64> maxNs_;
+};
+
+// 传输管道各阶段的耗时直方图和字节计数，生产者、消费者和并发读取的工作任务各自记录，
+// 通过FileBufferManager查询或导出为JSON，用来判断哪个阶段限制了传输速度
+class TransferMetrics
+{
+public:
+    enum Stage {
+        SourceRead,         // 生产者从数据来源（或检查点）读取一个数据块
+        ProducerWait,       // 生产者入队时因背压等待缓冲空间
+        SchedulerWait,      // 生产者读取前等待调度器分配I/O时隙
+        QueueResidency,     // 数据块从入队到被readData一侧取出
+        ConsumerWait,       // readData等待数据到达
+        Copy,               // readData从缓存复制到调用方缓冲区
+        EnqueueToReturn,    // 数据块入队到取出它的readData调用返回，即交接给读取方的总延迟
+        StageCount
+    };
+
+    TransferMetrics();
+
+    TransferMetrics(const TransferMetrics&) = delete;
+    TransferMetrics& operator=(const TransferMetrics&) = delete;
+
+    // 清零并重新开始计时，在没有其他线程记录时调用
+    void reset();
+    // 自reset起的纳秒数，用作入队时间戳
+    qint64 now() const {
+        return clock_.nsecsElapsed();
+    }
+    qint64 elapsedNs() const {
+        return clock_.nsecsElapsed();
+    }
+
+    void record(Stage stage, qint64 ns, qint64 bytes = 0);
+
+    LatencyHistogram::Snapshot histogram(Stage stage) const;
+    qint64 bytes(Stage stage) const;
+
+    // 每个阶段的次数、字节数、分位数、累计耗时占总时间的比例和按累计耗时计算的速率
+    QByteArray toJson() const;
+
+    static const char* stageName(Stage stage);
+
+private:
+    QElapsedTimer clock_;
+    LatencyHistogram histograms_[StageCount];
+    std::atomic<qint64> bytes_[StageCount];
+};
+
+} // namespace clipboard
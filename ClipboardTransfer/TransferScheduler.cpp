@@ -0,0 +1,256 @@
+#include "TransferScheduler.h"
+#include <algorithm>
+#include <vector>
+
+namespace clipboard {
+
+TransferScheduler::TransferScheduler(int slotCount)
+    : policy_(Fifo)
+    , slotCount_(qMax(slotCount, 1))
+    , slotsInUse_(0)
+    , nextId_(1)
+    , nextArrival_(0)
+    , virtualClock_(0.0)
+{
+    clock_.start();
+}
+
+void TransferScheduler::setPolicy(Policy policy)
+{
+    QMutexLocker locker(&mutex_);
+    policy_ = policy;
+    wakeWaitersLocked();
+}
+
+TransferScheduler::Policy TransferScheduler::policy() const
+{
+    QMutexLocker locker(&mutex_);
+    return policy_;
+}
+
+void TransferScheduler::setSlotCount(int slotCount)
+{
+    QMutexLocker locker(&mutex_);
+    slotCount_ = qMax(slotCount, 1);
+    wakeWaitersLocked();
+}
+
+int TransferScheduler::slotCount() const
+{
+    QMutexLocker locker(&mutex_);
+    return slotCount_;
+}
+
+int TransferScheduler::enroll(qint64 totalBytes, int priority)
+{
+    QMutexLocker locker(&mutex_);
+    Transfer transfer;
+    transfer.totalBytes = qMax(totalBytes, (qint64)0);
+    transfer.priority = qMax(priority, 1);
+    transfer.arrival = nextArrival_++;
+    transfer.virtualTime = virtualClock_;
+    const int id = nextId_++;
+    transfers_[id] = transfer;
+    return id;
+}
+
+void TransferScheduler::withdraw(int id)
+{
+    QMutexLocker locker(&mutex_);
+    auto it = transfers_.find(id);
+    if (it == transfers_.end()) {
+        return;
+    }
+    slotsInUse_ -= it->second.holding;
+    transfers_.erase(it);
+    wakeWaitersLocked();
+}
+
+bool TransferScheduler::tryAcquire(int id, const void* waiter, const std::function<void()>& wakeup)
+{
+    QMutexLocker locker(&mutex_);
+    auto it = transfers_.find(id);
+    if (it == transfers_.end()) {
+        return true;
+    }
+    Transfer& transfer = it->second;
+
+    // 空闲（例如等待背压）之后重新申请的传输从当前虚拟时间开始，不能用空闲期间积累的额度连续占用时隙
+    if (transfer.waiters.empty() && transfer.holding == 0) {
+        transfer.virtualTime = qMax(transfer.virtualTime, virtualClock_);
+    }
+    const qint64 now = clock_.nsecsElapsed();
+    auto entry = transfer.waiters.find(waiter);
+    const bool waited = entry != transfer.waiters.end();
+    if (!waited) {
+        entry = transfer.waiters.emplace(waiter, Waiter()).first;
+        entry->second.sinceNs = now;
+    }
+    entry->second.wakeup = wakeup;
+    entry->second.notified = false;
+
+    // 按策略排在前面的传输的等待者先得到空闲时隙
+    if (slotsInUse_ + waitersAheadLocked(transfer) >= slotCount_) {
+        // 排在前面的等待者足以用完空闲时隙，确认它们都已被回调
+        wakeWaitersLocked();
+        return false;
+    }
+    stats_.grants++;
+    if (waited) {
+        stats_.waits++;
+        stats_.waitNs += now - entry->second.sinceNs;
+    }
+    transfer.waiters.erase(entry);
+    transfer.holding++;
+    slotsInUse_++;
+    virtualClock_ = transfer.virtualTime;
+    return true;
+}
+
+void TransferScheduler::cancelWait(int id, const void* waiter)
+{
+    QMutexLocker locker(&mutex_);
+    auto it = transfers_.find(id);
+    if (it == transfers_.end() || it->second.waiters.erase(waiter) == 0) {
+        return;
+    }
+    // 已被回调的等待者不再来申请，它占着的空闲时隙交给下一个
+    wakeWaitersLocked();
+}
+
+void TransferScheduler::release(int id, qint64 bytes)
+{
+    QMutexLocker locker(&mutex_);
+    auto it = transfers_.find(id);
+    if (it == transfers_.end() || it->second.holding == 0) {
+        return;
+    }
+    Transfer& transfer = it->second;
+    transfer.holding--;
+    transfer.servedBytes += bytes;
+    transfer.virtualTime += static_cast<double>(bytes) / transfer.priority;
+    slotsInUse_--;
+    wakeWaitersLocked();
+}
+
+int TransferScheduler::runPriority(int id) const
+{
+    QMutexLocker locker(&mutex_);
+    auto it = transfers_.find(id);
+    if (it == transfers_.end()) {
+        return 0;
+    }
+    int ahead = 0;
+    for (const auto& entry : transfers_) {
+        if (entry.first != id && precedesLocked(entry.second, it->second)) {
+            ahead++;
+        }
+    }
+    return -ahead;
+}
+
+int TransferScheduler::transferCount() const
+{
+    QMutexLocker locker(&mutex_);
+    return static_cast<int>(transfers_.size());
+}
+
+TransferScheduler::Statistics TransferScheduler::statistics() const
+{
+    QMutexLocker locker(&mutex_);
+    return stats_;
+}
+
+int TransferScheduler::waitersAheadLocked(const Transfer& transfer) const
+{
+    int ahead = 0;
+    for (const auto& entry : transfers_) {
+        if (&entry.second != &transfer && precedesLocked(entry.second, transfer)) {
+            ahead += static_cast<int>(entry.second.waiters.size());
+        }
+    }
+    return ahead;
+}
+
+void TransferScheduler::wakeWaitersLocked()
+{
+    int free = slotCount_ - slotsInUse_;
+    if (free <= 0) {
+        return;
+    }
+    std::vector<Transfer*> waiting;
+    for (auto& entry : transfers_) {
+        if (!entry.second.waiters.empty()) {
+            waiting.push_back(&entry.second);
+        }
+    }
+    std::sort(waiting.begin(), waiting.end(),
+              [this](const Transfer* a, const Transfer* b) { return precedesLocked(*a, *b); });
+    // 与tryAcquire的判断一致：只回调重新申请时能得到时隙的等待者，已回调的也占一个名额
+    for (Transfer* transfer : waiting) {
+        for (auto& entry : transfer->waiters) {
+            if (free <= 0) {
+                return;
+            }
+            Waiter& waiter = entry.second;
+            if (!waiter.notified) {
+                waiter.notified = true;
+                waiter.wakeup();
+            }
+            free--;
+        }
+    }
+}
+
+bool TransferScheduler::precedesLocked(const Transfer& a, const Transfer& b) const
+{
+    switch (policy_) {
+    case ShortestRemainingFirst:
+        if (a.priority != b.priority) {
+            return a.priority > b.priority;
+        }
+        if (a.totalBytes - a.servedBytes != b.totalBytes - b.servedBytes) {
+            return a.totalBytes - a.servedBytes < b.totalBytes - b.servedBytes;
+        }
+        break;
+    case WeightedFair:
+        if (a.virtualTime != b.virtualTime) {
+            return a.virtualTime < b.virtualTime;
+        }
+        break;
+    case Fifo:
+    default:
+        if (a.priority != b.priority) {
+            return a.priority > b.priority;
+        }
+        break;
+    }
+    return a.arrival < b.arrival;
+}
+
+const char* TransferScheduler::policyName(Policy policy)
+{
+    switch (policy) {
+    case Fifo:
+        return "fifo";
+    case ShortestRemainingFirst:
+        return "srpt";
+    case WeightedFair:
+        return "wfq";
+    default:
+        return "unknown";
+    }
+}
+
+bool TransferScheduler::parsePolicy(const QString& name, Policy& policy)
+{
+    for (Policy candidate : { Fifo, ShortestRemainingFirst, WeightedFair }) {
+        if (name == QLatin1String(policyName(candidate))) {
+            policy = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace clipboard
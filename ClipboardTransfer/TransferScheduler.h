@@ -0,0 +1,113 @@
+#pragma once
+#include <QtGlobal>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QString>
+#include <functional>
+#include <map>
+
+namespace clipboard {
+
+// 在多个传输之间分配I/O时隙。生产者（和并发读取的工作任务）每读取一个数据块前申请一个时隙，
+// 读完即归还，所以时隙在数据块之间按策略重新分配：一个很大的传输不会一直占着磁盘，
+// 让排在后面的小文件等到它读完。在背压上等待缓冲空间时不占时隙。
+// 申请不阻塞：没有轮到的申请者登记一个唤醒回调后让出线程，时隙空出且按策略轮到它时被回调，再重新申请。
+// 生产任务和工作任务还按runPriority排在共用线程池的队列中，线程被占满时也按策略决定下一个运行的会话
+class TransferScheduler
+{
+public:
+    enum Policy {
+        Fifo,                   // 先开始的传输优先
+        ShortestRemainingFirst, // 剩余字节最少的传输优先，平均完成时间最短，大传输可能被持续推后
+        WeightedFair            // 按优先级作为权重分配读取的字节数
+    };
+
+    struct Statistics
+    {
+        qint64 grants = 0;      // 分配出的时隙次数
+        qint64 waits = 0;       // 申请时没有立即得到时隙的次数
+        qint64 waitNs = 0;      // 等待时隙的累计时间
+    };
+
+    explicit TransferScheduler(int slotCount = DEFAULT_SLOTS);
+
+    void setPolicy(Policy policy);
+    Policy policy() const;
+    // 同时读取数据来源的数据块个数上限
+    void setSlotCount(int slotCount);
+    int slotCount() const;
+
+    // 传输开始读取时登记，totalBytes为需要读取的字节数，返回之后申请时隙使用的编号。
+    // priority越大越优先：Fifo和ShortestRemainingFirst下高优先级的传输总是先于低优先级的，
+    // WeightedFair下作为权重，优先级2的传输得到的字节数是优先级1的两倍
+    int enroll(qint64 totalBytes, int priority = DEFAULT_PRIORITY);
+    // 传输结束或停止时注销，之后以这个编号申请时隙会立即返回
+    void withdraw(int id);
+
+    // 读取一个数据块前调用，按策略轮到该传输且有空闲时隙时占用一个并返回true。
+    // 否则以waiter（同一传输中区分申请者，如生产者和各个工作任务）登记为等待者并返回false，
+    // 之后时隙空出、按策略轮到它时调用一次wakeup，收到后再次tryAcquire。
+    // wakeup在持有调度器的锁时调用，应当只重新提交任务，不能再调用调度器
+    bool tryAcquire(int id, const void* waiter, const std::function<void()>& wakeup);
+    // 取消waiter的等待登记，返回后不会再调用它的wakeup；申请者停止时调用
+    void cancelWait(int id, const void* waiter);
+    // 读取后归还时隙，bytes计入该传输已读取的字节数
+    void release(int id, qint64 bytes);
+    // 传输的任务提交到线程池时使用的优先级（QThreadPool::start的priority）：按策略排在最前的传输为0，
+    // 每有一个传输排在它前面减一。线程数少于会话数时由它决定排队的任务中哪个先运行，未登记的编号返回0
+    int runPriority(int id) const;
+
+    // 登记中的传输个数
+    int transferCount() const;
+    Statistics statistics() const;
+
+    static const char* policyName(Policy policy);
+    // 按policyName的名字解析，无法识别时返回false
+    static bool parsePolicy(const QString& name, Policy& policy);
+
+    static const int DEFAULT_SLOTS = 4;
+    static const int DEFAULT_PRIORITY = 1;
+
+private:
+    // 登记的等待者，notified表示已回调、正等它重新申请
+    struct Waiter
+    {
+        std::function<void()> wakeup;
+        qint64 sinceNs = 0;
+        bool notified = false;
+    };
+
+    struct Transfer
+    {
+        qint64 totalBytes = 0;
+        qint64 servedBytes = 0;
+        int priority = DEFAULT_PRIORITY;
+        // 登记顺序，作为Fifo的次序和其他策略下的平局裁决
+        quint64 arrival = 0;
+        // WeightedFair的虚拟时间：已读取的字节数除以权重
+        double virtualTime = 0.0;
+        std::map<const void*, Waiter> waiters;
+        int holding = 0;
+    };
+
+    // 按策略排在transfer之前的传输的等待者个数，它们先于transfer得到空闲时隙
+    int waitersAheadLocked(const Transfer& transfer) const;
+    // 按策略顺序回调等待者，直到已回调而尚未重新申请的个数等于空闲时隙数
+    void wakeWaitersLocked();
+    // a是否应先于b得到时隙
+    bool precedesLocked(const Transfer& a, const Transfer& b) const;
+
+    mutable QMutex mutex_;
+    QElapsedTimer clock_;
+    Policy policy_;
+    int slotCount_;
+    int slotsInUse_;
+    int nextId_;
+    quint64 nextArrival_;
+    // 最近一次分配时隙时的虚拟时间，新登记或空闲后重新申请的传输从这里开始，不会因为之前没有读取而积累额度
+    double virtualClock_;
+    std::map<int, Transfer> transfers_;
+    Statistics stats_;
+};
+
+} // namespace clipboard
@@ -0,0 +1,124 @@
+#include "TransferSessionManager.h"
+#include <algorithm>
+
+namespace clipboard {
+
+TransferSessionManager::TransferSessionManager(int ioThreads, QObject* parent)
+    : QObject(parent)
+{
+    setMaxIoThreads(ioThreads);
+}
+
+TransferSessionManager::~TransferSessionManager()
+{
+    // 先停止所有生产者，等待背压而让出线程的任务在停止时收尾，线程池析构时没有排队的任务；
+    // 呈现端仍持有的会话之后改用自己的线程，不再经过调度
+    stopAll();
+    for (const std::shared_ptr<FileBufferManager>& session : sessions_) {
+        session->setThreadPool(nullptr);
+        session->setScheduler(nullptr);
+    }
+    sessions_.clear();
+    ioThreadPool_.waitForDone();
+}
+
+std::shared_ptr<FileBufferManager> TransferSessionManager::createSession()
+{
+    std::shared_ptr<FileBufferManager> session = FileBufferManager::create();
+    session->setThreadPool(&ioThreadPool_);
+    session->setScheduler(&scheduler_);
+    sessions_.push_back(session);
+    return session;
+}
+
+void TransferSessionManager::closeSession(const std::shared_ptr<FileBufferManager>& session)
+{
+    auto it = std::find(sessions_.begin(), sessions_.end(), session);
+    if (it == sessions_.end()) {
+        return;
+    }
+    (*it)->stopTransfer();
+    (*it)->setThreadPool(nullptr);
+    (*it)->setScheduler(nullptr);
+    sessions_.erase(it);
+}
+
+int TransferSessionManager::closeFinishedSessions()
+{
+    int closed = 0;
+    for (auto it = sessions_.begin(); it != sessions_.end(); ) {
+        FileBufferManager* session = it->get();
+        if (!session->isTransferActive() || session->getTotalReadBytes() >= session->getFileSize()) {
+            session->stopTransfer();
+            session->setThreadPool(nullptr);
+            session->setScheduler(nullptr);
+            it = sessions_.erase(it);
+            ++closed;
+        } else {
+            ++it;
+        }
+    }
+    return closed;
+}
+
+void TransferSessionManager::stopAll()
+{
+    for (const std::shared_ptr<FileBufferManager>& session : sessions_) {
+        session->stopTransfer();
+    }
+}
+
+QList<std::shared_ptr<FileBufferManager>> TransferSessionManager::sessions() const
+{
+    QList<std::shared_ptr<FileBufferManager>> list;
+    for (const std::shared_ptr<FileBufferManager>& session : sessions_) {
+        list.append(session);
+    }
+    return list;
+}
+
+int TransferSessionManager::sessionCount() const
+{
+    return static_cast<int>(sessions_.size());
+}
+
+int TransferSessionManager::activeSessionCount() const
+{
+    return static_cast<int>(std::count_if(sessions_.begin(), sessions_.end(),
+        [](const std::shared_ptr<FileBufferManager>& session) { return session->isTransferActive(); }));
+}
+
+void TransferSessionManager::setMaxIoThreads(int threadCount)
+{
+    scheduler_.setSlotCount(threadCount > 0 ? threadCount : DEFAULT_IO_THREADS);
+    // 生产任务等待时让出线程、按时间片轮流运行，线程数与时隙数相同，不随会话数增长；
+    // 排队的任务按调度器给出的优先级出队，由调度策略而不是提交顺序决定下一个运行的会话
+    ioThreadPool_.setMaxThreadCount(scheduler_.slotCount());
+}
+
+int TransferSessionManager::maxIoThreads() const
+{
+    return scheduler_.slotCount();
+}
+
+void TransferSessionManager::setSchedulingPolicy(TransferScheduler::Policy policy)
+{
+    scheduler_.setPolicy(policy);
+}
+
+TransferScheduler::Policy TransferSessionManager::schedulingPolicy() const
+{
+    return scheduler_.policy();
+}
+
+TransferScheduler* TransferSessionManager::scheduler()
+{
+    return &scheduler_;
+}
+
+QThreadPool* TransferSessionManager::ioThreadPool()
+{
+    return &ioThreadPool_;
+}
+
+} // namespace clipboard
@@ -0,0 +1,57 @@
+#pragma once
+#include "FileBufferManager.h"
+#include <QObject>
+#include <QThreadPool>
+#include <memory>
+#include <vector>
+
+namespace clipboard {
+
+// 管理同时进行的多个传输会话。每个会话有自己的缓冲和状态，开始新的传输不会停止其他会话；
+// 所有会话的生产者共用一个I/O线程池，同时读取来源的数据块个数由调度器的时隙数限制，
+// 时隙在数据块之间按调度策略分配给各个会话，线程池中排队的任务也按调度策略出队
+class TransferSessionManager : public QObject
+{
+    Q_OBJECT
+
+public:
+    // ioThreads为同时读取来源的I/O时隙数，0表示DEFAULT_IO_THREADS
+    explicit TransferSessionManager(int ioThreads = 0, QObject* parent = nullptr);
+    // 停止所有会话并等待生产者退出
+    ~TransferSessionManager();
+
+    // 创建一个使用共用线程池的新会话，会话在closeSession之前一直由本对象持有。
+    // 会话对象在最后一个shared_ptr释放时销毁，不在所属线程时通过deleteLater销毁
+    std::shared_ptr<FileBufferManager> createSession();
+    // 停止会话的传输并不再持有它，呈现端仍持有时会话在其释放后销毁
+    void closeSession(const std::shared_ptr<FileBufferManager>& session);
+    // 关闭所有数据已被完整读取或已停止的会话，返回关闭的个数，在GUI线程调用
+    int closeFinishedSessions();
+    // 停止所有会话的传输，会话仍被持有，可以重新开始
+    void stopAll();
+
+    QList<std::shared_ptr<FileBufferManager>> sessions() const;
+    int sessionCount() const;
+    // 传输仍在进行的会话个数
+    int activeSessionCount() const;
+
+    // 同时读取来源的I/O时隙数，也是线程池的线程数，会话数更多时各会话的生产任务按调度策略轮流使用线程
+    void setMaxIoThreads(int threadCount);
+    int maxIoThreads() const;
+    QThreadPool* ioThreadPool();
+
+    // 时隙的分配策略，默认Fifo，对已开始的传输立即生效
+    void setSchedulingPolicy(TransferScheduler::Policy policy);
+    TransferScheduler::Policy schedulingPolicy() const;
+    TransferScheduler* scheduler();
+
+    static const int DEFAULT_IO_THREADS = 4;
+
+private:
+    // 线程池析构时等待生产任务结束，须在调度器之后声明
+    TransferScheduler scheduler_;
+    QThreadPool ioThreadPool_;
+    std::vector<std::shared_ptr<FileBufferManager>> sessions_;
+};
+
+} // namespace clipboard
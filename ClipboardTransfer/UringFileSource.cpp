@@ -0,0 +1,517 @@
+#include "UringFileSource.h"
+#include <QDebug>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#if defined(Q_OS_LINUX) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define CLIPBOARD_HAVE_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+#endif
+
+namespace clipboard {
+
+#ifdef CLIPBOARD_HAVE_IO_URING
+// 不依赖liburing，直接通过系统调用使用提交队列和完成队列的共享内存。
+// 一个Ring只在一个线程中使用，与内核之间的同步只需要头尾指针的acquire/release
+struct UringFileSource::Ring
+{
+    int fd = -1;
+    unsigned entries = 0;
+    void* sqRing = MAP_FAILED;
+    size_t sqRingSize = 0;
+    void* cqRing = MAP_FAILED;
+    size_t cqRingSize = 0;
+    io_uring_sqe* sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+    size_t sqesSize = 0;
+
+    unsigned* sqHead = nullptr;
+    unsigned* sqTail = nullptr;
+    unsigned sqMask = 0;
+    unsigned* sqArray = nullptr;
+    unsigned* cqHead = nullptr;
+    unsigned* cqTail = nullptr;
+    unsigned cqMask = 0;
+    io_uring_cqe* cqes = nullptr;
+    // 已放入提交队列、还未通过io_uring_enter提交的请求个数
+    unsigned unsubmitted = 0;
+    // 每个预读块的缓冲区，也是注册固定缓冲区和IORING_OP_READV请求使用的iovec
+    std::vector<iovec> vectors;
+
+    ~Ring()
+    {
+        if (sqes != MAP_FAILED) {
+            munmap(sqes, sqesSize);
+        }
+        if (cqRing != MAP_FAILED && cqRing != sqRing) {
+            munmap(cqRing, cqRingSize);
+        }
+        if (sqRing != MAP_FAILED) {
+            munmap(sqRing, sqRingSize);
+        }
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+
+    bool setup(unsigned queueDepth)
+    {
+        io_uring_params params;
+        memset(&params, 0, sizeof(params));
+        fd = static_cast<int>(syscall(__NR_io_uring_setup, queueDepth, &params));
+        if (fd < 0) {
+            return false;
+        }
+        entries = params.sq_entries;
+
+        sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        // 5.4以后的内核提交队列和完成队列共用一次映射
+        const bool singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (singleMap) {
+            sqRingSize = cqRingSize = qMax(sqRingSize, cqRingSize);
+        }
+        sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        if (sqRing == MAP_FAILED) {
+            return false;
+        }
+        cqRing = singleMap ? sqRing
+                           : mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (cqRing == MAP_FAILED) {
+            return false;
+        }
+        sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        sqes = static_cast<io_uring_sqe*>(mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                               fd, IORING_OFF_SQES));
+        if (sqes == MAP_FAILED) {
+            return false;
+        }
+
+        char* sq = static_cast<char*>(sqRing);
+        sqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+        sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        char* cq = static_cast<char*>(cqRing);
+        cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        return true;
+    }
+
+    bool registerBuffers(const iovec* buffers, unsigned count)
+    {
+        return syscall(__NR_io_uring_register, fd, IORING_REGISTER_BUFFERS, buffers, count) == 0;
+    }
+
+    // 把预读块slot的读取请求放入提交队列。注册了固定缓冲区时使用IORING_OP_READ_FIXED，
+    // 否则使用IORING_OP_READV：两者与io_uring本身一样从5.1开始支持，IORING_OP_READ要到5.6
+    bool pushRead(int fileFd, int slot, qint64 length, qint64 offset, bool fixed)
+    {
+        const unsigned tail = *sqTail;
+        if (tail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE) >= entries) {
+            return false;
+        }
+        const unsigned index = tail & sqMask;
+        io_uring_sqe* sqe = &sqes[index];
+        memset(sqe, 0, sizeof(*sqe));
+        iovec& vector = vectors[static_cast<size_t>(slot)];
+        sqe->fd = fileFd;
+        sqe->off = static_cast<quint64>(offset);
+        if (fixed) {
+            sqe->opcode = IORING_OP_READ_FIXED;
+            sqe->addr = reinterpret_cast<quint64>(vector.iov_base);
+            sqe->len = static_cast<unsigned>(length);
+            sqe->buf_index = static_cast<quint16>(slot);
+        } else {
+            // 5.5之前的内核在请求执行时才读取iovec，它必须保持有效直到完成，所以每个块使用自己的iovec
+            vector.iov_len = static_cast<size_t>(length);
+            sqe->opcode = IORING_OP_READV;
+            sqe->addr = reinterpret_cast<quint64>(&vector);
+            sqe->len = 1;
+        }
+        sqe->user_data = static_cast<quint64>(slot);
+        sqArray[index] = index;
+        __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+        unsubmitted++;
+        return true;
+    }
+
+    // 提交队列中的请求，minComplete大于0时同时等待这么多个完成事件
+    bool enter(unsigned minComplete)
+    {
+        for (;;) {
+            const unsigned flags = minComplete > 0 ? IORING_ENTER_GETEVENTS : 0;
+            const long submitted = syscall(__NR_io_uring_enter, fd, unsubmitted, minComplete, flags, nullptr, 0);
+            if (submitted >= 0) {
+                unsubmitted -= qMin(unsubmitted, static_cast<unsigned>(submitted));
+                return true;
+            }
+            if (errno != EINTR) {
+                return false;
+            }
+        }
+    }
+
+    bool hasCompletion() const
+    {
+        return *cqHead != __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+    }
+
+    // 取出一个完成事件，没有时返回false
+    bool popCompletion(quint64& userData, int& result)
+    {
+        const unsigned head = *cqHead;
+        if (head == __atomic_load_n(cqTail, __ATOMIC_ACQUIRE)) {
+            return false;
+        }
+        const io_uring_cqe& cqe = cqes[head & cqMask];
+        userData = cqe.user_data;
+        result = cqe.res;
+        __atomic_store_n(cqHead, head + 1, __ATOMIC_RELEASE);
+        return true;
+    }
+};
+#else
+struct UringFileSource::Ring
+{
+};
+#endif
+
+UringFileSource::UringFileSource(int queueDepth, qint64 blockSize)
+    : buffers_(nullptr)
+    , queueDepth_(qBound(1, queueDepth, static_cast<int>(MAX_QUEUE_DEPTH)))
+    , blockSize_(qMax(blockSize, (qint64)MIN_BLOCK_SIZE))
+    , fallback_(false)
+    , registered_(false)
+    , fileSize_(0)
+    , position_(0)
+    , submitOffset_(0)
+    , rangeEnd_(0)
+    , headSlot_(0)
+    , queued_(0)
+    , inFlight_(0)
+{
+}
+
+UringFileSource::~UringFileSource()
+{
+    close();
+    // 先关闭io_uring，内核不再引用固定缓冲区后才能释放
+    ring_.reset();
+    free(buffers_);
+}
+
+qint64 UringFileSource::blockSizeFor(int queueDepth, qint64 prefetchBudget)
+{
+    if (prefetchBudget <= 0) {
+        return DEFAULT_BLOCK_SIZE;
+    }
+    const int depth = qBound(1, queueDepth, static_cast<int>(MAX_QUEUE_DEPTH));
+    // 向下取整到页大小，预算不够时每块至少一页
+    const qint64 blockSize = prefetchBudget / depth / MIN_BLOCK_SIZE * MIN_BLOCK_SIZE;
+    return qBound((qint64)MIN_BLOCK_SIZE, blockSize, (qint64)DEFAULT_BLOCK_SIZE);
+}
+
+bool UringFileSource::isSupported()
+{
+#ifdef CLIPBOARD_HAVE_IO_URING
+    Ring ring;
+    return ring.setup(1);
+#else
+    return false;
+#endif
+}
+
+bool UringFileSource::open(const QString& filePath)
+{
+    close();
+    error_.clear();
+    file_.setFileName(filePath);
+    if (!file_.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    fileSize_ = file_.size();
+    position_ = 0;
+    submitOffset_ = 0;
+    rangeEnd_ = fileSize_;
+    headSlot_ = 0;
+    queued_ = 0;
+
+    // io_uring和缓冲区在第一次打开时创建，之后的文件复用
+    if (!ring_ && !fallback_ && !setupRing()) {
+        qDebug() << "io_uring unavailable, fallback to buffered read:" << filePath;
+        fallback_ = true;
+    }
+    return true;
+}
+
+void UringFileSource::close()
+{
+    drain();
+    file_.close();
+}
+
+bool UringFileSource::readChunk(qint64 maxSize, DataChunk& chunk)
+{
+    if (fallback_) {
+        return readBuffered(maxSize, chunk);
+    }
+    if (!file_.isOpen() || position_ >= fileSize_) {
+        return false;
+    }
+    // 调用方读到了seekRange声明的区间之外，此后预读到文件末尾
+    if (position_ >= rangeEnd_) {
+        rangeEnd_ = fileSize_;
+    }
+    const qint64 size = qMin(maxSize, rangeEnd_ - position_);
+
+    char* out = nullptr;
+    chunk.owner.reset();
+    if (bufferPool_) {
+        chunk.data.clear();
+        chunk.buffer = bufferPool_->acquire(size);
+        out = chunk.buffer.data();
+    } else {
+        chunk.buffer.reset();
+        chunk.data = QByteArray(static_cast<int>(size), Qt::Uninitialized);
+        out = chunk.data.data();
+    }
+
+    // 从按偏移排列的预读块中依次复制，块被读空后立即重新提交，保持队列深度
+    qint64 copied = 0;
+    while (copied < size) {
+        if (queued_ == 0 && !submitReads()) {
+            break;
+        }
+        Slot& slot = slots_[headSlot_];
+        while (slot.result < 0) {
+            if (!reapCompletions()) {
+                return fail(QStringLiteral("wait for io_uring completion failed: %1").arg(QString::fromLocal8Bit(strerror(errno))));
+            }
+        }
+        if (slot.error == EINVAL) {
+            // 内核不支持所用的操作码或参数，从当前位置改用QFile::read，已复制的部分先返回
+            if (!fallBackToBuffered()) {
+                return fail(QStringLiteral("seek to %1 for buffered read failed").arg(position_));
+            }
+            if (copied == 0) {
+                chunk.buffer.reset();
+                chunk.data.clear();
+                return readBuffered(maxSize, chunk);
+            }
+            break;
+        }
+        if (slot.error != 0) {
+            return fail(QStringLiteral("read at %1 failed: %2").arg(slot.offset)
+                        .arg(QString::fromLocal8Bit(strerror(slot.error))));
+        }
+        // 读到的比请求的少且补不齐说明文件在传输中被截断，之后的块都不再有效
+        const bool truncated = slot.result < slot.length && !completeShortRead(slot);
+
+        const qint64 available = slot.offset + slot.result - position_;
+        const qint64 n = qMin(available, size - copied);
+        if (n > 0) {
+            memcpy(out + copied, slot.data + (position_ - slot.offset), static_cast<size_t>(n));
+            copied += n;
+            position_ += n;
+        }
+        if (position_ >= slot.offset + slot.result) {
+            headSlot_ = (headSlot_ + 1) % queueDepth_;
+            queued_--;
+            if (truncated) {
+                drain();
+                fileSize_ = rangeEnd_ = submitOffset_ = position_;
+                break;
+            }
+            if (!submitReads()) {
+                break;
+            }
+        }
+    }
+
+    if (copied == 0) {
+        chunk.buffer.reset();
+        chunk.data.clear();
+        return false;
+    }
+    if (chunk.buffer) {
+        chunk.buffer.setSize(copied);
+    } else {
+        chunk.data.resize(static_cast<int>(copied));
+    }
+    return true;
+}
+
+bool UringFileSource::seek(qint64 offset)
+{
+    return seekRange(offset, fileSize_ - offset);
+}
+
+bool UringFileSource::seekRange(qint64 offset, qint64 length)
+{
+    if (!file_.isOpen() || offset < 0 || offset > fileSize_) {
+        return false;
+    }
+    if (fallback_) {
+        return file_.seek(offset);
+    }
+    // 预读块引用的是原来的位置，等它们完成后从新位置重新开始
+    drain();
+    position_ = offset;
+    submitOffset_ = offset;
+    rangeEnd_ = qMin(fileSize_, offset + qMax(length, (qint64)0));
+    return true;
+}
+
+bool UringFileSource::atEnd() const
+{
+    return fallback_ ? file_.atEnd() : position_ >= fileSize_;
+}
+
+QString UringFileSource::errorString() const
+{
+    return error_.isEmpty() ? file_.errorString() : error_;
+}
+
+bool UringFileSource::setupRing()
+{
+#ifdef CLIPBOARD_HAVE_IO_URING
+    std::unique_ptr<Ring> ring(new Ring());
+    if (!ring->setup(static_cast<unsigned>(queueDepth_))) {
+        return false;
+    }
+    void* memory = nullptr;
+    if (posix_memalign(&memory, 4096, static_cast<size_t>(queueDepth_ * blockSize_)) != 0) {
+        return false;
+    }
+    buffers_ = static_cast<char*>(memory);
+
+    slots_.assign(queueDepth_, Slot());
+    ring->vectors.resize(queueDepth_);
+    for (int i = 0; i < queueDepth_; ++i) {
+        slots_[i].data = buffers_ + i * blockSize_;
+        ring->vectors[i].iov_base = slots_[i].data;
+        ring->vectors[i].iov_len = static_cast<size_t>(blockSize_);
+    }
+    // 注册失败（如超出锁定内存上限）不影响读取，只是改用IORING_OP_READV，每次请求由内核临时映射缓冲区
+    registered_ = ring->registerBuffers(ring->vectors.data(), static_cast<unsigned>(ring->vectors.size()));
+    if (!registered_) {
+        qDebug() << "io_uring register buffers failed:" << strerror(errno);
+    }
+    ring_ = std::move(ring);
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool UringFileSource::submitReads()
+{
+#ifdef CLIPBOARD_HAVE_IO_URING
+    const int fileFd = file_.handle();
+    while (queued_ < queueDepth_ && submitOffset_ < rangeEnd_) {
+        const int index = (headSlot_ + queued_) % queueDepth_;
+        Slot& slot = slots_[index];
+        slot.offset = submitOffset_;
+        slot.length = qMin(blockSize_, rangeEnd_ - submitOffset_);
+        slot.result = -1;
+        slot.error = 0;
+        if (!ring_->pushRead(fileFd, index, slot.length, slot.offset, registered_)) {
+            break;
+        }
+        submitOffset_ += slot.length;
+        queued_++;
+        inFlight_++;
+    }
+    if (ring_->unsubmitted > 0 && !ring_->enter(0)) {
+        return fail(QStringLiteral("io_uring submit failed: %1").arg(QString::fromLocal8Bit(strerror(errno))));
+    }
+    return queued_ > 0;
+#else
+    return false;
+#endif
+}
+
+bool UringFileSource::reapCompletions()
+{
+#ifdef CLIPBOARD_HAVE_IO_URING
+    if (inFlight_ == 0) {
+        errno = EINVAL;
+        return false;
+    }
+    if (!ring_->hasCompletion() && !ring_->enter(1)) {
+        return false;
+    }
+    quint64 userData = 0;
+    int result = 0;
+    while (ring_->popCompletion(userData, result)) {
+        Slot& slot = slots_[static_cast<size_t>(userData)];
+        slot.result = qMax(result, 0);
+        slot.error = result < 0 ? -result : 0;
+        inFlight_--;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool UringFileSource::completeShortRead(Slot& slot)
+{
+#ifdef CLIPBOARD_HAVE_IO_URING
+    while (slot.result < slot.length) {
+        const ssize_t n = ::pread(file_.handle(), slot.data + slot.result, static_cast<size_t>(slot.length - slot.result),
+                                  static_cast<off_t>(slot.offset + slot.result));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        slot.result += n;
+    }
+    return true;
+#else
+    Q_UNUSED(slot);
+    return false;
+#endif
+}
+
+void UringFileSource::drain()
+{
+    while (inFlight_ > 0 && reapCompletions()) {
+    }
+    headSlot_ = 0;
+    queued_ = 0;
+}
+
+bool UringFileSource::fallBackToBuffered()
+{
+    drain();
+    fallback_ = true;
+    qDebug() << "io_uring read rejected with EINVAL, fallback to buffered read at" << position_;
+    return file_.seek(position_);
+}
+
+bool UringFileSource::readBuffered(qint64 maxSize, DataChunk& chunk)
+{
+    return readFromFile(file_, maxSize, chunk);
+}
+
+bool UringFileSource::fail(const QString& message)
+{
+    error_ = message;
+    qDebug() << "UringFileSource:" << message;
+    return false;
+}
+
+} // namespace clipboard
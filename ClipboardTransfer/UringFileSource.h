@@ -0,0 +1,98 @@
+#pragma once
+#include "ChunkSource.h"
+#include <QFile>
+#include <memory>
+#include <vector>
+
+namespace clipboard {
+
+// io_uring异步读取（Linux）：始终保持至多queueDepth个按块预读的请求在途，
+// 存储设备的队列深度不再是1。预读使用注册的固定缓冲区，readChunk把已完成的块复制到数据块缓冲区后
+// 立即重新提交，数据块可以在缓存中停留任意长的时间而不占用固定缓冲区。
+// 预读缓冲区共queueDepth * blockSize字节，不计入缓存水位，创建时用blockSizeFor按会话给的预算确定块大小。
+// 内核或容器不支持io_uring、不在Linux上、或读取请求被内核以EINVAL拒绝时退回与BufferedFileSource相同的QFile::read
+class UringFileSource : public ChunkSource
+{
+public:
+    explicit UringFileSource(int queueDepth = DEFAULT_QUEUE_DEPTH, qint64 blockSize = DEFAULT_BLOCK_SIZE);
+    ~UringFileSource();
+
+    bool open(const QString& filePath) override;
+    void close() override;
+    bool readChunk(qint64 maxSize, DataChunk& chunk) override;
+    bool seek(qint64 offset) override;
+    bool seekRange(qint64 offset, qint64 length) override;
+    bool atEnd() const override;
+    QString errorString() const override;
+
+    // 是否因io_uring不可用而退回了QFile::read
+    bool isFallback() const {
+        return fallback_;
+    }
+    // 固定缓冲区是否注册成功，注册失败（如锁定内存上限）时使用普通缓冲区提交读取
+    bool hasRegisteredBuffers() const {
+        return registered_;
+    }
+
+    // 当前进程能否创建io_uring
+    static bool isSupported();
+    // queueDepth个预读块合计不超过prefetchBudget字节时的块大小，在[MIN_BLOCK_SIZE, DEFAULT_BLOCK_SIZE]之间；
+    // prefetchBudget不大于0时返回DEFAULT_BLOCK_SIZE
+    static qint64 blockSizeFor(int queueDepth, qint64 prefetchBudget);
+
+    static const int MAX_QUEUE_DEPTH = 256;
+    // 每个预读请求的大小，不限预算时队列深度64的数据来源固定占用16MB
+    static const qint64 DEFAULT_BLOCK_SIZE = 256 * 1024;
+    static const qint64 MIN_BLOCK_SIZE = 4096;
+
+private:
+    struct Ring;
+
+    // 预读块：缓冲区中[offset, offset + result)已读入，result为-1表示还在途，error为读取失败的errno
+    struct Slot
+    {
+        char* data = nullptr;
+        qint64 offset = 0;
+        qint64 length = 0;
+        qint64 result = -1;
+        int error = 0;
+    };
+
+    bool setupRing();
+    // 为空闲的块提交[submitOffset_, rangeEnd_)中的后续读取
+    bool submitReads();
+    // 等待至少一个完成事件并全部收割
+    bool reapCompletions();
+    // 内核返回的字节数少于请求时同步读完剩余部分，读到文件末尾（文件被截断）时返回false
+    bool completeShortRead(Slot& slot);
+    // 等待所有在途的读取结束，之后才能移动位置或关闭文件
+    void drain();
+    // 读取请求返回EINVAL（较老的内核不支持所用的操作码）时从position_起改用QFile::read
+    bool fallBackToBuffered();
+    bool readBuffered(qint64 maxSize, DataChunk& chunk);
+    bool fail(const QString& message);
+
+    QFile file_;
+    std::unique_ptr<Ring> ring_;
+    std::vector<Slot> slots_;
+    char* buffers_;
+    int queueDepth_;
+    qint64 blockSize_;
+    bool fallback_;
+    bool registered_;
+
+    qint64 fileSize_;
+    // 下一次readChunk返回的数据在文件中的偏移
+    qint64 position_;
+    // 下一个预读请求的起始偏移，请求不超过rangeEnd_
+    qint64 submitOffset_;
+    qint64 rangeEnd_;
+    // 按偏移顺序排列的在途或已完成的块，从headSlot_开始共queued_个
+    int headSlot_;
+    int queued_;
+    // 已提交、尚未收到完成事件的请求个数
+    int inFlight_;
+    QString error_;
+};
+
+} // namespace clipboard
@@ -39,25 +39,36 @@ namespace clipboard {
 		}
 
 		// 从FileBufferManager读取数据
-		if (FileBufferManager::instance()) {
-			qint64 bytesRead = FileBufferManager::instance()->readData((char*)pv, bytes_to_read);
+		if (session_) {
+			// readData阻塞到有数据为止，不要求各个文件的流按顺序读取
+			qint64 bytesRead = session_->readData(file_index_, current_position_.QuadPart, (char*)pv, bytes_to_read);
+			if (pcbRead) {
+				*pcbRead = 0;
+			}
+			if (bytesRead < 0) {
+				qWarning() << "read file" << file_index_ << "failed at" << current_position_.QuadPart;
+				return STG_E_READFAULT;
+			}
 			current_position_.QuadPart += bytesRead;
 
 			if (pcbRead) {
 				*pcbRead = static_cast<ULONG>(bytesRead);
 			}
 
-			// 如果没有读取到数据，检查传输是否已完成
+			// 没有读取到数据，检查是否已到达文件末尾
 			if (bytesRead == 0) {
-				// 检查传输是否已完成
-				if (FileBufferManager::instance()->isTransferComplete()) {
-					// 传输已完成且已到达文件末尾
+				// 数据按偏移读取，Seek之后即使文件已传输完成也可能还有数据
+				if (current_position_.QuadPart >= file_size_.QuadPart) {
+					// 已到达文件末尾
 					return S_FALSE;
-				} else {
-					// 传输尚未完成，稍后再试
-					::Sleep(10); // 短暂等待，避免CPU占用过高
-					return S_OK;
 				}
+				// 未到末尾时readData只会因超时或取消而返回0：传输仍在进行时按异步流返回E_PENDING
+				// 由调用方稍后重试，传输已停止时返回错误，不能以S_OK和0字节让调用方当作文件结束
+				if (session_->isTransferActive()) {
+					return E_PENDING;
+				}
+				qWarning() << "read file" << file_index_ << "stopped at" << current_position_.QuadPart;
+				return STG_E_READFAULT;
 			}
 
 			// 如果已读取到数据，检查是否到达文件末尾
@@ -139,26 +150,24 @@ namespace clipboard {
 	}
 
     //////////////////////////////////////////////////////
-    VirtualFileSrcStream::VirtualFileSrcStream()
+    VirtualFileSrcStream::VirtualFileSrcStream(const std::shared_ptr<FileBufferManager>& session)
+        : session_(session)
     {
         qDebug() << "============ create VirtualFileSrcStream";
     }
 
     VirtualFileSrcStream::~VirtualFileSrcStream()
 	{
-        FileBufferManager::instance()->clearVFS();
-		if (file_stream_) {
-			file_stream_->Release();
-			file_stream_ = nullptr;
+        if (m_releasedCallback) {
+            m_releasedCallback();
         }
+        for (FileStream* stream : file_streams_) {
+            stream->Release();
+        }
+        file_streams_.clear();
         qDebug() << "************ destroy VirtualFileSrcStream";
     }
 
-    void VirtualFileSrcStream::setFileName(const QString &fileName)
-    {
-        m_fileName = fileName;
-    }
-
     void VirtualFileSrcStream::onInit()
     {
         clip_format_filedesc_ = static_cast<CLIPFORMAT>(RegisterClipboardFormat(CFSTR_FILEDESCRIPTOR));
@@ -174,9 +183,9 @@ namespace clipboard {
 
     void VirtualFileSrcStream::resetFileStream()
     {
-        if (file_stream_) {
+        for (FileStream* stream : file_streams_) {
             LARGE_INTEGER moveToBegin = {0};
-            file_stream_->Seek(moveToBegin, STREAM_SEEK_SET, nullptr);
+            stream->Seek(moveToBegin, STREAM_SEEK_SET, nullptr);
         }
     }
 
@@ -197,8 +206,9 @@ namespace clipboard {
 		{
 			if (pformatetcIn->tymed & TYMED_HGLOBAL)
 			{
-				uint32_t file_count = 1;
-				UINT cb = sizeof(FILEGROUPDESCRIPTOR) +	(file_count - 1) * sizeof(FILEDESCRIPTOR);
+				FileBufferManager* manager = session_.get();
+				uint32_t file_count = manager ? static_cast<uint32_t>(manager->getFileCount()) : 0;
+				UINT cb = sizeof(FILEGROUPDESCRIPTOR) + (file_count > 1 ? file_count - 1 : 0) * sizeof(FILEDESCRIPTOR);
 				HGLOBAL h = GlobalAlloc(GHND | GMEM_SHARE, cb);
 				if (!h) {
 					hr = E_OUTOFMEMORY;
@@ -212,11 +222,11 @@ namespace clipboard {
 						for (uint32_t index = 0; index < file_count; ++index) {
 							// 从FileBufferManager获取文件名
 							wcsncpy_s(pFileDescriptorArray[index].cFileName, _countof(pFileDescriptorArray[index].cFileName), 
-                                     m_fileName.toStdWString().c_str(), _TRUNCATE);
+                                     manager->getFileName(index).toStdWString().c_str(), _TRUNCATE);
 							//pFileDescriptorArray[index].dwFlags = FD_UNICODE| FD_FILESIZE | FD_ATTRIBUTES| FD_PROGRESSUI| FD_CREATETIME| FD_SIZEPOINT;
 							pFileDescriptorArray[index].dwFlags = FD_FILESIZE | FD_ATTRIBUTES | FD_CREATETIME | FD_WRITESTIME | FD_PROGRESSUI;
 							// 从FileBufferManager获取文件大小
-							qint64 fileSize = FileBufferManager::instance() ? FileBufferManager::instance()->getFileSize() : 24*1024*1024; // 默认24MB作为后备值
+							qint64 fileSize = manager->getFileSize(index);
 							pFileDescriptorArray[index].nFileSizeLow = fileSize & 0xFFFFFFFF;
 							pFileDescriptorArray[index].nFileSizeHigh = (fileSize >> 32) & 0xFFFFFFFF;
 							pFileDescriptorArray[index].dwFileAttributes = FILE_ATTRIBUTE_NORMAL;
@@ -247,19 +257,21 @@ namespace clipboard {
 		{
 			if ((pformatetcIn->tymed & TYMED_ISTREAM))
 			{
-				// 根据 lindex 确定是哪个文件
-				int fileIndex = pformatetcIn->lindex;
+				// 根据 lindex 确定是哪个文件，-1表示只有一个文件
+				int fileIndex = pformatetcIn->lindex < 0 ? 0 : pformatetcIn->lindex;
 				// 从FileBufferManager获取文件大小
-				qint64 fileSize = FileBufferManager::instance() ? FileBufferManager::instance()->getFileSize() : 0;
-				if (file_stream_ == nullptr) {
-					file_stream_ = new FileStream(fileSize);
+				qint64 fileSize = session_ ? session_->getFileSize(fileIndex) : 0;
+				FileStream* stream = file_streams_.value(fileIndex, nullptr);
+				if (stream == nullptr) {
+					stream = new FileStream(session_, fileSize, fileIndex);
+					file_streams_.insert(fileIndex, stream);
 				}
 				else {
 					LARGE_INTEGER mov;
 					mov.QuadPart = 0;
-					file_stream_->Seek(mov, STREAM_SEEK_SET, nullptr);
+					stream->Seek(mov, STREAM_SEEK_SET, nullptr);
 				}
-				pmedium->pstm = (IStream*)file_stream_;
+				pmedium->pstm = (IStream*)stream;
 				pmedium->pstm->AddRef();
 				pmedium->tymed = TYMED_ISTREAM;
 				hr = S_OK;
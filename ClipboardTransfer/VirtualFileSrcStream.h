@@ -2,7 +2,9 @@
 #include <stdint.h>
 #include "DataObject.h"
 #include <QString>
+#include <QMap>
 #include <functional>
+#include <memory>
 
 namespace clipboard {
 
@@ -13,13 +15,17 @@ namespace clipboard {
     using OperCompletedCallback = std::function<void(bool success)>;
     using OperCancelledCallback = std::function<void()>;
     using AbortTransferCallback = std::function<void()>;
+    using ReleasedCallback = std::function<void()>;
 
 	class FileStream : public IStream
 	{
 	public:
 
-		FileStream(uint64_t file_size)
+		// 流持有会话，资源管理器在数据对象释放后仍可能继续读取
+		FileStream(const std::shared_ptr<FileBufferManager>& session, uint64_t file_size, int file_index)
 			: ref_(1)
+			, session_(session)
+			, file_index_(file_index)
 		{
 			file_size_.QuadPart = file_size;
 			current_position_.QuadPart = 0;
@@ -98,6 +104,7 @@ namespace clipboard {
 
 	private:
 		LONG ref_;
+		std::shared_ptr<FileBufferManager> session_;
 		ULARGE_INTEGER file_size_;
 		ULARGE_INTEGER current_position_;
 		int file_index_;  // 文件索引
@@ -107,14 +114,18 @@ namespace clipboard {
 								, public IDataObjectAsyncCapability
 	{
 	public:
-		VirtualFileSrcStream();
+		// 数据对象只读取session这一个会话的数据
+		explicit VirtualFileSrcStream(const std::shared_ptr<FileBufferManager>& session);
 		~VirtualFileSrcStream();
-        void setFileName(const QString& fileName);
         void onInit();
         bool hasInit() const {
 			return m_bInit;
 		}
         void resetFileStream();
+        // 对象被剪贴板释放、即将销毁时调用
+        void setReleasedCallback(const ReleasedCallback& callback) {
+            m_releasedCallback = callback;
+        }
 
 		bool set_to_clipboard();
 
@@ -170,13 +181,15 @@ namespace clipboard {
         unsigned short clip_format_filedesc_ = 0;
         unsigned short clip_format_filecontent_ = 0;
         unsigned short clip_format_remote_file = 0;
-		QString m_fileName;
 		BOOL	 in_async_op_ = false;
 		bool m_bInit = false;
-		FileStream	*file_stream_ = nullptr;
+		std::shared_ptr<FileBufferManager> session_;
+		// 每个lindex对应一个文件流
+		QMap<int, FileStream*> file_streams_;
 		OperCancelledCallback m_operCancelledCallback;
         OperCompletedCallback m_operCompletedCallback;
         AbortTransferCallback m_abortTransferCallback;
+        ReleasedCallback m_releasedCallback;
 	};
 
 //	STDAPI VirtualFileSrcStream_CreateInstance(REFIID riid, void **ppv);
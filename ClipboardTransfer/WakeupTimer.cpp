@@ -0,0 +1,78 @@
+#include "WakeupTimer.h"
+#include <QThread>
+
+namespace clipboard {
+
+WakeupTimer::WakeupTimer()
+    : nextId_(1)
+    , closing_(false)
+{
+    clock_.start();
+    thread_ = QThread::create([this]() { timerLoop(); });
+    thread_->start();
+}
+
+WakeupTimer::~WakeupTimer()
+{
+    {
+        QMutexLocker locker(&mutex_);
+        closing_ = true;
+        changed_.wakeAll();
+    }
+    thread_->wait();
+    delete thread_;
+}
+
+WakeupTimer* WakeupTimer::instance()
+{
+    static WakeupTimer timer;
+    return &timer;
+}
+
+int WakeupTimer::schedule(qint64 delayNs, const std::function<void()>& callback)
+{
+    QMutexLocker locker(&mutex_);
+    const int id = nextId_++;
+    const qint64 deadline = clock_.nsecsElapsed() + qMax(delayNs, (qint64)0);
+    // 新的回调比原来最早的还早时叫醒定时器线程重新计算等待时间
+    const bool earliest = entries_.empty() || deadline < entries_.begin()->first;
+    entries_.emplace(deadline, std::make_pair(id, callback));
+    if (earliest) {
+        changed_.wakeAll();
+    }
+    return id;
+}
+
+void WakeupTimer::cancel(int id)
+{
+    // 回调在持有mutex_时调用，拿到锁时它要么已经返回，要么还没开始
+    QMutexLocker locker(&mutex_);
+    for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+        if (it->second.first == id) {
+            entries_.erase(it);
+            return;
+        }
+    }
+}
+
+void WakeupTimer::timerLoop()
+{
+    QMutexLocker locker(&mutex_);
+    while (!closing_) {
+        if (entries_.empty()) {
+            changed_.wait(&mutex_);
+            continue;
+        }
+        const qint64 remainingNs = entries_.begin()->first - clock_.nsecsElapsed();
+        if (remainingNs > 0) {
+            // 向上取整到毫秒，醒来时不会早于到期时间
+            changed_.wait(&mutex_, static_cast<unsigned long>((remainingNs + 999999) / 1000000));
+            continue;
+        }
+        std::function<void()> callback = std::move(entries_.begin()->second.second);
+        entries_.erase(entries_.begin());
+        callback();
+    }
+}
+
+} // namespace clipboard
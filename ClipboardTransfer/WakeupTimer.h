@@ -0,0 +1,46 @@
+#pragma once
+#include <QtGlobal>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QWaitCondition>
+#include <functional>
+#include <map>
+
+class QThread;
+
+namespace clipboard {
+
+// 到期回调：生产任务需要等待一段时间（节流额度）时登记一个回调后让出线程，
+// 到期时由本对象唯一的线程调用回调重新提交任务。所有会话共用一个实例，不随会话数增加线程
+class WakeupTimer
+{
+public:
+    WakeupTimer();
+    ~WakeupTimer();
+
+    WakeupTimer(const WakeupTimer&) = delete;
+    WakeupTimer& operator=(const WakeupTimer&) = delete;
+
+    // 进程内共用的实例
+    static WakeupTimer* instance();
+
+    // delayNs纳秒后调用一次callback，返回用于cancel的编号。
+    // 回调在定时器线程中持有内部锁时调用，应当很快返回，且不能再调用本对象
+    int schedule(qint64 delayNs, const std::function<void()>& callback);
+    // 取消尚未到期的回调；返回后该回调不会再被调用，正在调用时等它返回
+    void cancel(int id);
+
+private:
+    void timerLoop();
+
+    QThread* thread_;
+    QElapsedTimer clock_;
+    mutable QMutex mutex_;
+    QWaitCondition changed_;
+    // 按到期时间（clock_的纳秒数）排列，值为编号和回调
+    std::multimap<qint64, std::pair<int, std::function<void()>>> entries_;
+    int nextId_;
+    bool closing_;
+};
+
+} // namespace clipboard
@@ -0,0 +1,249 @@
+#include "LoopbackChunkServer.h"
+#include "ChunkProtocol.h"
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QThread>
+#include <deque>
+
+namespace clipboard {
+
+// 在接受线程中同步回调incomingConnection，把描述符交给连接线程
+class LoopbackChunkServer::Listener : public QTcpServer
+{
+public:
+    explicit Listener(LoopbackChunkServer* server)
+        : server_(server)
+    {
+    }
+
+protected:
+    void incomingConnection(qintptr descriptor) override
+    {
+        server_->spawnConnection(descriptor);
+    }
+
+private:
+    LoopbackChunkServer* server_;
+};
+
+LoopbackChunkServer::LoopbackChunkServer()
+    : acceptThread_(nullptr)
+    , started_(false)
+    , port_(0)
+    , stopping_(false)
+    , roundTripMs_(0)
+    , connections_(0)
+    , requests_(0)
+    , bytesSent_(0)
+{
+}
+
+LoopbackChunkServer::~LoopbackChunkServer()
+{
+    stop();
+}
+
+bool LoopbackChunkServer::start(quint16 port)
+{
+    stop();
+
+    QMutexLocker locker(&mutex_);
+    stopping_ = false;
+    started_ = false;
+    port_ = 0;
+    error_.clear();
+
+    // 监听套接字须在使用它的线程中创建
+    acceptThread_ = QThread::create([this, port]() { acceptLoop(port); });
+    acceptThread_->start();
+    while (!started_) {
+        listening_.wait(&mutex_);
+    }
+    return port_ != 0;
+}
+
+void LoopbackChunkServer::stop()
+{
+    stopping_ = true;
+    if (acceptThread_) {
+        acceptThread_->wait();
+        delete acceptThread_;
+        acceptThread_ = nullptr;
+    }
+
+    // 接受线程已退出，不会再有新的连接线程
+    for (QThread* thread : connectionThreads_) {
+        thread->wait();
+        delete thread;
+    }
+    connectionThreads_.clear();
+}
+
+quint16 LoopbackChunkServer::port() const
+{
+    QMutexLocker locker(&mutex_);
+    return port_;
+}
+
+QString LoopbackChunkServer::errorString() const
+{
+    QMutexLocker locker(&mutex_);
+    return error_;
+}
+
+void LoopbackChunkServer::setRoundTripTime(int ms)
+{
+    roundTripMs_ = qMax(ms, 0);
+}
+
+int LoopbackChunkServer::roundTripTime() const
+{
+    return roundTripMs_;
+}
+
+LoopbackChunkServer::Statistics LoopbackChunkServer::statistics() const
+{
+    Statistics stats;
+    stats.connections = connections_.load();
+    stats.requests = requests_.load();
+    stats.bytesSent = bytesSent_.load();
+    return stats;
+}
+
+void LoopbackChunkServer::acceptLoop(quint16 port)
+{
+    Listener listener(this);
+    bool ok = listener.listen(QHostAddress::LocalHost, port);
+    {
+        QMutexLocker locker(&mutex_);
+        port_ = ok ? listener.serverPort() : 0;
+        if (!ok) {
+            error_ = listener.errorString();
+        }
+        started_ = true;
+        listening_.wakeAll();
+    }
+    if (!ok) {
+        return;
+    }
+
+    while (!stopping_) {
+        listener.waitForNewConnection(WAIT_SLICE_MS);
+    }
+    listener.close();
+}
+
+void LoopbackChunkServer::spawnConnection(qintptr descriptor)
+{
+    // 顺便回收已经结束的连接线程，只有接受线程访问connectionThreads_
+    for (auto it = connectionThreads_.begin(); it != connectionThreads_.end(); ) {
+        if ((*it)->isFinished()) {
+            delete *it;
+            it = connectionThreads_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    connections_.fetch_add(1);
+    QThread* thread = QThread::create([this, descriptor]() { serveConnection(descriptor); });
+    connectionThreads_.push_back(thread);
+    thread->start();
+}
+
+void LoopbackChunkServer::serveConnection(qintptr descriptor)
+{
+    QTcpSocket socket;
+    if (!socket.setSocketDescriptor(descriptor)) {
+        qDebug() << "loopback server: bad socket descriptor" << socket.errorString();
+        return;
+    }
+    socket.setSocketOption(QAbstractSocket::LowDelayOption, 1);
+
+    struct Reply
+    {
+        qint64 dueMs;
+        QByteArray frame;
+    };
+    std::deque<Reply> replies;
+    QByteArray input;
+    QFile file;
+    QElapsedTimer clock;
+    clock.start();
+
+    while (!stopping_) {
+        // 发出到期的应答
+        while (!replies.empty() && replies.front().dueMs <= clock.elapsed()
+               && socket.bytesToWrite() < MAX_PENDING_WRITE) {
+            bytesSent_.fetch_add(replies.front().frame.size());
+            socket.write(replies.front().frame);
+            replies.pop_front();
+        }
+
+        // 等待新请求，有应答即将到期时只等到到期为止
+        if (!replies.empty() && replies.front().dueMs <= clock.elapsed()) {
+            // 写缓冲已满，等对端读走一部分
+            socket.waitForBytesWritten(WAIT_SLICE_MS);
+        } else if (socket.bytesAvailable() == 0) {
+            qint64 waitMs = replies.empty() ? WAIT_SLICE_MS
+                                            : qBound((qint64)0, replies.front().dueMs - clock.elapsed(), (qint64)WAIT_SLICE_MS);
+            // 等待期间Qt会继续写出缓冲中的应答
+            socket.waitForReadyRead(static_cast<int>(waitMs));
+        }
+        if (socket.state() != QAbstractSocket::ConnectedState) {
+            break;
+        }
+        input += socket.readAll();
+
+        // 解析完整的请求帧
+        int consumed = 0;
+        while (input.size() - consumed >= ChunkProtocol::HEADER_SIZE) {
+            ChunkProtocol::FrameType type;
+            quint32 bodySize;
+            if (!ChunkProtocol::parseHeader(input.constData() + consumed, type, bodySize)) {
+                qDebug() << "loopback server: frame too large" << bodySize;
+                return;
+            }
+            if (input.size() - consumed < ChunkProtocol::HEADER_SIZE + static_cast<int>(bodySize)) {
+                break;
+            }
+            const char* body = input.constData() + consumed + ChunkProtocol::HEADER_SIZE;
+            consumed += ChunkProtocol::HEADER_SIZE + bodySize;
+            requests_.fetch_add(1);
+
+            QByteArray frame;
+            if (type == ChunkProtocol::OpenRequest) {
+                file.close();
+                file.setFileName(QString::fromUtf8(body, static_cast<int>(bodySize)));
+                frame = file.open(QIODevice::ReadOnly)
+                        ? ChunkProtocol::openReply(file.size())
+                        : ChunkProtocol::errorReply(file.errorString());
+            } else if (type == ChunkProtocol::ReadRequest && bodySize == ChunkProtocol::OFFSET_SIZE + 4) {
+                qint64 offset = qFromBigEndian<qint64>(body);
+                quint32 length = qFromBigEndian<quint32>(body + ChunkProtocol::OFFSET_SIZE);
+                if (!file.isOpen() || offset < 0 || length > ChunkProtocol::MAX_READ_LENGTH || !file.seek(offset)) {
+                    frame = ChunkProtocol::errorReply(QStringLiteral("bad read request: %1").arg(offset));
+                } else {
+                    frame = ChunkProtocol::header(ChunkProtocol::DataReply, 0);
+                    frame.resize(ChunkProtocol::HEADER_SIZE + ChunkProtocol::OFFSET_SIZE + static_cast<int>(length));
+                    qint64 bytesRead = file.read(frame.data() + ChunkProtocol::HEADER_SIZE + ChunkProtocol::OFFSET_SIZE, length);
+                    bytesRead = qMax(bytesRead, (qint64)0);
+                    frame.resize(ChunkProtocol::HEADER_SIZE + ChunkProtocol::OFFSET_SIZE + static_cast<int>(bytesRead));
+                    qToBigEndian<quint32>(static_cast<quint32>(ChunkProtocol::OFFSET_SIZE + bytesRead), frame.data());
+                    qToBigEndian<qint64>(offset, frame.data() + ChunkProtocol::HEADER_SIZE);
+                }
+            } else {
+                frame = ChunkProtocol::errorReply(QStringLiteral("unexpected frame type %1").arg(type));
+            }
+
+            Reply reply = { clock.elapsed() + roundTripMs_.load(), frame };
+            replies.push_back(std::move(reply));
+        }
+        input.remove(0, consumed);
+    }
+}
+
+} // namespace clipboard
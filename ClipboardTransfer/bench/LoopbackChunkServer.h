@@ -0,0 +1,71 @@
+#pragma once
+#include <QMutex>
+#include <QString>
+#include <QWaitCondition>
+#include <atomic>
+#include <vector>
+
+class QThread;
+
+namespace clipboard {
+
+// 回环测试服务端：在127.0.0.1上以ChunkProtocol提供本机文件，作为TcpChunkSource的对端
+// 用于没有真实对端时的测试和基准测试。每个连接一个线程，应答在收到请求roundTripMs
+// 毫秒之后才发出，模拟链路的往返延迟
+class LoopbackChunkServer
+{
+public:
+    struct Statistics
+    {
+        qint64 connections = 0;
+        qint64 requests = 0;
+        qint64 bytesSent = 0;
+    };
+
+    LoopbackChunkServer();
+    ~LoopbackChunkServer();
+
+    LoopbackChunkServer(const LoopbackChunkServer&) = delete;
+    LoopbackChunkServer& operator=(const LoopbackChunkServer&) = delete;
+
+    // 监听127.0.0.1上的port，0表示由系统分配，实际端口通过port()获取
+    bool start(quint16 port = 0);
+    // 停止监听并断开所有连接
+    void stop();
+    quint16 port() const;
+    QString errorString() const;
+
+    // 模拟的往返延迟，对之后收到的请求生效
+    void setRoundTripTime(int ms);
+    int roundTripTime() const;
+
+    Statistics statistics() const;
+
+private:
+    class Listener;
+
+    void acceptLoop(quint16 port);
+    void spawnConnection(qintptr descriptor);
+    void serveConnection(qintptr descriptor);
+
+    QThread* acceptThread_;
+    std::vector<QThread*> connectionThreads_;
+    mutable QMutex mutex_;
+    QWaitCondition listening_;
+    bool started_;
+    quint16 port_;
+    QString error_;
+
+    std::atomic<bool> stopping_;
+    std::atomic<int> roundTripMs_;
+    std::atomic<qint64> connections_;
+    std::atomic<qint64> requests_;
+    std::atomic<qint64> bytesSent_;
+
+    // 等待连接和请求时每次阻塞的时长，便于及时响应stop
+    static const int WAIT_SLICE_MS = 20;
+    // 套接字写缓冲超过该值时暂停发送到期的应答，客户端不读时不会无限占用内存
+    static const qint64 MAX_PENDING_WRITE = 8 * 1024 * 1024;
+};
+
+} // namespace clipboard
@@ -0,0 +1,159 @@
+#include "MemoryStats.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <QFile>
+
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#include <psapi.h>
+#elif defined(Q_OS_UNIX)
+#include <sys/resource.h>
+#endif
+
+namespace {
+
+std::atomic<quint64> allocationCount(0);
+std::atomic<quint64> allocationBytes(0);
+
+inline void countAllocation(size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    allocationBytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+} // namespace
+
+#if defined(__GLIBC__)
+// glibc下替换malloc系列，Qt容器、QByteArray和operator new的分配都经过这里
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* pointer, size_t size);
+void __libc_free(void* pointer);
+
+void* malloc(size_t size)
+{
+    countAllocation(size);
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size)
+{
+    countAllocation(count * size);
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* pointer, size_t size)
+{
+    countAllocation(size);
+    return __libc_realloc(pointer, size);
+}
+
+void free(void* pointer)
+{
+    __libc_free(pointer);
+}
+}
+#else
+// 其他平台只统计operator new，Qt容器直接调用malloc的分配不计入
+void* operator new(size_t size)
+{
+    countAllocation(size);
+    if (void* pointer = std::malloc(size ? size : 1)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    countAllocation(size);
+    return std::malloc(size ? size : 1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+    return operator new(size, std::nothrow);
+}
+
+void operator delete(void* pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept
+{
+    std::free(pointer);
+}
+#endif
+
+namespace MemoryStats {
+
+quint64 allocations()
+{
+    return allocationCount.load(std::memory_order_relaxed);
+}
+
+quint64 allocatedBytes()
+{
+    return allocationBytes.load(std::memory_order_relaxed);
+}
+
+qint64 peakResidentBytes()
+{
+#if defined(Q_OS_WIN)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return static_cast<qint64>(counters.PeakWorkingSetSize);
+    }
+    return -1;
+#elif defined(Q_OS_LINUX)
+    // VmHWM可以通过clear_refs重置，ru_maxrss不能
+    QFile status(QStringLiteral("/proc/self/status"));
+    if (status.open(QIODevice::ReadOnly)) {
+        for (const QByteArray& line : status.readAll().split('\n')) {
+            if (line.startsWith("VmHWM:")) {
+                return line.mid(6).trimmed().split(' ').first().toLongLong() * 1024;
+            }
+        }
+    }
+    return -1;
+#elif defined(Q_OS_MACOS)
+    struct rusage usage;
+    return getrusage(RUSAGE_SELF, &usage) == 0 ? static_cast<qint64>(usage.ru_maxrss) : -1;
+#elif defined(Q_OS_UNIX)
+    struct rusage usage;
+    return getrusage(RUSAGE_SELF, &usage) == 0 ? static_cast<qint64>(usage.ru_maxrss) * 1024 : -1;
+#else
+    return -1;
+#endif
+}
+
+bool resetPeakResident()
+{
+#if defined(Q_OS_LINUX)
+    // 写入5把VmHWM重置为当前的常驻内存（Linux 4.0起）
+    QFile clearRefs(QStringLiteral("/proc/self/clear_refs"));
+    return clearRefs.open(QIODevice::WriteOnly) && clearRefs.write("5", 1) == 1;
+#else
+    return false;
+#endif
+}
+
+} // namespace MemoryStats
@@ -0,0 +1,17 @@
+#pragma once
+#include <QtGlobal>
+
+// 基准测试进程的内存统计：堆分配次数和字节数（累计值，按两次读取的差计算某一段的分配），
+// 以及峰值常驻内存
+namespace MemoryStats {
+
+quint64 allocations();
+quint64 allocatedBytes();
+
+// 进程的峰值常驻内存（字节），不支持的平台返回-1
+qint64 peakResidentBytes();
+// 把峰值重置为当前值，使下一次peakResidentBytes只反映之后的峰值；
+// 仅Linux支持，其他平台峰值从进程启动起累计
+bool resetPeakResident();
+
+} // namespace MemoryStats
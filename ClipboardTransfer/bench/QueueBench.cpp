@@ -0,0 +1,154 @@
+#include "QueueBench.h"
+#include "SpscChunkRing.h"
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QQueue>
+#include <QThread>
+#include <cstring>
+#include <vector>
+
+using namespace clipboard;
+
+namespace {
+
+// 与FileBufferManager的队列容量相同
+const int kQueueCapacity = 1024;
+
+// 原来的实现：QQueue<QByteArray>，生产者和readData对每个数据块都要获取同一把锁
+class MutexChunkQueue
+{
+public:
+    typedef QByteArray Item;
+
+    bool tryPush(QByteArray&& chunk)
+    {
+        QMutexLocker locker(&mutex_);
+        if (queue_.size() >= kQueueCapacity) {
+            return false;
+        }
+        queue_.enqueue(chunk);
+        return true;
+    }
+
+    bool tryPop(QByteArray& chunk)
+    {
+        QMutexLocker locker(&mutex_);
+        if (queue_.isEmpty()) {
+            return false;
+        }
+        chunk = queue_.dequeue();
+        return true;
+    }
+
+private:
+    QMutex mutex_;
+    QQueue<QByteArray> queue_;
+};
+
+// 与MutexChunkQueue统一接口
+class RingChunkQueue
+{
+public:
+    typedef DataChunk Item;
+
+    RingChunkQueue() : ring_(kQueueCapacity) {}
+
+    bool tryPush(DataChunk&& chunk) { return ring_.tryPush(std::move(chunk)); }
+    bool tryPop(DataChunk& chunk) { return ring_.tryPop(chunk); }
+
+private:
+    SpscChunkRing ring_;
+};
+
+void fillItem(DataChunk& chunk, const QByteArray& payload, qint64 offset)
+{
+    chunk.data = payload;
+    chunk.offset = offset;
+}
+
+void fillItem(QByteArray& chunk, const QByteArray& payload, qint64)
+{
+    chunk = payload;
+}
+
+// 入队chunks个引用payload的数据块，另一个线程出队并复制，返回耗时（纳秒）
+template <typename Queue>
+qint64 transfer(const QByteArray& payload, qint64 chunks)
+{
+    typedef typename Queue::Item Item;
+    Queue queue;
+    std::vector<char> sink(static_cast<size_t>(payload.size()));
+    qint64 checksum = 0;
+
+    QElapsedTimer timer;
+    timer.start();
+    QThread* consumer = QThread::create([&queue, &sink, &checksum, chunks]() {
+        Item chunk;
+        for (qint64 received = 0; received < chunks; ) {
+            if (!queue.tryPop(chunk)) {
+                QThread::yieldCurrentThread();
+                continue;
+            }
+            memcpy(sink.data(), chunk.constData(), static_cast<size_t>(chunk.size()));
+            checksum += sink[static_cast<size_t>(received % sink.size())];
+            chunk = Item();
+            ++received;
+        }
+    });
+    consumer->start();
+
+    for (qint64 sent = 0; sent < chunks; ++sent) {
+        Item chunk;
+        fillItem(chunk, payload, sent * payload.size());
+        while (!queue.tryPush(std::move(chunk))) {
+            QThread::yieldCurrentThread();
+        }
+    }
+    consumer->wait();
+    const qint64 elapsed = timer.nsecsElapsed();
+    delete consumer;
+
+    // 使复制不会被优化掉
+    if (checksum == -1) {
+        qWarning() << "unexpected checksum";
+    }
+    return elapsed;
+}
+
+} // namespace
+
+namespace QueueBench {
+
+QList<Result> run(const QList<qint64>& chunkSizes, qint64 totalBytes, int runs)
+{
+    QList<Result> results;
+    for (qint64 chunkSize : chunkSizes) {
+        QByteArray payload(static_cast<int>(chunkSize), 'q');
+        const qint64 chunks = qMax((qint64)1, totalBytes / chunkSize);
+
+        Result spsc;
+        spsc.queue = "spsc";
+        Result mutex;
+        mutex.queue = "mutex";
+        for (Result* result : { &spsc, &mutex }) {
+            result->chunkSize = chunkSize;
+            result->chunks = chunks;
+        }
+        // 交替运行，两种队列受到的频率和缓存状态变化相同
+        for (int run = 0; run < qMax(1, runs); ++run) {
+            const qint64 ringNs = transfer<RingChunkQueue>(payload, chunks);
+            const qint64 queueNs = transfer<MutexChunkQueue>(payload, chunks);
+            if (spsc.elapsedNs == 0 || ringNs < spsc.elapsedNs) {
+                spsc.elapsedNs = ringNs;
+            }
+            if (mutex.elapsedNs == 0 || queueNs < mutex.elapsedNs) {
+                mutex.elapsedNs = queueNs;
+            }
+        }
+        results << spsc << mutex;
+    }
+    return results;
+}
+
+} // namespace QueueBench
@@ -0,0 +1,28 @@
+#pragma once
+#include <QtGlobal>
+#include <QList>
+
+// 生产者与readData之间交接数据块的微基准：SpscChunkRing与原来的QQueue加互斥锁，
+// 一个线程入队、另一个线程出队并把数据复制到自己的缓冲区，队列满或空时让出CPU。
+// 不经过FileBufferManager，只比较两种队列本身在不同数据块大小下的交接开销
+namespace QueueBench {
+
+struct Result
+{
+    const char* queue = "";     // "spsc"或"mutex"
+    qint64 chunkSize = 0;
+    qint64 chunks = 0;
+    qint64 elapsedNs = 0;       // 多次运行中最快的一次
+
+    double nsPerChunk() const {
+        return chunks > 0 ? double(elapsedNs) / chunks : 0.0;
+    }
+    double mbPerSecond() const {
+        return elapsedNs > 0 ? chunks * chunkSize / (1024.0 * 1024.0) / (elapsedNs / 1e9) : 0.0;
+    }
+};
+
+// 对每个数据块大小分别以两种队列交接totalBytes字节，每种组合运行runs次取最快的一次
+QList<Result> run(const QList<qint64>& chunkSizes, qint64 totalBytes, int runs);
+
+} // namespace QueueBench
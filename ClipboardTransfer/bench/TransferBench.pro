@@ -0,0 +1,35 @@
+# 无界面吞吐量与延迟基准测试，链接TransferCore静态库，不依赖Win32/OLE
+# Linux下在ClipboardTransfer目录中：qmake Headless.pro && make && ./bench/TransferBench --help
+QT = core network
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = TransferBench
+TEMPLATE = app
+
+CODECFORTR = UTF-8
+CODECFORSRC = UTF-8
+DESTDIR = $$PWD
+
+SOURCES += main.cpp \
+    LoopbackChunkServer.cpp \
+    MemoryStats.cpp \
+    QueueBench.cpp
+
+HEADERS += LoopbackChunkServer.h \
+    MemoryStats.h \
+    QueueBench.h
+
+# --paste通过LazyMimeData读取
+include(../MimeData.pri)
+
+INCLUDEPATH += $$PWD/..
+DEPENDPATH += $$PWD/..
+LIBS += -L$$PWD/../lib -lTransferCore
+win32: LIBS += -lpsapi
+
+win32 {
+    PRE_TARGETDEPS += $$PWD/../lib/TransferCore.lib
+} else {
+    PRE_TARGETDEPS += $$PWD/../lib/libTransferCore.a
+}
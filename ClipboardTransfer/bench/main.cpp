@@ -0,0 +1,948 @@
+#include "Crc32c.h"
+#include "FileBufferManager.h"
+#include "LazyMimeData.h"
+#include "LoopbackChunkServer.h"
+#include "MemoryStats.h"
+#include "QueueBench.h"
+#include "StreamSink.h"
+#include "TransferSessionManager.h"
+#include "UringFileSource.h"
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTemporaryDir>
+#include <QTemporaryFile>
+#include <QTextStream>
+#include <QThread>
+#include <QUrl>
+#include <algorithm>
+#include <numeric>
+#include <memory>
+#include <vector>
+
+using namespace clipboard;
+
+namespace {
+
+// 基准测试的呈现端：不经过剪贴板，读取线程直接调用readData
+class BenchSink : public StreamSink
+{
+public:
+    void publish(const std::shared_ptr<FileBufferManager>& session, const TransferFileList& files) override {
+        Q_UNUSED(session);
+        files_ = files;
+    }
+
+    TransferFileList files() const {
+        return files_;
+    }
+
+private:
+    TransferFileList files_;
+};
+
+struct ReadResult
+{
+    qint64 bytes = 0;
+    qint64 calls = 0;
+    qint64 emptyReads = 0;
+    // readData返回-1（端到端校验发现数据不一致）
+    bool readError = false;
+    // 写入接收方的部分文件失败
+    bool writeError = false;
+    qint64 elapsedNs = 0;
+    // 从startTransfer到读到第一个字节的时间
+    qint64 firstByteNs = -1;
+    // 从startTransfer到读完的时间
+    qint64 completionNs = -1;
+    // 每次readData的耗时（纳秒）
+    std::vector<qint64> latencies;
+};
+
+// 一个传输会话和它的呈现端
+struct BenchSession
+{
+    std::shared_ptr<FileBufferManager> manager;
+    BenchSink sink;
+};
+
+// 合并并发会话的读取结果：字节数和调用次数相加，耗时取最慢的会话，首字节时间取最早的
+void mergeResult(ReadResult& total, const ReadResult& result)
+{
+    total.bytes += result.bytes;
+    total.calls += result.calls;
+    total.emptyReads += result.emptyReads;
+    total.readError = total.readError || result.readError;
+    total.writeError = total.writeError || result.writeError;
+    total.elapsedNs = qMax(total.elapsedNs, result.elapsedNs);
+    if (result.firstByteNs >= 0 && (total.firstByteNs < 0 || result.firstByteNs < total.firstByteNs)) {
+        total.firstByteNs = result.firstByteNs;
+    }
+    total.latencies.insert(total.latencies.end(), result.latencies.begin(), result.latencies.end());
+}
+
+// 模拟资源管理器的读取方式：按lindex顺序，每个文件按固定大小顺序读取
+// sinceStart在startTransfer之前启动，用于计算首字节时间；limit不小于0时读到该字节数即停止，模拟取消粘贴；
+// consumerRate大于0时按该速率（字节/秒）限制读取，模拟写入较慢的粘贴目标；
+// outputs不为空时把第i个文件读到的数据追加写入outputs[i]，并从它已有的长度开始读取，模拟续传的接收方
+ReadResult readFiles(FileBufferManager* manager, const TransferFileList& files, qint64 readSize,
+                     const QElapsedTimer& sinceStart, qint64 limit = -1, qint64 consumerRate = 0,
+                     const std::vector<std::unique_ptr<QFile>>* outputs = nullptr)
+{
+    ReadResult result;
+    std::vector<char> buffer(static_cast<size_t>(readSize));
+
+    QElapsedTimer total;
+    total.start();
+    for (int index = 0; index < files.size(); ++index) {
+        QFile* output = outputs ? outputs->at(static_cast<size_t>(index)).get() : nullptr;
+        qint64 offset = output ? output->size() : 0;
+        while (offset < files.at(index).fileSize) {
+            if (limit >= 0 && result.bytes >= limit) {
+                result.elapsedNs = total.nsecsElapsed();
+                return result;
+            }
+            QElapsedTimer timer;
+            timer.start();
+            qint64 bytesRead = manager->readData(index, offset, buffer.data(), readSize);
+            result.latencies.push_back(timer.nsecsElapsed());
+            result.calls++;
+
+            if (bytesRead < 0) {
+                result.readError = true;
+                result.elapsedNs = total.nsecsElapsed();
+                return result;
+            }
+            if (bytesRead == 0) {
+                // 没有设置超时时只有传输停止才会返回0
+                if (++result.emptyReads > 1000) {
+                    result.elapsedNs = total.nsecsElapsed();
+                    return result;
+                }
+                QThread::msleep(1);
+                continue;
+            }
+            if (result.firstByteNs < 0) {
+                result.firstByteNs = sinceStart.nsecsElapsed();
+            }
+            if (output && output->write(buffer.data(), bytesRead) != bytesRead) {
+                result.writeError = true;
+                result.elapsedNs = total.nsecsElapsed();
+                return result;
+            }
+            offset += bytesRead;
+            result.bytes += bytesRead;
+
+            if (consumerRate > 0) {
+                const qint64 dueNs = result.bytes * 1000000000LL / consumerRate;
+                const qint64 aheadNs = dueNs - total.nsecsElapsed();
+                if (aheadNs > 0) {
+                    QThread::usleep(static_cast<unsigned long>(aheadNs / 1000));
+                }
+            }
+        }
+    }
+    result.elapsedNs = total.nsecsElapsed();
+    result.completionNs = sinceStart.nsecsElapsed();
+    return result;
+}
+
+// 模拟文件管理器粘贴：从LazyMimeData取text/uri-list，数据在这一次调用中落地到临时目录
+ReadResult pasteFiles(const std::shared_ptr<FileBufferManager>& session, const TransferFileList& files,
+                      const QElapsedTimer& sinceStart)
+{
+    ReadResult result;
+    QElapsedTimer timer;
+    timer.start();
+
+    LazyMimeData mimeData(session, files);
+    mimeData.setStagingEnabled(true);
+    QByteArray uriList = mimeData.data("text/uri-list");
+    result.latencies.push_back(timer.nsecsElapsed());
+    result.calls = 1;
+
+    // 只统计落地后大小正确的文件
+    const QList<QByteArray> lines = uriList.split('\n');
+    for (int index = 0; index < files.size() && index < lines.size(); ++index) {
+        QFileInfo info(QUrl::fromEncoded(lines.at(index).trimmed()).toLocalFile());
+        if (info.isFile() && info.size() == files.at(index).fileSize) {
+            result.bytes += info.size();
+        }
+    }
+    result.elapsedNs = timer.nsecsElapsed();
+    result.firstByteNs = result.elapsedNs;
+    result.completionNs = sinceStart.nsecsElapsed();
+    return result;
+}
+
+// 生成size字节的源文件，内容不重复，避免文件系统压缩或去重影响结果
+// text为true时生成由随机单词组成的文本，用于测试压缩层
+bool createSourceFile(QTemporaryFile& file, qint64 size, bool text)
+{
+    if (!file.open()) {
+        return false;
+    }
+    static const char* const words[] = {
+        "clipboard", "transfer", "chunk", "buffer", "stream", "file", "data", "queue",
+        "producer", "consumer", "offset", "range", "cache", "spill", "window", "read "
+    };
+    const qint64 blockSize = 1024 * 1024;
+    QByteArray block(static_cast<int>(blockSize), Qt::Uninitialized);
+    quint32 seed = 0x9e3779b9u;
+    for (qint64 written = 0; written < size; ) {
+        for (int i = 0; i < block.size(); ) {
+            seed = seed * 1664525u + 1013904223u;
+            if (!text) {
+                block[i++] = static_cast<char>(seed >> 24);
+                continue;
+            }
+            for (const char* word = words[seed >> 28]; *word && i < block.size(); ++word) {
+                block[i++] = *word;
+            }
+            if (i < block.size()) {
+                block[i++] = (seed >> 20) % 8 == 0 ? '\n' : ' ';
+            }
+        }
+        qint64 n = qMin(blockSize, size - written);
+        if (file.write(block.constData(), n) != n) {
+            return false;
+        }
+        written += n;
+    }
+    return file.flush();
+}
+
+// 按fileCount个文件平分totalSize生成源文件，余数放在第一个文件
+bool createSourceFiles(qint64 totalSize, int fileCount, bool text, TransferFileList& files,
+                       std::vector<std::unique_ptr<QTemporaryFile>>& generated, QString& error)
+{
+    for (int i = 0; i < fileCount; ++i) {
+        std::unique_ptr<QTemporaryFile> temp(new QTemporaryFile());
+        qint64 size = totalSize / fileCount + (i == 0 ? totalSize % fileCount : 0);
+        if (!createSourceFile(*temp, size, text)) {
+            error = temp->errorString();
+            return false;
+        }
+        TransferFile file;
+        file.filePath = temp->fileName();
+        file.fileName = QFileInfo(temp->fileName()).fileName();
+        file.fileSize = size;
+        files.append(file);
+        generated.push_back(std::move(temp));
+    }
+    return true;
+}
+
+// 扫描中的一组参数
+struct SweepPoint
+{
+    qint64 totalSize = 0;   // 生成的源文件总大小，传入已有文件时不使用
+    qint64 chunkSize = 0;   // 固定数据块大小，0表示默认或自适应
+    qint64 readSize = 0;
+    qint64 rate = 0;        // 生产者限速（字节/秒），0表示不限速
+    int roundTripMs = 0;
+    int workers = 1;
+    int queueDepth = ChunkSource::DEFAULT_QUEUE_DEPTH;
+};
+
+// 解析逗号分隔的数值列表并乘以unit，为空时返回只含defaultValue的列表
+QList<qint64> parseList(const QString& value, qint64 unit, qint64 defaultValue)
+{
+    QList<qint64> values;
+    for (const QString& item : value.split(',', QString::SkipEmptyParts)) {
+        values << qMax((qint64)0, item.trimmed().toLongLong()) * unit;
+    }
+    if (values.isEmpty()) {
+        values << defaultValue;
+    }
+    return values;
+}
+
+qint64 percentile(const std::vector<qint64>& sorted, double p)
+{
+    if (sorted.empty()) {
+        return 0;
+    }
+    size_t index = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+    return sorted[qMin(index, sorted.size() - 1)];
+}
+
+double toMB(qint64 bytes)
+{
+    return bytes / (1024.0 * 1024.0);
+}
+
+// 整个文件的CRC32C，读取失败时返回false
+bool fileChecksum(const QString& path, quint32& checksum)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    checksum = 0;
+    std::vector<char> block(4 * 1024 * 1024);
+    for (;;) {
+        const qint64 n = file.read(block.data(), static_cast<qint64>(block.size()));
+        if (n < 0) {
+            return false;
+        }
+        if (n == 0) {
+            return true;
+        }
+        checksum = Crc32c::combine(checksum, Crc32c::compute(block.data(), n), n);
+    }
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("TransferBench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Headless throughput and latency benchmark for the transfer core.");
+    parser.addHelpOption();
+    QCommandLineOption sizeOption("size", "Comma-separated total sizes of generated source files in MB.", "MB", "256");
+    QCommandLineOption filesOption("files", "Number of generated source files.", "count", "1");
+    QCommandLineOption readSizeOption("read-size", "Comma-separated bytes requested per readData call, in KB.", "KB", "1024");
+    QCommandLineOption chunkSizeOption("chunk-size", "Comma-separated fixed chunk sizes in KB; 0 uses the default or adaptive size.", "KB", "0");
+    QCommandLineOption runsOption("runs", "Number of transfers to run.", "count", "3");
+    QCommandLineOption modeOption("mode", "Source mode: buffered, mapped, uring or network.", "mode", "buffered");
+    QCommandLineOption queueDepthOption("queue-depth", "Comma-separated in-flight reads per source for uring mode.", "count", "16");
+    QCommandLineOption rttOption("rtt", "Comma-separated emulated round-trip times in ms for network mode.", "ms", "0");
+    QCommandLineOption windowOption("window", "Receive window per connection for network mode, in KB.", "KB", "8192");
+    QCommandLineOption patternOption("pattern", "Generated content: random or text.", "pattern", "random");
+    QCommandLineOption compressOption("compress", "Compress chunks with the given number of threads, 0 for one per core.", "threads");
+    QCommandLineOption workersOption("workers", "Comma-separated range worker counts; 1 reads sequentially.", "count", "1");
+    QCommandLineOption rangeSizeOption("range-size", "Range size per worker request, in KB.", "KB", "4096");
+    QCommandLineOption consumerRateOption("consumer-rate", "Reader rate limit in MB/s, 0 for unlimited; "
+                                          "with --spill shows that buffered memory stays bounded.", "MB/s", "0");
+    QCommandLineOption rateOption("rate", "Comma-separated producer rate limits in MB/s, 0 for unlimited.", "MB/s", "0");
+    QCommandLineOption adaptiveOption("adaptive", "Enable adaptive chunk sizing.");
+    QCommandLineOption noGatherOption("no-gather", "Read from one chunk per readData call.");
+    QCommandLineOption spillOption("spill", "Enable the disk spill tier.");
+    QCommandLineOption cacheOption("cache", "Chunk cache budget in MB.", "MB", "128");
+    QCommandLineOption checkpointOption("checkpoint", "Keep resumable checkpoints in the given directory.", "dir");
+    QCommandLineOption interruptOption("interrupt-after", "Cancel a transfer after this many MB before each run, so the run resumes from its checkpoint.", "MB", "0");
+    QCommandLineOption verifyOption("verify", "Checksum chunks with CRC32C and verify every file end to end.");
+    QCommandLineOption metricsOption("metrics", "Print per-stage latency histograms and throughput as JSON after each run.");
+    QCommandLineOption jsonOption("json", "Print one JSON object per run instead of text; other output goes to stderr.");
+    QCommandLineOption pasteOption("paste", "Read through LazyMimeData text/uri-list like a file manager paste.");
+    QCommandLineOption sessionsOption("sessions", "Number of concurrent transfer sessions, each reading all files.", "count", "1");
+    QCommandLineOption ioThreadsOption("io-threads", "Concurrent source reads and I/O threads shared by all sessions, 0 for the default.", "count", "0");
+    QCommandLineOption mixOption("mix", "Comma-separated sizes in MB, one concurrent session per size started in this order; "
+                                 "reports each session's completion time.", "MB");
+    QCommandLineOption policyOption("policy", "Scheduling of source reads across sessions: fifo, srpt or wfq.", "policy", "fifo");
+    QCommandLineOption priorityOption("priority", "Comma-separated session priorities; the last one repeats.", "list", "1");
+    QCommandLineOption queueBenchOption("queue-bench", "Only compare the lock-free chunk ring with a mutex-protected QQueue, "
+                                        "moving 1 GB per --chunk-size (default 4,64,512 KB).");
+    parser.addOptions({ sizeOption, filesOption, readSizeOption, chunkSizeOption, runsOption, modeOption, rateOption, consumerRateOption,
+                        adaptiveOption, noGatherOption, spillOption, cacheOption, pasteOption,
+                        rttOption, windowOption, workersOption, rangeSizeOption,
+                        patternOption, compressOption, verifyOption, checkpointOption, interruptOption,
+                        metricsOption, jsonOption, sessionsOption, ioThreadsOption,
+                        mixOption, policyOption, priorityOption, queueDepthOption, queueBenchOption });
+    parser.addPositionalArgument("files", "Existing files to transfer instead of generated ones.", "[files...]");
+    parser.process(app);
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+    // JSON输出时标准输出只有每次测量的结果，便于脚本逐行解析
+    const bool json = parser.isSet(jsonOption);
+    QTextStream& info = json ? err : out;
+
+    // 队列微基准：不创建源文件和会话，只测量两种队列交接数据块的开销
+    if (parser.isSet(queueBenchOption)) {
+        QList<qint64> queueChunkSizes = parseList(parser.value(chunkSizeOption), 1024, 0);
+        queueChunkSizes.removeAll(0);
+        if (queueChunkSizes.isEmpty()) {
+            queueChunkSizes << 4 * 1024 << 64 * 1024 << 512 * 1024;
+        }
+        const QList<QueueBench::Result> results =
+            QueueBench::run(queueChunkSizes, (qint64)1024 * 1024 * 1024, qMax(1, parser.value(runsOption).toInt()));
+        for (const QueueBench::Result& result : results) {
+            if (json) {
+                QJsonObject object;
+                object.insert("queue", result.queue);
+                object.insert("chunkSize", result.chunkSize);
+                object.insert("chunks", result.chunks);
+                object.insert("elapsedNs", result.elapsedNs);
+                object.insert("nsPerChunk", result.nsPerChunk());
+                object.insert("throughputMBps", result.mbPerSecond());
+                out << QJsonDocument(object).toJson(QJsonDocument::Compact) << "\n";
+            } else {
+                out << "queue " << result.queue << ", chunk " << result.chunkSize / 1024 << " KB: "
+                    << result.nsPerChunk() << " ns/chunk, "
+                    << result.mbPerSecond() << " MB/s, "
+                    << (result.nsPerChunk() > 0 ? 1e9 / result.nsPerChunk() : 0.0) << " chunks/s\n";
+            }
+        }
+        return 0;
+    }
+
+    // 源文件：命令行给出的文件，或按每个大小生成的临时文件
+    TransferFileList givenFiles;
+    const QStringList paths = parser.positionalArguments();
+    for (const QString& path : paths) {
+        QFileInfo fileInfo(path);
+        if (!fileInfo.isFile()) {
+            err << "not a file: " << path << "\n";
+            return 1;
+        }
+        TransferFile file;
+        file.filePath = fileInfo.absoluteFilePath();
+        file.fileName = fileInfo.fileName();
+        file.fileSize = fileInfo.size();
+        givenFiles.append(file);
+    }
+    // 混合负载：每个大小一个会话，各自读取自己的源文件
+    const QList<qint64> mixSizes = parser.isSet(mixOption)
+        ? parseList(parser.value(mixOption), 1024 * 1024, 0) : QList<qint64>();
+    QList<qint64> sizes;
+    if (givenFiles.isEmpty() && mixSizes.isEmpty()) {
+        sizes = parseList(parser.value(sizeOption), 1024 * 1024, 256 * 1024 * 1024);
+    } else {
+        sizes << 0;
+    }
+    const QList<qint64> readSizes = parseList(parser.value(readSizeOption), 1024, 1024 * 1024);
+    const QList<qint64> chunkSizes = parseList(parser.value(chunkSizeOption), 1024, 0);
+    const QList<qint64> rates = parseList(parser.value(rateOption), 1024 * 1024, 0);
+    const qint64 consumerRate = qMax((qint64)0, parser.value(consumerRateOption).toLongLong()) * 1024 * 1024;
+
+    const int runs = qMax(1, parser.value(runsOption).toInt());
+    const bool paste = parser.isSet(pasteOption);
+    const bool verify = parser.isSet(verifyOption);
+    const qint64 interruptBytes = parser.value(interruptOption).toLongLong() * 1024 * 1024;
+
+    // 并发会话读取同一组文件，同一个源文件的检查点同时只能由一个会话使用
+    const int sessionCount = mixSizes.isEmpty() ? qMax(1, parser.value(sessionsOption).toInt()) : mixSizes.size();
+    if (sessionCount > 1 && (parser.isSet(checkpointOption) || interruptBytes > 0)) {
+        err << "--checkpoint and --interrupt-after need a single session\n";
+        return 1;
+    }
+    // 续传需要接收方保留部分文件，粘贴落地的文件由LazyMimeData管理
+    if (paste && interruptBytes > 0) {
+        err << "--interrupt-after can't be combined with --paste\n";
+        return 1;
+    }
+    TransferScheduler::Policy policy;
+    if (!TransferScheduler::parsePolicy(parser.value(policyOption), policy)) {
+        err << "unknown policy: " << parser.value(policyOption) << "\n";
+        return 1;
+    }
+    const QList<qint64> priorities = parseList(parser.value(priorityOption), 1, TransferScheduler::DEFAULT_PRIORITY);
+
+    TransferSessionManager sessionManager(parser.value(ioThreadsOption).toInt());
+    sessionManager.setSchedulingPolicy(policy);
+    std::vector<std::unique_ptr<BenchSession>> sessions;
+    const QString mode = parser.value(modeOption);
+    for (int i = 0; i < sessionCount; ++i) {
+        std::unique_ptr<BenchSession> session(new BenchSession());
+        session->manager = sessionManager.createSession();
+        FileBufferManager* manager = session->manager.get();
+        manager->setStreamSink(&session->sink);
+        manager->setSourceMode(mode == "mapped" ? ChunkSource::MemoryMapped
+                               : mode == "network" ? ChunkSource::Network
+                               : mode == "uring" ? ChunkSource::IoUring : ChunkSource::Buffered);
+        manager->setGatherMode(!parser.isSet(noGatherOption));
+        manager->setSpill(parser.isSet(spillOption));
+        manager->setCacheBudget(parser.value(cacheOption).toLongLong() * 1024 * 1024);
+        manager->setCompression(parser.isSet(compressOption), parser.value(compressOption).toInt());
+        manager->setChecksums(verify);
+        manager->setCheckpoints(parser.isSet(checkpointOption), parser.value(checkpointOption));
+        sessions.push_back(std::move(session));
+    }
+    // 单会话时的检查点续传和统计都针对第一个会话
+    FileBufferManager* manager = sessions.front()->manager.get();
+
+    // 网络模式从本机的回环服务端拉取源文件，每个往返延迟各跑runs次
+    LoopbackChunkServer server;
+    QList<int> roundTripTimes;
+    if (mode == "network") {
+        if (!server.start()) {
+            err << "start loopback server failed: " << server.errorString() << "\n";
+            return 1;
+        }
+        NetworkPeer peer;
+        peer.port = server.port();
+        peer.receiveWindow = qMax((qint64)1, parser.value(windowOption).toLongLong()) * 1024;
+        for (const std::unique_ptr<BenchSession>& session : sessions) {
+            session->manager->setNetworkPeer(peer);
+        }
+        for (qint64 value : parseList(parser.value(rttOption), 1, 0)) {
+            roundTripTimes << static_cast<int>(value);
+        }
+        info << "loopback server port: " << peer.port << ", window: " << peer.receiveWindow / 1024 << " KB\n";
+    }
+    if (roundTripTimes.isEmpty()) {
+        roundTripTimes << 0;
+    }
+
+    // 每个往返延迟下依次测试各个并发读取线程数
+    QList<int> workerCounts;
+    for (qint64 value : parseList(parser.value(workersOption), 1, 1)) {
+        workerCounts << qMax(1, static_cast<int>(value));
+    }
+    const qint64 rangeSize = qMax((qint64)1, parser.value(rangeSizeOption).toLongLong()) * 1024;
+
+    // io_uring模式下依次测试各个队列深度，其他模式只跑一次
+    QList<int> queueDepths;
+    if (mode == "uring") {
+        for (qint64 value : parseList(parser.value(queueDepthOption), 1, ChunkSource::DEFAULT_QUEUE_DEPTH)) {
+            queueDepths << qMax(1, static_cast<int>(value));
+        }
+        info << "io_uring: " << (UringFileSource::isSupported() ? "supported" : "unavailable, buffered fallback") << "\n";
+    } else {
+        queueDepths << ChunkSource::DEFAULT_QUEUE_DEPTH;
+    }
+
+    // 扫描所有参数组合，源文件大小在最外层，每个大小只生成一次源文件
+    QList<SweepPoint> points;
+    for (qint64 size : sizes) {
+        for (qint64 chunkSize : chunkSizes) {
+            for (qint64 readSize : readSizes) {
+                for (qint64 rate : rates) {
+                    for (int roundTripMs : roundTripTimes) {
+                        for (int workers : workerCounts) {
+                            for (int queueDepth : queueDepths) {
+                                SweepPoint point;
+                                point.totalSize = size;
+                                point.chunkSize = chunkSize;
+                                point.readSize = qMax((qint64)1, readSize);
+                                point.rate = rate;
+                                point.roundTripMs = roundTripMs;
+                                point.workers = workers;
+                                point.queueDepth = queueDepth;
+                                points << point;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+    // 只有取值多于一个的参数才在每行文本输出中标出
+    const bool sweepSizes = sizes.size() > 1;
+    const bool sweepChunks = chunkSizes.size() > 1;
+    const bool sweepReads = readSizes.size() > 1;
+    const bool sweepRates = rates.size() > 1;
+
+    TransferFileList files = givenFiles;
+    std::vector<std::unique_ptr<QTemporaryFile>> generated;
+    qint64 generatedSize = -1;
+
+    // 混合负载的源文件只生成一次，files不再使用
+    std::vector<TransferFileList> mixFiles;
+    std::vector<std::unique_ptr<QTemporaryFile>> mixGenerated;
+    for (qint64 size : mixSizes) {
+        TransferFileList list;
+        QString error;
+        if (!createSourceFiles(size, qMax(1, parser.value(filesOption).toInt()),
+                               parser.value(patternOption) == "text", list, mixGenerated, error)) {
+            err << "create source file failed: " << error << "\n";
+            return 1;
+        }
+        mixFiles.push_back(list);
+    }
+
+    for (int pass = 0; pass < points.size() * runs; ++pass) {
+        const int run = pass % runs;
+        const SweepPoint& point = points.at(pass / runs);
+
+        if (givenFiles.isEmpty() && mixFiles.empty() && point.totalSize != generatedSize) {
+            generated.clear();
+            files.clear();
+            QString error;
+            if (!createSourceFiles(point.totalSize, qMax(1, parser.value(filesOption).toInt()),
+                                   parser.value(patternOption) == "text", files, generated, error)) {
+                err << "create source file failed: " << error << "\n";
+                return 1;
+            }
+            generatedSize = point.totalSize;
+        }
+        // 每个会话读取的文件；totalSize为一个会话的大小，混合负载时为所有会话的总和
+        std::vector<TransferFileList> sessionFiles(sessionCount, files);
+        if (!mixFiles.empty()) {
+            sessionFiles = mixFiles;
+        }
+        qint64 totalSize = 0;
+        qint64 expectedBytes = 0;
+        int expectedFiles = 0;
+        for (const TransferFileList& list : sessionFiles) {
+            for (const TransferFile& file : list) {
+                expectedBytes += file.fileSize;
+            }
+            expectedFiles += list.size();
+        }
+        for (const TransferFile& file : files) {
+            totalSize += file.fileSize;
+        }
+        if (!mixFiles.empty()) {
+            totalSize = expectedBytes;
+        }
+        if (run == 0 && (pass == 0 || sweepSizes)) {
+            info << "files: " << expectedFiles / sessionCount << ", size: " << toMB(totalSize) << " MB";
+            if (!sweepReads) {
+                info << ", read size: " << point.readSize / 1024 << " KB";
+            }
+            info << ", mode: " << mode;
+            if (sessionCount > 1) {
+                info << ", sessions: " << sessionCount << ", io threads: " << sessionManager.maxIoThreads()
+                     << ", policy: " << TransferScheduler::policyName(policy);
+            }
+            info
+                 << (paste ? ", paste: text/uri-list" : "")
+                 << (verify ? (Crc32c::isHardwareAccelerated() ? ", verify: crc32c sse4.2" : ", verify: crc32c table") : "")
+                 << "\n";
+            info.flush();
+        }
+
+        // 固定数据块大小时把自适应的上下界设为同一个值
+        for (const std::unique_ptr<BenchSession>& session : sessions) {
+            if (point.chunkSize > 0) {
+                session->manager->setAdaptiveChunkSize(true, point.chunkSize, point.chunkSize);
+            } else {
+                session->manager->setAdaptiveChunkSize(parser.isSet(adaptiveOption));
+            }
+            session->manager->setPacingPolicy(point.rate > 0 ? PacingPolicy::tokenBucket(point.rate, point.rate / 10)
+                                                             : PacingPolicy::unlimited());
+            session->manager->setRangeWorkers(point.workers, rangeSize);
+            session->manager->setIoQueueDepth(point.queueDepth);
+        }
+        server.setRoundTripTime(point.roundTripMs);
+        const qint64 readSize = point.readSize;
+
+        // 先取消一次传输，接收方把读到的数据写入部分文件；下面的传输按检查点校验部分文件后从断点续传
+        QTemporaryDir receiver;
+        std::vector<std::unique_ptr<QFile>> outputs;
+        qint64 resumedBytes = 0;
+        if (interruptBytes > 0) {
+            const TransferFileList& interruptedFiles = sessionFiles.front();
+            if (!receiver.isValid()) {
+                err << "create receiver directory failed\n";
+                return 1;
+            }
+            for (int index = 0; index < interruptedFiles.size(); ++index) {
+                std::unique_ptr<QFile> output(new QFile(receiver.filePath(QString::number(index))));
+                if (!output->open(QIODevice::ReadWrite | QIODevice::Truncate)) {
+                    err << "create " << output->fileName() << " failed: " << output->errorString() << "\n";
+                    return 1;
+                }
+                outputs.push_back(std::move(output));
+            }
+
+            QElapsedTimer interrupted;
+            interrupted.start();
+            manager->startTransfer(interruptedFiles);
+            const TransferFileList published = sessions.front()->sink.files();
+            ReadResult cancelled;
+            QThread* reader = QThread::create([manager, &cancelled, &published, readSize, &interrupted, interruptBytes, &outputs]() {
+                cancelled = readFiles(manager, published, readSize, interrupted, interruptBytes, 0, &outputs);
+            });
+            reader->start();
+            reader->wait();
+            delete reader;
+            manager->stopTransfer();
+            if (cancelled.readError || cancelled.writeError) {
+                err << "interrupted transfer failed before " << toMB(interruptBytes) << " MB\n";
+                return 1;
+            }
+            const qint64 checkpointed = manager->statistics().checkpoint.writtenBytes;
+
+            // 接收方续传：按检查点校验已写出的部分，截断到校验通过的前缀，之后从那里继续写入
+            for (int index = 0; index < interruptedFiles.size(); ++index) {
+                QFile& output = *outputs[static_cast<size_t>(index)];
+                const qint64 offset = output.flush() ? manager->resumeFile(interruptedFiles.at(index), output) : 0;
+                if (!output.resize(offset) || !output.seek(offset)) {
+                    err << "truncate " << output.fileName() << " failed: " << output.errorString() << "\n";
+                    return 1;
+                }
+                resumedBytes += offset;
+            }
+            info << "cancelled after " << toMB(cancelled.bytes) << " MB, checkpointed: "
+                 << toMB(checkpointed) << " MB, resuming at: " << toMB(resumedBytes) << " MB\n";
+        }
+
+        // 峰值常驻内存和分配计数只统计这一次传输（峰值仅在Linux上可以重置）
+        MemoryStats::resetPeakResident();
+        const quint64 allocationsBefore = MemoryStats::allocations();
+        const quint64 allocatedBytesBefore = MemoryStats::allocatedBytes();
+
+        // 所有会话同时开始，每个会话一个读取线程；生产任务共用会话管理器的线程池
+        QElapsedTimer sinceStart;
+        sinceStart.start();
+        // 按顺序开始，Fifo下先开始的会话优先
+        for (int i = 0; i < sessionCount; ++i) {
+            sessions[i]->manager->startTransfer(sessionFiles[i], static_cast<int>(priorities.at(qMin(i, priorities.size() - 1))));
+        }
+
+        std::vector<ReadResult> results(sessions.size());
+        std::vector<QThread*> readers;
+        for (size_t i = 0; i < sessions.size(); ++i) {
+            const std::shared_ptr<FileBufferManager> session = sessions[i]->manager;
+            const TransferFileList published = sessions[i]->sink.files();
+            ReadResult* result = &results[i];
+            // 续传时只有一个会话，接着写入被取消时的部分文件
+            const std::vector<std::unique_ptr<QFile>>* sessionOutputs = outputs.empty() ? nullptr : &outputs;
+            readers.push_back(QThread::create([session, result, published, readSize, paste, consumerRate, sessionOutputs, &sinceStart]() {
+                *result = paste ? pasteFiles(session, published, sinceStart)
+                                : readFiles(session.get(), published, readSize, sinceStart, -1, consumerRate, sessionOutputs);
+            }));
+            readers.back()->start();
+        }
+        ReadResult result;
+        for (size_t i = 0; i < readers.size(); ++i) {
+            readers[i]->wait();
+            delete readers[i];
+            mergeResult(result, results[i]);
+        }
+        // 各会话的完成时间，混合负载下比较调度策略的指标
+        double meanCompletionMs = 0.0;
+        for (const ReadResult& sessionResult : results) {
+            meanCompletionMs += sessionResult.completionNs / 1e6 / results.size();
+        }
+
+        // 吞吐按读取方看到的时间计算，之后再等后台校验收尾
+        int verifiedFiles = 0;
+        if (verify) {
+            for (const std::unique_ptr<BenchSession>& session : sessions) {
+                const TransferFileList published = session->sink.files();
+                session->manager->waitForVerification();
+                for (int index = 0; index < published.size(); ++index) {
+                    if (session->manager->fileVerification(index).status == ChunkVerifier::FileResult::Verified
+                        || published.at(index).fileSize == 0) {
+                        verifiedFiles++;
+                    }
+                }
+            }
+        }
+        TransferStatistics stats = manager->statistics();
+        const QByteArray metrics = manager->metricsJson();
+        // 数据块入队到取出它的readData返回，包含队列停留、读取方唤醒和复制
+        const LatencyHistogram::Snapshot handoff = manager->metrics().histogram(TransferMetrics::EnqueueToReturn);
+        // 每KB的readData耗时和其中复制的耗时，不同--read-size下应基本不变
+        const LatencyHistogram::Snapshot copy = manager->metrics().histogram(TransferMetrics::Copy);
+        const qint64 copiedBytes = manager->metrics().bytes(TransferMetrics::Copy);
+        const double readNsPerKB = result.bytes > 0
+            ? std::accumulate(result.latencies.begin(), result.latencies.end(), 0.0) * 1024 / result.bytes : 0.0;
+        const double copyNsPerKB = copiedBytes > 0 ? double(copy.totalNs) * 1024 / copiedBytes : 0.0;
+        sessionManager.stopAll();
+        // 生产者在文件结束时才汇总检查点统计，停止后再取
+        stats.checkpoint = manager->statistics().checkpoint;
+
+        const qint64 allocations = static_cast<qint64>(MemoryStats::allocations() - allocationsBefore);
+        const qint64 allocatedBytes = static_cast<qint64>(MemoryStats::allocatedBytes() - allocatedBytesBefore);
+        const qint64 peakResident = MemoryStats::peakResidentBytes();
+
+        std::sort(result.latencies.begin(), result.latencies.end());
+        double seconds = result.elapsedNs / 1e9;
+        double average = result.calls > 0 ? double(std::accumulate(result.latencies.begin(), result.latencies.end(), (qint64)0)) / result.calls : 0.0;
+        const double throughput = seconds > 0 ? toMB(result.bytes) / seconds : 0.0;
+        // 校验线程的计算时间占读取时间的比例：有空闲核心时与传输并行，单核上即为吞吐的开销
+        const double verifyCpuPercent = result.elapsedNs > 0
+            ? stats.verification.verifyMicros * 1000.0 * 100 / result.elapsedNs : 0.0;
+
+        if (json) {
+            QJsonObject config;
+            config.insert("mode", mode);
+            config.insert("files", files.size());
+            config.insert("totalBytes", totalSize);
+            config.insert("chunkSize", point.chunkSize);
+            config.insert("readSize", readSize);
+            config.insert("rateBytesPerSecond", point.rate);
+            config.insert("consumerRateBytesPerSecond", consumerRate);
+            config.insert("workers", point.workers);
+            if (mode == "uring") {
+                config.insert("queueDepth", point.queueDepth);
+            }
+            config.insert("rttMs", point.roundTripMs);
+            config.insert("compress", parser.isSet(compressOption));
+            config.insert("verify", verify);
+            config.insert("sessions", sessionCount);
+            config.insert("policy", QLatin1String(TransferScheduler::policyName(policy)));
+
+            QJsonObject latency;
+            latency.insert("avg", average / 1000.0);
+            latency.insert("p50", percentile(result.latencies, 0.50) / 1000.0);
+            latency.insert("p99", percentile(result.latencies, 0.99) / 1000.0);
+            latency.insert("max", result.latencies.empty() ? 0.0 : result.latencies.back() / 1000.0);
+
+            QJsonObject handoffLatency;
+            handoffLatency.insert("p50", handoff.percentile(0.50) / 1000.0);
+            handoffLatency.insert("p99", handoff.percentile(0.99) / 1000.0);
+            handoffLatency.insert("max", handoff.maxNs / 1000.0);
+
+            QJsonObject object;
+            object.insert("config", config);
+            object.insert("run", run + 1);
+            object.insert("mbPerSecond", throughput);
+            object.insert("bytes", result.bytes);
+            object.insert("readCalls", result.calls);
+            object.insert("readCallsPerGB", stats.readCallsPerGB());
+            object.insert("emptyReads", result.emptyReads);
+            object.insert("readError", result.readError);
+            object.insert("ttfbMs", result.firstByteNs / 1e6);
+            object.insert("readLatencyUs", latency);
+            object.insert("handoffLatencyUs", handoffLatency);
+            object.insert("readNsPerKB", readNsPerKB);
+            object.insert("copyNsPerKB", copyNsPerKB);
+            object.insert("meanCompletionMs", meanCompletionMs);
+            if (sessionCount > 1) {
+                QJsonArray completion;
+                for (const ReadResult& sessionResult : results) {
+                    completion.append(sessionResult.completionNs / 1e6);
+                }
+                object.insert("completionMs", completion);
+            }
+            object.insert("peakRssBytes", peakResident);
+            object.insert("allocations", allocations);
+            object.insert("allocatedBytes", allocatedBytes);
+            object.insert("chunks", stats.chunksConsumed);
+            object.insert("chunkSize", stats.chunkSize);
+            object.insert("poolMisses", stats.pool.misses);
+            object.insert("spilledBytes", stats.spill.spilledBytes);
+            object.insert("peakBufferedBytes", stats.peakBufferedBytes);
+            if (verify) {
+                object.insert("verifiedFiles", verifiedFiles);
+                object.insert("verifyMicros", stats.verification.verifyMicros);
+                object.insert("verifyCpuPercent", verifyCpuPercent);
+            }
+            if (parser.isSet(metricsOption)) {
+                object.insert("metrics", QJsonDocument::fromJson(metrics).object());
+            }
+            out << QJsonDocument(object).toJson(QJsonDocument::Compact) << "\n";
+            out.flush();
+        } else {
+            if (sweepSizes) {
+                out << "size " << toMB(totalSize) << " MB, ";
+            }
+            if (sweepChunks) {
+                out << "chunk " << point.chunkSize / 1024 << " KB, ";
+            }
+            if (sweepReads) {
+                out << "read " << readSize / 1024 << " KB, ";
+            }
+            if (sweepRates) {
+                out << "rate " << toMB(point.rate) << " MB/s, ";
+            }
+            if (mode == "network") {
+                out << "rtt " << point.roundTripMs << " ms, ";
+            }
+            if (workerCounts.size() > 1 || point.workers > 1) {
+                out << "workers " << point.workers << ", ";
+            }
+            if (mode == "uring") {
+                out << "qd " << point.queueDepth << ", ";
+            }
+            if (sessionCount > 1) {
+                out << "sessions " << sessionCount << ", ";
+            }
+            out << "run " << run + 1 << ": "
+                << throughput << " MB/s"
+                << ", bytes: " << result.bytes
+                << ", readData calls: " << result.calls
+                << " (" << stats.readCallsPerGB() << "/GB)"
+                << ", empty: " << result.emptyReads
+                << ", ttfb ms: " << result.firstByteNs / 1e6
+                << ", mean completion ms: " << meanCompletionMs
+                << ", latency us avg/p50/p99/max: "
+                << average / 1000.0 << "/"
+                << percentile(result.latencies, 0.50) / 1000.0 << "/"
+                << percentile(result.latencies, 0.99) / 1000.0 << "/"
+                << (result.latencies.empty() ? 0.0 : result.latencies.back() / 1000.0)
+                << ", enqueue to return us p50/p99: "
+                << handoff.percentile(0.50) / 1000.0 << "/" << handoff.percentile(0.99) / 1000.0
+                << ", ns/KB read/copy: " << readNsPerKB << "/" << copyNsPerKB
+                << ", peak RSS MB: " << toMB(peakResident)
+                << ", allocations: " << allocations << " (" << toMB(allocatedBytes) << " MB)"
+                << ", chunks: " << stats.chunksConsumed
+                << ", chunk size: " << stats.chunkSize
+                << ", pool hits/misses: " << stats.pool.hits << "/" << stats.pool.misses
+                << ", spilled: " << stats.spill.spilledBytes
+                << ", peak buffered MB: " << toMB(stats.peakBufferedBytes)
+                << ", compression ratio: " << stats.compression.ratio()
+                << " (" << stats.compression.compressedChunks << " compressed, "
+                << stats.compression.skippedChunks << " skipped, "
+                << stats.compression.compressMicros / 1000 << "/" << stats.compression.decompressMicros / 1000 << " ms)"
+                << ", out of order: " << stats.ranges.outOfOrderChunks
+                << ", reassembly peak MB: " << toMB(stats.ranges.peakReassemblyBytes);
+            if (parser.isSet(checkpointOption)) {
+                out << ", resumed MB: " << toMB(stats.checkpoint.resumedBytes)
+                    << ", checkpointed MB: " << toMB(stats.checkpoint.writtenBytes);
+            }
+            if (verify) {
+                out << ", verified files: " << verifiedFiles << "/" << expectedFiles
+                    << ", chunk mismatches: " << stats.verification.chunkMismatches
+                    << ", verify ms: " << stats.verification.verifyMicros / 1000
+                    << " (" << verifyCpuPercent << "% of read time)";
+            }
+            out << "\n";
+            if (sessionCount > 1) {
+                out << "completion ms:";
+                for (const ReadResult& sessionResult : results) {
+                    out << " " << sessionResult.completionNs / 1e6;
+                }
+                out << "\n";
+            }
+            if (parser.isSet(metricsOption)) {
+                out << "metrics: " << metrics << "\n";
+            }
+            out.flush();
+        }
+
+        if (result.readError) {
+            err << "read error: readData reported corrupted data\n";
+            return 1;
+        }
+        if (result.writeError) {
+            err << "write error: can't write the resumed output\n";
+            return 1;
+        }
+        // 续传只从源文件读取断点之后的部分，接收方拼接出的文件与源文件逐字节一致
+        if (interruptBytes > 0) {
+            const TransferFileList& resumedFiles = sessionFiles.front();
+            qint64 resumedSize = 0;
+            for (const TransferFile& file : resumedFiles) {
+                resumedSize += file.fileSize;
+            }
+            const qint64 sourceBytes = manager->metrics().bytes(TransferMetrics::SourceRead);
+            if (sourceBytes != resumedSize - resumedBytes) {
+                err << "resume read " << sourceBytes << " source bytes, expected " << resumedSize - resumedBytes
+                    << " (" << resumedBytes << " of " << resumedSize << " resumed, refills: "
+                    << stats.refillRequests << ")\n";
+                return 1;
+            }
+            for (int index = 0; index < resumedFiles.size(); ++index) {
+                QFile& output = *outputs[static_cast<size_t>(index)];
+                quint32 sourceChecksum = 0;
+                quint32 outputChecksum = 0;
+                if (!output.flush() || output.size() != resumedFiles.at(index).fileSize
+                    || !fileChecksum(resumedFiles.at(index).filePath, sourceChecksum)
+                    || !fileChecksum(output.fileName(), outputChecksum) || outputChecksum != sourceChecksum) {
+                    err << "resumed output differs from source: " << resumedFiles.at(index).fileName << "\n";
+                    return 1;
+                }
+            }
+        }
+        if (verify && verifiedFiles != expectedFiles) {
+            err << "verification failed: " << verifiedFiles << " of " << expectedFiles << " files\n";
+            return 1;
+        }
+
+        // 续传时断点之前的数据不再读取
+        if (result.bytes != expectedBytes - resumedBytes) {
+            err << "short read: " << result.bytes << " of " << expectedBytes - resumedBytes << "\n";
+            return 1;
+        }
+    }
+
+    out.flush();
+    sessionManager.stopAll();
+    server.stop();
+    return 0;
+}
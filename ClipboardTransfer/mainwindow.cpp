@@ -12,14 +12,10 @@ MainWindow::MainWindow(QWidget *parent)
     , centralWidget_(nullptr)
     , transferInProgress_(false)
 {
+#ifdef Q_OS_WIN
     // 初始化COM
     ::OleInitialize(nullptr);
-
-    // 连接信号
-    connect(FileBufferManager::instance(), &FileBufferManager::transferProgress, 
-            this, &MainWindow::onTransferProgress);
-    connect(FileBufferManager::instance(), &FileBufferManager::transferFinished, 
-            this, &MainWindow::onTransferFinished);
+#endif
 
     // 设置UI
     setupUI();
@@ -30,25 +26,16 @@ MainWindow::MainWindow(QWidget *parent)
 
     QString fileName = "D:\\005799\\Downloads\\Notepad--v3.6.0-plugin-Installer.exe";
     if (!fileName.isEmpty()) {
-        QFileInfo fileInfo(fileName);
-        filePathEdit_->setText(fileInfo.fileName());
-
-        // 更新文件大小显示
-        qint64 fileSizeBytes = fileInfo.size();
-        QString sizeStr = formatFileSize(fileSizeBytes);
-        fileSizeDisplayLabel_->setText(tr("file size: %1").arg(sizeStr));
-
-        // 存储完整路径以备后用
-        selectedFilePath_ = fileName;
+        setSelectedFiles(QStringList() << fileName);
     }
 }
 
 MainWindow::~MainWindow()
 {
+#ifdef Q_OS_WIN
     // 清理COM
     OleUninitialize();
-    // 销毁单例
-    FileBufferManager::destroyInstance();
+#endif
 }
 
 void MainWindow::setupUI()
@@ -121,16 +108,22 @@ void MainWindow::setupUI()
 void MainWindow::onStartTransfer()
 {
     // 获取文件名和大小
-    QString fileName = filePathEdit_->text();
-    if (fileName.isEmpty() || selectedFilePath_.isEmpty()) {
+    if (selectedFilePaths_.isEmpty()) {
         QMessageBox::warning(this, "error", "please select file");
         return;
     }
 
     // 使用实际文件大小
-    QFileInfo fileInfo(selectedFilePath_);
-    qint64 fileSizeBytes = fileInfo.size();
-    qDebug() << "使用实际文件大小:" << fileSizeBytes << "字节";
+    TransferFileList files;
+    for (const QString& filePath : selectedFilePaths_) {
+        QFileInfo fileInfo(filePath);
+        TransferFile file;
+        file.filePath = filePath;
+        file.fileName = fileInfo.fileName();
+        file.fileSize = fileInfo.size();
+        files.append(file);
+        qDebug() << "使用实际文件大小:" << file.fileName << file.fileSize << "字节";
+    }
 
     // 更新UI状态
     transferInProgress_ = true;
@@ -144,20 +137,41 @@ void MainWindow::onStartTransfer()
     progressBar_->setValue(0);
     statusLabel_->setText(tr("eleady transf..."));
 
+    // 每次传输是一个独立会话；已读完的旧会话不再被剪贴板引用时即可回收
+    sessions_.closeFinishedSessions();
+    if (currentSession_) {
+        disconnect(currentSession_.get(), nullptr, this, nullptr);
+    }
+    currentSession_ = sessions_.createSession();
+
+    // 传输通过剪贴板发布：Windows上是虚拟文件，其他平台是按需渲染的QMimeData
+    currentSession_->setStreamSink(&clipboardSink_);
+
+    // 连接信号
+    connect(currentSession_.get(), &FileBufferManager::transferProgress,
+            this, &MainWindow::onTransferProgress);
+    connect(currentSession_.get(), &FileBufferManager::transferFinished,
+            this, &MainWindow::onTransferFinished);
+
     // 开始传输
-    FileBufferManager::instance()->startTransfer(selectedFilePath_, fileName, fileSizeBytes);
+    currentSession_->startTransfer(files);
 }
 
 void MainWindow::onCancelTransfer()
 {
     if (transferInProgress_) {
-        FileBufferManager::instance()->stopTransfer();
+        // 取消按钮属于当前会话，之前开始、仍被剪贴板引用的其他传输不受影响
+        if (currentSession_) {
+            disconnect(currentSession_.get(), nullptr, this, nullptr);
+            sessions_.closeSession(currentSession_);
+            currentSession_.reset();
+        }
         resetUI();
         statusLabel_->setText(tr("has candel!"));
     }
 }
 
-void MainWindow::onTransferProgress(qint64 bytesTransferred, qint64 totalBytes)
+void MainWindow::onTransferProgress(qint64 bytesTransferred, qint64 totalBytes, qint64 bytesPerSecond, qint64 etaMs)
 {
     // 计算进度百分比
     int progress = totalBytes > 0 ? static_cast<int>((bytesTransferred * 100) / totalBytes) : 0;
@@ -166,10 +180,12 @@ void MainWindow::onTransferProgress(qint64 bytesTransferred, qint64 totalBytes)
     // 更新状态文本
     QString transferredStr = formatFileSize(bytesTransferred);
     QString totalStr = formatFileSize(totalBytes);
-    statusLabel_->setText(QString("transf: %1 / %2 (%3%)")
+    statusLabel_->setText(QString("transf: %1 / %2 (%3%), %4/s, eta %5")
                          .arg(transferredStr)
                          .arg(totalStr)
-                         .arg(progress));
+                         .arg(progress)
+                         .arg(formatFileSize(bytesPerSecond))
+                         .arg(etaMs < 0 ? QString("--") : formatDuration(etaMs)));
 }
 
 void MainWindow::onTransferFinished()
@@ -180,19 +196,31 @@ void MainWindow::onTransferFinished()
 
 void MainWindow::onSelectFile()
 {
-    QString fileName = QFileDialog::getOpenFileName(this, "select file", "", "all (*.*)");
-    if (!fileName.isEmpty()) {
-        QFileInfo fileInfo(fileName);
-        filePathEdit_->setText(fileInfo.fileName());
+    QStringList fileNames = QFileDialog::getOpenFileNames(this, "select file", "", "all (*.*)");
+    if (!fileNames.isEmpty()) {
+        setSelectedFiles(fileNames);
+    }
+}
 
-        // 更新文件大小显示
-        qint64 fileSizeBytes = fileInfo.size();
-        QString sizeStr = formatFileSize(fileSizeBytes);
-        fileSizeDisplayLabel_->setText(tr("file size: %1").arg(sizeStr));
+void MainWindow::setSelectedFiles(const QStringList& filePaths)
+{
+    qint64 fileSizeBytes = 0;
+    for (const QString& filePath : filePaths) {
+        fileSizeBytes += QFileInfo(filePath).size();
+    }
 
-        // 存储完整路径以备后用
-        selectedFilePath_ = fileName;
+    if (filePaths.size() == 1) {
+        filePathEdit_->setText(QFileInfo(filePaths.first()).fileName());
+    } else {
+        filePathEdit_->setText(tr("%1 files").arg(filePaths.size()));
     }
+
+    // 更新文件大小显示
+    QString sizeStr = formatFileSize(fileSizeBytes);
+    fileSizeDisplayLabel_->setText(tr("file size: %1").arg(sizeStr));
+
+    // 存储完整路径以备后用
+    selectedFilePaths_ = filePaths;
 }
 
 void MainWindow::resetUI()
@@ -221,4 +249,15 @@ QString MainWindow::formatFileSize(qint64 bytes) const
     }
 }
 
+QString MainWindow::formatDuration(qint64 ms) const
+{
+    const qint64 seconds = (ms + 999) / 1000;
+    if (seconds >= 3600) {
+        return QString("%1:%2:%3").arg(seconds / 3600)
+            .arg(seconds / 60 % 60, 2, 10, QChar('0'))
+            .arg(seconds % 60, 2, 10, QChar('0'));
+    }
+    return QString("%1:%2").arg(seconds / 60).arg(seconds % 60, 2, 10, QChar('0'));
+}
+
 }
@@ -15,15 +15,19 @@
 #include <QFileDialog>
 #include <QMessageBox>
 #include <QTimer>
+#include "FileBufferManager.h"
+#include "TransferSessionManager.h"
+#ifdef Q_OS_WIN
 #include <Windows.h>
 #include <shlobj.h>
-#include "FileBufferManager.h"
 #include "VirtualFileSrcStream.h"
+#include "ClipboardSink.h"
+#else
+#include "MimeDataSink.h"
+#endif
 
 namespace clipboard {
 
-class VirtualFileSrcStream;
-
 class MainWindow : public QMainWindow
 {
     Q_OBJECT
@@ -35,7 +39,7 @@ public:
 private slots:
     void onStartTransfer();
     void onCancelTransfer();
-    void onTransferProgress(qint64 bytesTransferred, qint64 totalBytes);
+    void onTransferProgress(qint64 bytesTransferred, qint64 totalBytes, qint64 bytesPerSecond, qint64 etaMs);
     void onTransferFinished();
     void onSelectFile();
 
@@ -43,6 +47,9 @@ private:
     void setupUI();
     void resetUI();
     QString formatFileSize(qint64 bytes) const;
+    QString formatDuration(qint64 ms) const;
+    // 记录选择的文件并更新文件名和大小显示
+    void setSelectedFiles(const QStringList& filePaths);
 
     // UI组件
     QWidget *centralWidget_;
@@ -70,9 +77,21 @@ private:
     QProgressBar *progressBar_;
     QLabel *statusLabel_;
 
+    // 剪贴板呈现端，须在FileBufferManager销毁之后析构
+#ifdef Q_OS_WIN
+    ClipboardSink clipboardSink_;
+#else
+    MimeDataSink clipboardSink_;
+#endif
+
+    // 传输会话，声明在clipboardSink_之后以保证先于它析构
+    TransferSessionManager sessions_;
+    // 进度显示所跟随的会话（最近一次开始的传输）
+    std::shared_ptr<FileBufferManager> currentSession_;
+
     // 状态变量
     bool transferInProgress_;
-    QString selectedFilePath_; // 存储选择的文件完整路径
+    QStringList selectedFilePaths_; // 存储选择的文件完整路径，顺序即剪贴板中的lindex
 };
 
 }
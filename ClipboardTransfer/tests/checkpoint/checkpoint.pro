@@ -0,0 +1,22 @@
+# 断点续传：取消后按检查点校验部分文件，续传只读取断点之后的源数据，拼接出的文件与源文件一致
+QT = core network testlib
+CONFIG += c++17 console testcase
+CONFIG -= app_bundle
+
+TARGET = tst_checkpoint
+TEMPLATE = app
+
+CODECFORTR = UTF-8
+CODECFORSRC = UTF-8
+
+SOURCES += tst_checkpoint.cpp
+
+INCLUDEPATH += $$PWD/../..
+DEPENDPATH += $$PWD/../..
+LIBS += -L$$PWD/../../lib -lTransferCore
+
+win32 {
+    PRE_TARGETDEPS += $$PWD/../../lib/TransferCore.lib
+} else {
+    PRE_TARGETDEPS += $$PWD/../../lib/libTransferCore.a
+}
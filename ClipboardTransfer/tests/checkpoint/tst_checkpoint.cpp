@@ -0,0 +1,129 @@
+#include "Crc32c.h"
+#include "TransferSessionManager.h"
+#include <QFile>
+#include <QRandomGenerator>
+#include <QTemporaryDir>
+#include <QTemporaryFile>
+#include <QtTest>
+#include <vector>
+
+using namespace clipboard;
+
+// 读到一半取消传输，接收方把读到的数据写入部分文件；resumeFile按检查点校验部分文件后，
+// 续传只从源文件读取断点之后的字节，拼接出的文件与源文件一致。检查点的CRC由校验线程计算，
+// 分别在只开检查点和同时开端到端校验时测试
+class CheckpointTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void resumeAfterInterrupt_data();
+    void resumeAfterInterrupt();
+
+private:
+    TransferFile sourceFile() const;
+    // 读取[from, to)并追加写入partial
+    static bool copyRange(FileBufferManager& session, QFile& partial, qint64 from, qint64 to);
+
+    static const qint64 FILE_SIZE = 16 * 1024 * 1024;
+    static const qint64 INTERRUPT_SIZE = 6 * 1024 * 1024;
+    static const qint64 READ_SIZE = 64 * 1024;
+
+    QTemporaryFile source_;
+    quint32 sourceCrc_ = 0;
+};
+
+void CheckpointTest::initTestCase()
+{
+    QVERIFY(source_.open());
+    std::vector<quint32> block(256 * 1024);
+    for (qint64 written = 0; written < FILE_SIZE; written += block.size() * sizeof(quint32)) {
+        QRandomGenerator::global()->fillRange(block.data(), static_cast<qsizetype>(block.size()));
+        const char* bytes = reinterpret_cast<const char*>(block.data());
+        const qint64 size = static_cast<qint64>(block.size() * sizeof(quint32));
+        QCOMPARE(source_.write(bytes, size), size);
+        sourceCrc_ = Crc32c::combine(sourceCrc_, Crc32c::compute(bytes, size), size);
+    }
+    QVERIFY(source_.flush());
+}
+
+TransferFile CheckpointTest::sourceFile() const
+{
+    TransferFile file;
+    file.filePath = source_.fileName();
+    file.fileName = QStringLiteral("source.bin");
+    file.fileSize = FILE_SIZE;
+    return file;
+}
+
+bool CheckpointTest::copyRange(FileBufferManager& session, QFile& partial, qint64 from, qint64 to)
+{
+    std::vector<char> buffer(READ_SIZE);
+    for (qint64 offset = from; offset < to; ) {
+        const qint64 bytesRead = session.readData(0, offset, buffer.data(), qMin(READ_SIZE, to - offset));
+        if (bytesRead <= 0 || partial.write(buffer.data(), bytesRead) != bytesRead) {
+            return false;
+        }
+        offset += bytesRead;
+    }
+    return true;
+}
+
+void CheckpointTest::resumeAfterInterrupt_data()
+{
+    QTest::addColumn<bool>("checksums");
+    QTest::newRow("checkpoints") << false;
+    QTest::newRow("checkpoints and checksums") << true;
+}
+
+void CheckpointTest::resumeAfterInterrupt()
+{
+    QFETCH(bool, checksums);
+    QTemporaryDir checkpoints;
+    QTemporaryDir receiver;
+    QVERIFY(checkpoints.isValid());
+    QVERIFY(receiver.isValid());
+
+    TransferSessionManager sessions;
+    std::shared_ptr<FileBufferManager> session = sessions.createSession();
+    session->setCheckpoints(true, checkpoints.path());
+    session->setChecksums(checksums);
+    const TransferFile file = sourceFile();
+
+    // 读到INTERRUPT_SIZE时取消
+    QFile partial(receiver.filePath(QStringLiteral("partial.bin")));
+    QVERIFY(partial.open(QIODevice::ReadWrite | QIODevice::Truncate));
+    session->startTransfer(TransferFileList() << file);
+    QVERIFY(copyRange(*session, partial, 0, INTERRUPT_SIZE));
+    session->stopTransfer();
+    QVERIFY(session->statistics().checkpoint.writtenBytes >= INTERRUPT_SIZE);
+
+    // 校验部分文件，截断到校验通过的前缀后续传
+    QVERIFY(partial.flush());
+    const qint64 resumed = session->resumeFile(file, partial);
+    QVERIFY2(resumed > 0 && resumed <= INTERRUPT_SIZE, qPrintable(QString::number(resumed)));
+    QVERIFY(partial.resize(resumed));
+    QVERIFY(partial.seek(resumed));
+
+    session->startTransfer(TransferFileList() << file);
+    QVERIFY(copyRange(*session, partial, resumed, FILE_SIZE));
+    const qint64 sourceBytes = session->metrics().bytes(TransferMetrics::SourceRead);
+    const TransferStatistics stats = session->statistics();
+    sessions.closeSession(session);
+
+    QCOMPARE(stats.checkpoint.resumedBytes, resumed);
+    QCOMPARE(sourceBytes, FILE_SIZE - resumed);
+    if (checksums) {
+        QCOMPARE(stats.verification.chunkMismatches, (qint64)0);
+    }
+
+    QVERIFY(partial.seek(0));
+    const QByteArray received = partial.readAll();
+    QCOMPARE(static_cast<qint64>(received.size()), FILE_SIZE);
+    QCOMPARE(Crc32c::compute(received.constData(), received.size()), sourceCrc_);
+}
+
+QTEST_GUILESS_MAIN(CheckpointTest)
+
+#include "tst_checkpoint.moc"
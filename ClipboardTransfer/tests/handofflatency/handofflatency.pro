@@ -0,0 +1,22 @@
+# 交接延迟：读取方阻塞在readData时，数据块入队后readData及时返回
+QT = core network testlib
+CONFIG += c++17 console testcase
+CONFIG -= app_bundle
+
+TARGET = tst_handofflatency
+TEMPLATE = app
+
+CODECFORTR = UTF-8
+CODECFORSRC = UTF-8
+
+SOURCES += tst_handofflatency.cpp
+
+INCLUDEPATH += $$PWD/../..
+DEPENDPATH += $$PWD/../..
+LIBS += -L$$PWD/../../lib -lTransferCore
+
+win32 {
+    PRE_TARGETDEPS += $$PWD/../../lib/TransferCore.lib
+} else {
+    PRE_TARGETDEPS += $$PWD/../../lib/libTransferCore.a
+}
@@ -0,0 +1,81 @@
+#include "Crc32c.h"
+#include "TransferSessionManager.h"
+#include <QRandomGenerator>
+#include <QTemporaryFile>
+#include <QtTest>
+#include <vector>
+
+using namespace clipboard;
+
+// 生产者按令牌桶限速，每个数据块都在读取方阻塞于readData时入队：
+// 从入队到readData返回的延迟应在微秒级，退回轮询（每次等待最多20ms）时测试失败
+class HandoffLatencyTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void wakeupOnEnqueue();
+
+private:
+    static const qint64 FILE_SIZE = 4 * 1024 * 1024;
+    static const qint64 CHUNK_SIZE = AdaptiveChunkSizer::DEFAULT_CHUNK_SIZE;
+    // 每秒10个数据块，读取方在两个数据块之间读完缓存并进入等待
+    static const qint64 PACED_RATE = 10 * CHUNK_SIZE;
+    static const qint64 READ_SIZE = 64 * 1024;
+    // 轮询间隔为20ms，中位数超过该值的四分之一即视为退化
+    static const qint64 WAKEUP_BOUND_NS = 5 * 1000 * 1000;
+
+    QTemporaryFile source_;
+    quint32 sourceCrc_ = 0;
+};
+
+void HandoffLatencyTest::initTestCase()
+{
+    QVERIFY(source_.open());
+    std::vector<quint32> block(256 * 1024);
+    for (qint64 written = 0; written < FILE_SIZE; written += block.size() * sizeof(quint32)) {
+        QRandomGenerator::global()->fillRange(block.data(), static_cast<qsizetype>(block.size()));
+        const char* bytes = reinterpret_cast<const char*>(block.data());
+        const qint64 size = static_cast<qint64>(block.size() * sizeof(quint32));
+        QCOMPARE(source_.write(bytes, size), size);
+        sourceCrc_ = Crc32c::combine(sourceCrc_, Crc32c::compute(bytes, size), size);
+    }
+    QVERIFY(source_.flush());
+}
+
+void HandoffLatencyTest::wakeupOnEnqueue()
+{
+    TransferSessionManager sessions;
+    std::shared_ptr<FileBufferManager> session = sessions.createSession();
+    session->setPacingPolicy(PacingPolicy::tokenBucket(PACED_RATE, CHUNK_SIZE));
+
+    TransferFile file;
+    file.filePath = source_.fileName();
+    file.fileName = QStringLiteral("source.bin");
+    file.fileSize = FILE_SIZE;
+    session->startTransfer(TransferFileList() << file);
+
+    std::vector<char> buffer(READ_SIZE);
+    quint32 crc = 0;
+    qint64 offset = 0;
+    while (offset < FILE_SIZE) {
+        const qint64 bytesRead = session->readData(0, offset, buffer.data(), READ_SIZE);
+        QVERIFY2(bytesRead > 0, qPrintable(QString("read stopped at %1").arg(offset)));
+        crc = Crc32c::combine(crc, Crc32c::compute(buffer.data(), bytesRead), bytesRead);
+        offset += bytesRead;
+    }
+
+    const LatencyHistogram::Snapshot handoff = session->metrics().histogram(TransferMetrics::EnqueueToReturn);
+    sessions.closeSession(session);
+
+    QCOMPARE(crc, sourceCrc_);
+    QVERIFY(handoff.count > 0);
+    QVERIFY2(handoff.percentile(0.50) < WAKEUP_BOUND_NS,
+             qPrintable(QString("median handoff %1 us, max %2 us")
+                        .arg(handoff.percentile(0.50) / 1000).arg(handoff.maxNs / 1000)));
+}
+
+QTEST_GUILESS_MAIN(HandoffLatencyTest)
+
+#include "tst_handofflatency.moc"
@@ -0,0 +1,24 @@
+# 通过offscreen平台插件的剪贴板测试LazyMimeData的按需渲染，不需要显示环境
+QT = core gui network testlib
+CONFIG += c++17 console testcase
+CONFIG -= app_bundle
+
+TARGET = tst_lazymimedata
+TEMPLATE = app
+
+CODECFORTR = UTF-8
+CODECFORSRC = UTF-8
+
+SOURCES += tst_lazymimedata.cpp
+
+include(../../MimeData.pri)
+
+INCLUDEPATH += $$PWD/../..
+DEPENDPATH += $$PWD/../..
+LIBS += -L$$PWD/../../lib -lTransferCore
+
+win32 {
+    PRE_TARGETDEPS += $$PWD/../../lib/TransferCore.lib
+} else {
+    PRE_TARGETDEPS += $$PWD/../../lib/libTransferCore.a
+}
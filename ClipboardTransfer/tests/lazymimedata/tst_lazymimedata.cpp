@@ -0,0 +1,265 @@
+#include "Crc32c.h"
+#include "LazyMimeData.h"
+#include "TransferSessionManager.h"
+#include <QClipboard>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QGuiApplication>
+#include <QRandomGenerator>
+#include <QTemporaryDir>
+#include <QTemporaryFile>
+#include <QTimer>
+#include <QtTest>
+#include <vector>
+
+using namespace clipboard;
+
+// 经过QGuiApplication的剪贴板走一遍按需渲染：发布时不读取，粘贴时在渲染线程中读取且GUI事件循环不停，
+// 传输停止或长时间没有进展时粘贴明确失败且不留下部分文件；没有打开暂存时不提供text/uri-list，
+// 超过内联上限的大文件只能经过暂存目录粘贴
+class LazyMimeDataTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanup();
+    void publishDoesNotRead();
+    void pasteRendersOffGuiThread();
+    void stalledRenderFails();
+    void stoppedTransferFails();
+    void stagingIsOptIn();
+    void largeFileStaging();
+
+private:
+    TransferFileList sourceFiles() const;
+    // 打开暂存后发布到剪贴板再取回，与粘贴方看到的是同一个对象
+    const QMimeData* publish(LazyMimeData* mimeData, bool staging = true);
+    static bool isEmptyDirectory(const QString& path);
+    static bool fileChecksum(const QString& path, quint32& checksum);
+
+    static const qint64 FILE_SIZE = 8 * 1024 * 1024;
+    // 超过LazyMimeData::MAX_INLINE_CONTENT_SIZE，只能经过暂存目录粘贴
+    static const qint64 LARGE_FILE_SIZE = 1024 * 1024 * 1024;
+
+    QTemporaryFile source_;
+    quint32 sourceCrc_ = 0;
+};
+
+void LazyMimeDataTest::initTestCase()
+{
+    QVERIFY(QGuiApplication::clipboard());
+    QVERIFY(source_.open());
+    std::vector<quint32> block(256 * 1024);
+    for (qint64 written = 0; written < FILE_SIZE; written += block.size() * sizeof(quint32)) {
+        QRandomGenerator::global()->fillRange(block.data(), static_cast<qsizetype>(block.size()));
+        const char* bytes = reinterpret_cast<const char*>(block.data());
+        const qint64 size = static_cast<qint64>(block.size() * sizeof(quint32));
+        QCOMPARE(source_.write(bytes, size), size);
+        sourceCrc_ = Crc32c::combine(sourceCrc_, Crc32c::compute(bytes, size), size);
+    }
+    QVERIFY(source_.flush());
+}
+
+void LazyMimeDataTest::cleanup()
+{
+    // 释放剪贴板持有的LazyMimeData和它持有的会话
+    QGuiApplication::clipboard()->clear();
+}
+
+TransferFileList LazyMimeDataTest::sourceFiles() const
+{
+    TransferFile file;
+    file.filePath = source_.fileName();
+    file.fileName = QStringLiteral("source.bin");
+    file.fileSize = FILE_SIZE;
+    return TransferFileList() << file;
+}
+
+const QMimeData* LazyMimeDataTest::publish(LazyMimeData* mimeData, bool staging)
+{
+    mimeData->setStagingEnabled(staging);
+    QGuiApplication::clipboard()->setMimeData(mimeData);
+    return QGuiApplication::clipboard()->mimeData();
+}
+
+bool LazyMimeDataTest::isEmptyDirectory(const QString& path)
+{
+    return QDir(path).entryList(QDir::AllEntries | QDir::NoDotAndDotDot | QDir::Hidden).isEmpty();
+}
+
+bool LazyMimeDataTest::fileChecksum(const QString& path, quint32& checksum)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    checksum = 0;
+    while (!file.atEnd()) {
+        const QByteArray block = file.read(4 * 1024 * 1024);
+        if (block.isEmpty()) {
+            return false;
+        }
+        checksum = Crc32c::combine(checksum, Crc32c::compute(block.constData(), block.size()), block.size());
+    }
+    return true;
+}
+
+void LazyMimeDataTest::publishDoesNotRead()
+{
+    TransferSessionManager sessions;
+    std::shared_ptr<FileBufferManager> session = sessions.createSession();
+    session->startTransfer(sourceFiles());
+    QTemporaryDir staging;
+    QVERIFY(staging.isValid());
+
+    const QMimeData* mimeData = publish(new LazyMimeData(session, sourceFiles(), staging.path()));
+    QVERIFY(mimeData);
+    QVERIFY(mimeData->hasFormat(QStringLiteral("text/uri-list")));
+    QTest::qWait(100);
+
+    QCOMPARE(session->statistics().bytesRead, (qint64)0);
+    QVERIFY(isEmptyDirectory(staging.path()));
+}
+
+void LazyMimeDataTest::pasteRendersOffGuiThread()
+{
+    TransferSessionManager sessions;
+    std::shared_ptr<FileBufferManager> session = sessions.createSession();
+    // 限速使渲染持续约半秒
+    session->setPacingPolicy(PacingPolicy::tokenBucket(16 * 1024 * 1024, 1024 * 1024));
+    session->startTransfer(sourceFiles());
+    QTemporaryDir staging;
+    QVERIFY(staging.isValid());
+    const QMimeData* mimeData = publish(new LazyMimeData(session, sourceFiles(), staging.path()));
+    QVERIFY(mimeData);
+
+    // 渲染期间GUI线程的定时器照常触发
+    int ticks = 0;
+    QTimer timer;
+    connect(&timer, &QTimer::timeout, [&ticks]() { ++ticks; });
+    timer.start(10);
+    const QByteArray uriList = mimeData->data(QStringLiteral("text/uri-list"));
+    timer.stop();
+    QVERIFY(ticks > 0);
+
+    const QList<QByteArray> lines = uriList.split('\n');
+    QVERIFY(!lines.isEmpty());
+    QFile staged(QUrl::fromEncoded(lines.first().trimmed()).toLocalFile());
+    QVERIFY2(staged.open(QIODevice::ReadOnly), qPrintable(staged.fileName()));
+    QCOMPARE(staged.size(), FILE_SIZE);
+    const QByteArray content = staged.readAll();
+    QCOMPARE(Crc32c::compute(content.constData(), content.size()), sourceCrc_);
+}
+
+void LazyMimeDataTest::stalledRenderFails()
+{
+    TransferSessionManager sessions;
+    std::shared_ptr<FileBufferManager> session = sessions.createSession();
+    // 每个数据块之前等待2秒，渲染超时之前读不到任何数据
+    session->setPacingPolicy(PacingPolicy::simulatedNetwork(64 * 1024 * 1024, 2000));
+    session->startTransfer(sourceFiles());
+    QTemporaryDir staging;
+    QVERIFY(staging.isValid());
+    LazyMimeData* lazy = new LazyMimeData(session, sourceFiles(), staging.path());
+    lazy->setRenderTimeout(200);
+    const QMimeData* mimeData = publish(lazy);
+    QVERIFY(mimeData);
+
+    QElapsedTimer timer;
+    timer.start();
+    const QByteArray uriList = mimeData->data(QStringLiteral("text/uri-list"));
+    QVERIFY(uriList.isEmpty());
+    QVERIFY2(timer.elapsed() < 1500, qPrintable(QString::number(timer.elapsed())));
+    QVERIFY(isEmptyDirectory(staging.path()));
+}
+
+void LazyMimeDataTest::stoppedTransferFails()
+{
+    TransferSessionManager sessions;
+    std::shared_ptr<FileBufferManager> session = sessions.createSession();
+    session->setPacingPolicy(PacingPolicy::tokenBucket(1024 * 1024, 64 * 1024));
+    session->startTransfer(sourceFiles());
+    QTemporaryDir staging;
+    QVERIFY(staging.isValid());
+    const QMimeData* mimeData = publish(new LazyMimeData(session, sourceFiles(), staging.path()));
+    QVERIFY(mimeData);
+
+    QTimer::singleShot(100, [session]() { session->stopTransfer(); });
+    const QByteArray uriList = mimeData->data(QStringLiteral("text/uri-list"));
+    QVERIFY(uriList.isEmpty());
+    QVERIFY(isEmptyDirectory(staging.path()));
+}
+
+void LazyMimeDataTest::stagingIsOptIn()
+{
+    TransferSessionManager sessions;
+    std::shared_ptr<FileBufferManager> session = sessions.createSession();
+    session->startTransfer(sourceFiles());
+    QTemporaryDir staging;
+    QVERIFY(staging.isValid());
+
+    const QMimeData* mimeData = publish(new LazyMimeData(session, sourceFiles(), staging.path()), false);
+    QVERIFY(mimeData);
+    QVERIFY(!mimeData->hasFormat(QStringLiteral("text/uri-list")));
+    QVERIFY(mimeData->data(QStringLiteral("text/uri-list")).isEmpty());
+    QCOMPARE(session->statistics().bytesRead, (qint64)0);
+    QVERIFY(isEmptyDirectory(staging.path()));
+}
+
+void LazyMimeDataTest::largeFileStaging()
+{
+    // 稀疏文件，不占用源文件所在磁盘的空间
+    QTemporaryFile large;
+    QVERIFY(large.open());
+    QVERIFY(large.resize(LARGE_FILE_SIZE));
+    quint32 sourceCrc = 0;
+    QVERIFY(fileChecksum(large.fileName(), sourceCrc));
+
+    TransferFile file;
+    file.filePath = large.fileName();
+    file.fileName = QStringLiteral("large.bin");
+    file.fileSize = LARGE_FILE_SIZE;
+    const TransferFileList files = TransferFileList() << file;
+
+    TransferSessionManager sessions;
+    std::shared_ptr<FileBufferManager> session = sessions.createSession();
+    session->startTransfer(files);
+    QTemporaryDir staging;
+    QVERIFY(staging.isValid());
+    const QMimeData* mimeData = publish(new LazyMimeData(session, files, staging.path()));
+    QVERIFY(mimeData);
+    // 超过内联上限，不提供文件的MIME类型
+    QCOMPARE(mimeData->formats().size(), 2);
+
+    int ticks = 0;
+    QTimer timer;
+    connect(&timer, &QTimer::timeout, [&ticks]() { ++ticks; });
+    timer.start(10);
+    const QByteArray uriList = mimeData->data(QStringLiteral("text/uri-list"));
+    timer.stop();
+    QVERIFY(ticks > 0);
+
+    const QList<QByteArray> lines = uriList.split('\n');
+    QVERIFY(!lines.isEmpty());
+    const QString stagedPath = QUrl::fromEncoded(lines.first().trimmed()).toLocalFile();
+    QCOMPARE(QFileInfo(stagedPath).size(), LARGE_FILE_SIZE);
+    quint32 stagedCrc = 0;
+    QVERIFY(fileChecksum(stagedPath, stagedCrc));
+    QCOMPARE(stagedCrc, sourceCrc);
+    QCOMPARE(session->statistics().bytesRead, LARGE_FILE_SIZE);
+}
+
+int main(int argc, char* argv[])
+{
+    // 没有显示环境时使用offscreen平台插件，剪贴板在进程内实现
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QGuiApplication app(argc, argv);
+    LazyMimeDataTest test;
+    return QTest::qExec(&test, argc, argv);
+}
+
+#include "tst_lazymimedata.moc"
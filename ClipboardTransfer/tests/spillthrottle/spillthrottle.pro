@@ -0,0 +1,22 @@
+# 读取方慢于生产者时缓冲内存不超过高水位
+QT = core network testlib
+CONFIG += c++17 console testcase
+CONFIG -= app_bundle
+
+TARGET = tst_spillthrottle
+TEMPLATE = app
+
+CODECFORTR = UTF-8
+CODECFORSRC = UTF-8
+
+SOURCES += tst_spillthrottle.cpp
+
+INCLUDEPATH += $$PWD/../..
+DEPENDPATH += $$PWD/../..
+LIBS += -L$$PWD/../../lib -lTransferCore
+
+win32 {
+    PRE_TARGETDEPS += $$PWD/../../lib/TransferCore.lib
+} else {
+    PRE_TARGETDEPS += $$PWD/../../lib/libTransferCore.a
+}
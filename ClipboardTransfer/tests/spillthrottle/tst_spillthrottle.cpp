@@ -0,0 +1,116 @@
+#include "Crc32c.h"
+#include "TransferSessionManager.h"
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QTemporaryDir>
+#include <QTemporaryFile>
+#include <QThread>
+#include <QtTest>
+#include <vector>
+
+using namespace clipboard;
+
+// 读取方按固定速率读取，远慢于生产者：打开溢出层时生产者不被拖慢，
+// 关闭时生产者受背压限制，两种情况下缓冲在内存中的字节数都不超过高水位加一个数据块；
+// 小于文件缓冲区的数据块也能从溢出文件完整读回，不需要从源文件补读
+class SpillThrottleTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void boundedMemory_data();
+    void boundedMemory();
+
+private:
+    static const qint64 FILE_SIZE = 32 * 1024 * 1024;
+    static const qint64 HIGH_WATERMARK = 4 * 1024 * 1024;
+    static const qint64 LOW_WATERMARK = 2 * 1024 * 1024;
+    static const qint64 CONSUMER_RATE = 32 * 1024 * 1024;
+    static const qint64 READ_SIZE = 64 * 1024;
+    static const qint64 SMALL_CHUNK_SIZE = 4 * 1024;
+
+    QTemporaryFile source_;
+    quint32 sourceCrc_ = 0;
+};
+
+void SpillThrottleTest::initTestCase()
+{
+    QVERIFY(source_.open());
+    std::vector<quint32> block(256 * 1024);
+    for (qint64 written = 0; written < FILE_SIZE; written += block.size() * sizeof(quint32)) {
+        QRandomGenerator::global()->fillRange(block.data(), static_cast<qsizetype>(block.size()));
+        const char* bytes = reinterpret_cast<const char*>(block.data());
+        const qint64 size = static_cast<qint64>(block.size() * sizeof(quint32));
+        QCOMPARE(source_.write(bytes, size), size);
+        sourceCrc_ = Crc32c::combine(sourceCrc_, Crc32c::compute(bytes, size), size);
+    }
+    QVERIFY(source_.flush());
+}
+
+void SpillThrottleTest::boundedMemory_data()
+{
+    QTest::addColumn<bool>("spill");
+    QTest::addColumn<qint64>("chunkSize");
+    QTest::newRow("spill") << true << (qint64)0;
+    QTest::newRow("spill small chunks") << true << SMALL_CHUNK_SIZE;
+    QTest::newRow("backpressure") << false << (qint64)0;
+}
+
+void SpillThrottleTest::boundedMemory()
+{
+    QFETCH(bool, spill);
+    QFETCH(qint64, chunkSize);
+    QTemporaryDir spillDir;
+    QVERIFY(spillDir.isValid());
+
+    TransferSessionManager sessions;
+    std::shared_ptr<FileBufferManager> session = sessions.createSession();
+    session->setFlowControl(HIGH_WATERMARK, LOW_WATERMARK);
+    session->setSpill(spill, spillDir.path());
+    if (chunkSize > 0) {
+        session->setAdaptiveChunkSize(true, chunkSize, chunkSize);
+    }
+
+    TransferFile file;
+    file.filePath = source_.fileName();
+    file.fileName = QStringLiteral("source.bin");
+    file.fileSize = FILE_SIZE;
+    session->startTransfer(TransferFileList() << file);
+
+    // 按CONSUMER_RATE读取，模拟写入较慢的粘贴目标
+    std::vector<char> buffer(READ_SIZE);
+    quint32 crc = 0;
+    qint64 offset = 0;
+    QElapsedTimer timer;
+    timer.start();
+    while (offset < FILE_SIZE) {
+        const qint64 bytesRead = session->readData(0, offset, buffer.data(), READ_SIZE);
+        QVERIFY2(bytesRead > 0, qPrintable(QString("read stopped at %1").arg(offset)));
+        crc = Crc32c::combine(crc, Crc32c::compute(buffer.data(), bytesRead), bytesRead);
+        offset += bytesRead;
+
+        const qint64 aheadNs = offset * 1000000000LL / CONSUMER_RATE - timer.nsecsElapsed();
+        if (aheadNs > 0) {
+            QThread::usleep(static_cast<unsigned long>(aheadNs / 1000));
+        }
+    }
+
+    const TransferStatistics stats = session->statistics();
+    sessions.closeSession(session);
+
+    QCOMPARE(crc, sourceCrc_);
+    QVERIFY2(stats.peakBufferedBytes <= HIGH_WATERMARK + AdaptiveChunkSizer::DEFAULT_CHUNK_SIZE,
+             qPrintable(QString("peak buffered %1 bytes").arg(stats.peakBufferedBytes)));
+    if (spill) {
+        QVERIFY(stats.spill.spilledBytes > 0);
+        // 读回失败的区间会从源文件补读
+        QCOMPARE(stats.refillRequests, (qint64)0);
+    } else {
+        QCOMPARE(stats.spill.spilledBytes, (qint64)0);
+    }
+}
+
+QTEST_GUILESS_MAIN(SpillThrottleTest)
+
+#include "tst_spillthrottle.moc"
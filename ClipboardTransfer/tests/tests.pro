@@ -0,0 +1,4 @@
+# 传输核心的单元测试，每个子目录一个QtTest程序，make check运行全部测试
+TEMPLATE = subdirs
+
+SUBDIRS = spillthrottle lazymimedata verification transfersessions handofflatency checkpoint
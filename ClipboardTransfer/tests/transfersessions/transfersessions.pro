@@ -0,0 +1,22 @@
+# 会话多于I/O线程时每个会话都能推进，等待背压的生产者不占用线程
+QT = core network testlib
+CONFIG += c++17 console testcase
+CONFIG -= app_bundle
+
+TARGET = tst_transfersessions
+TEMPLATE = app
+
+CODECFORTR = UTF-8
+CODECFORSRC = UTF-8
+
+SOURCES += tst_transfersessions.cpp
+
+INCLUDEPATH += $$PWD/../..
+DEPENDPATH += $$PWD/../..
+LIBS += -L$$PWD/../../lib -lTransferCore
+
+win32 {
+    PRE_TARGETDEPS += $$PWD/../../lib/TransferCore.lib
+} else {
+    PRE_TARGETDEPS += $$PWD/../../lib/libTransferCore.a
+}
@@ -0,0 +1,308 @@
+#include "Crc32c.h"
+#include "FileBufferManager.h"
+#include "TransferSessionManager.h"
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QRunnable>
+#include <QSemaphore>
+#include <QTemporaryFile>
+#include <QThreadPool>
+#include <QtTest>
+#include <atomic>
+#include <vector>
+
+using namespace clipboard;
+
+namespace {
+
+// 占用线程池的一个线程，直到semaphore被释放
+class BlockingTask : public QRunnable
+{
+public:
+    explicit BlockingTask(QSemaphore& semaphore)
+        : semaphore_(semaphore)
+    {
+    }
+
+    void run() override {
+        semaphore_.acquire();
+    }
+
+private:
+    QSemaphore& semaphore_;
+};
+
+// 在线程池的一个线程中读完一个会话的所有文件，记录从开始读取到读完的时间，在startTransfer之后提交
+class ReadTask : public QRunnable
+{
+public:
+    ReadTask(FileBufferManager& session, const TransferFileList& files, qint64 readSize)
+        : session_(session)
+        , files_(files)
+        , readSize_(readSize)
+        , completionMs_(-1)
+    {
+        setAutoDelete(false);
+    }
+
+    void run() override {
+        clock_.start();
+        std::vector<char> buffer(static_cast<size_t>(readSize_));
+        for (int index = 0; index < files_.size(); ++index) {
+            quint32 crc = 0;
+            for (qint64 offset = 0; offset < files_.at(index).fileSize; ) {
+                const qint64 bytesRead = session_.readData(index, offset, buffer.data(), readSize_);
+                if (bytesRead <= 0) {
+                    return;
+                }
+                crc = Crc32c::combine(crc, Crc32c::compute(buffer.data(), bytesRead), bytesRead);
+                offset += bytesRead;
+            }
+            crcs_.push_back(crc);
+        }
+        completionMs_ = clock_.elapsed();
+    }
+
+    // 没有读完时为-1
+    qint64 completionMs() const { return completionMs_; }
+    const std::vector<quint32>& crcs() const { return crcs_; }
+
+private:
+    FileBufferManager& session_;
+    TransferFileList files_;
+    qint64 readSize_;
+    QElapsedTimer clock_;
+    std::atomic<qint64> completionMs_;
+    std::vector<quint32> crcs_;
+};
+
+} // namespace
+
+// 会话数多于共用线程池的线程数：缓冲区已满的生产者让出线程，其余会话照常生产；
+// 之后轮流读取所有会话，数据完整，停止等待背压的会话不需要空闲线程；
+// 会话管理器的线程池不随会话数增长；线程被占满时排队的生产任务按调度策略运行，
+// 剩余最少优先和加权公平下后开始的小传输先于正在读取的大传输完成
+class TransferSessionsTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void moreSessionsThanThreads();
+    void stopParkedSession();
+    void managerPoolStaysBounded();
+    void smallTransferFinishesFirst_data();
+    void smallTransferFinishesFirst();
+
+private:
+    TransferFileList sourceFiles() const;
+    // 创建共用pool的会话并开始传输
+    std::vector<std::shared_ptr<FileBufferManager>> startSessions(QThreadPool& pool, int count);
+    void startTransfer(FileBufferManager& session) const;
+    static bool allBuffered(const std::vector<std::shared_ptr<FileBufferManager>>& sessions);
+
+    static const int POOL_THREADS = 2;
+    static const int SESSION_COUNT = 6;
+    static const qint64 FILE_SIZE = 8 * 1024 * 1024;
+    static const qint64 HIGH_WATERMARK = 1024 * 1024;
+    static const qint64 LOW_WATERMARK = 512 * 1024;
+    static const qint64 READ_SIZE = 64 * 1024;
+    // 大小传输分别由多个source_组成，都要运行多个时间片才能读完
+    static const int LARGE_FILE_COUNT = 6;
+    static const int SMALL_FILE_COUNT = 2;
+    static const qint64 SCHEDULING_HIGH_WATERMARK = 64 * 1024 * 1024;
+
+    QTemporaryFile source_;
+    quint32 sourceCrc_ = 0;
+};
+
+void TransferSessionsTest::initTestCase()
+{
+    QVERIFY(source_.open());
+    std::vector<quint32> block(256 * 1024);
+    for (qint64 written = 0; written < FILE_SIZE; written += block.size() * sizeof(quint32)) {
+        QRandomGenerator::global()->fillRange(block.data(), static_cast<qsizetype>(block.size()));
+        const char* bytes = reinterpret_cast<const char*>(block.data());
+        const qint64 size = static_cast<qint64>(block.size() * sizeof(quint32));
+        QCOMPARE(source_.write(bytes, size), size);
+        sourceCrc_ = Crc32c::combine(sourceCrc_, Crc32c::compute(bytes, size), size);
+    }
+    QVERIFY(source_.flush());
+}
+
+TransferFileList TransferSessionsTest::sourceFiles() const
+{
+    TransferFile file;
+    file.filePath = source_.fileName();
+    file.fileName = QStringLiteral("source.bin");
+    file.fileSize = FILE_SIZE;
+    return TransferFileList() << file;
+}
+
+std::vector<std::shared_ptr<FileBufferManager>> TransferSessionsTest::startSessions(QThreadPool& pool, int count)
+{
+    std::vector<std::shared_ptr<FileBufferManager>> sessions;
+    for (int i = 0; i < count; ++i) {
+        std::shared_ptr<FileBufferManager> session = FileBufferManager::create();
+        session->setThreadPool(&pool);
+        startTransfer(*session);
+        sessions.push_back(session);
+    }
+    return sessions;
+}
+
+void TransferSessionsTest::startTransfer(FileBufferManager& session) const
+{
+    session.setFlowControl(HIGH_WATERMARK, LOW_WATERMARK);
+    session.startTransfer(sourceFiles());
+}
+
+bool TransferSessionsTest::allBuffered(const std::vector<std::shared_ptr<FileBufferManager>>& sessions)
+{
+    for (const std::shared_ptr<FileBufferManager>& session : sessions) {
+        if (session->getBufferedBytes() == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void TransferSessionsTest::moreSessionsThanThreads()
+{
+    QThreadPool pool;
+    pool.setMaxThreadCount(POOL_THREADS);
+    std::vector<std::shared_ptr<FileBufferManager>> sessions = startSessions(pool, SESSION_COUNT);
+
+    // 还没有读取方：每个会话都生产到高水位，之后所有生产者都让出线程
+    QTRY_VERIFY_WITH_TIMEOUT(allBuffered(sessions), 5000);
+    QTRY_COMPARE_WITH_TIMEOUT(pool.activeThreadCount(), 0, 5000);
+
+    // 轮流读取，每个会话都读完且数据一致
+    std::vector<qint64> offsets(sessions.size(), 0);
+    std::vector<quint32> crcs(sessions.size(), 0);
+    std::vector<char> buffer(READ_SIZE);
+    for (bool reading = true; reading; ) {
+        reading = false;
+        for (size_t i = 0; i < sessions.size(); ++i) {
+            if (offsets[i] >= FILE_SIZE) {
+                continue;
+            }
+            const qint64 bytesRead = sessions[i]->readData(0, offsets[i], buffer.data(), READ_SIZE);
+            QVERIFY2(bytesRead > 0, qPrintable(QString("session %1 stopped at %2").arg(i).arg(offsets[i])));
+            crcs[i] = Crc32c::combine(crcs[i], Crc32c::compute(buffer.data(), bytesRead), bytesRead);
+            offsets[i] += bytesRead;
+            reading = true;
+        }
+    }
+    for (size_t i = 0; i < sessions.size(); ++i) {
+        QCOMPARE(crcs[i], sourceCrc_);
+        sessions[i]->stopTransfer();
+    }
+}
+
+void TransferSessionsTest::stopParkedSession()
+{
+    QThreadPool pool;
+    pool.setMaxThreadCount(POOL_THREADS);
+    std::vector<std::shared_ptr<FileBufferManager>> sessions = startSessions(pool, SESSION_COUNT);
+    QTRY_VERIFY_WITH_TIMEOUT(allBuffered(sessions), 5000);
+    QTRY_COMPARE_WITH_TIMEOUT(pool.activeThreadCount(), 0, 5000);
+
+    // 占满线程池，等待背压的会话仍能立即停止
+    QSemaphore release;
+    for (int i = 0; i < POOL_THREADS; ++i) {
+        pool.start(new BlockingTask(release));
+    }
+    QElapsedTimer timer;
+    timer.start();
+    for (const std::shared_ptr<FileBufferManager>& session : sessions) {
+        session->stopTransfer();
+    }
+    const qint64 elapsed = timer.elapsed();
+    release.release(POOL_THREADS);
+    QVERIFY2(elapsed < 1000, qPrintable(QString::number(elapsed)));
+}
+
+void TransferSessionsTest::managerPoolStaysBounded()
+{
+    TransferSessionManager manager(POOL_THREADS);
+    manager.setSchedulingPolicy(TransferScheduler::WeightedFair);
+    std::vector<std::shared_ptr<FileBufferManager>> sessions;
+    for (int i = 0; i < SESSION_COUNT; ++i) {
+        sessions.push_back(manager.createSession());
+        startTransfer(*sessions.back());
+    }
+    QCOMPARE(manager.ioThreadPool()->maxThreadCount(), POOL_THREADS);
+    QTRY_VERIFY_WITH_TIMEOUT(allBuffered(sessions), 5000);
+    QTRY_COMPARE_WITH_TIMEOUT(manager.ioThreadPool()->activeThreadCount(), 0, 5000);
+    QCOMPARE(manager.ioThreadPool()->maxThreadCount(), POOL_THREADS);
+}
+
+void TransferSessionsTest::smallTransferFinishesFirst_data()
+{
+    QTest::addColumn<int>("policy");
+    QTest::addColumn<bool>("smallFirst");
+
+    // 先到先服务下先开始的大传输一直排在前面，对照其他两种策略
+    QTest::newRow("fifo") << static_cast<int>(TransferScheduler::Fifo) << false;
+    QTest::newRow("srpt") << static_cast<int>(TransferScheduler::ShortestRemainingFirst) << true;
+    QTest::newRow("wfq") << static_cast<int>(TransferScheduler::WeightedFair) << true;
+}
+
+void TransferSessionsTest::smallTransferFinishesFirst()
+{
+    QFETCH(int, policy);
+    QFETCH(bool, smallFirst);
+
+    // 一个线程、一个时隙：两个会话的生产任务在同一个线程上轮流运行，先后由调度决定
+    TransferSessionManager manager(1);
+    manager.setSchedulingPolicy(static_cast<TransferScheduler::Policy>(policy));
+
+    TransferFileList largeFiles;
+    for (int i = 0; i < LARGE_FILE_COUNT; ++i) {
+        largeFiles << sourceFiles();
+    }
+    TransferFileList smallFiles;
+    for (int i = 0; i < SMALL_FILE_COUNT; ++i) {
+        smallFiles << sourceFiles();
+    }
+    std::shared_ptr<FileBufferManager> large = manager.createSession();
+    std::shared_ptr<FileBufferManager> small = manager.createSession();
+    // 高水位大于传输的大小，生产者不会因背压让出线程，线程交给哪个会话只取决于调度
+    large->setFlowControl(SCHEDULING_HIGH_WATERMARK, SCHEDULING_HIGH_WATERMARK / 2);
+    small->setFlowControl(SCHEDULING_HIGH_WATERMARK, SCHEDULING_HIGH_WATERMARK / 2);
+    ReadTask largeReader(*large, largeFiles, READ_SIZE);
+    ReadTask smallReader(*small, smallFiles, READ_SIZE);
+    // 在读取任务之后声明，提前返回时先等它们结束
+    QThreadPool readers;
+    readers.setMaxThreadCount(2);
+
+    // 大传输先开始，小传输紧接着开始与它竞争
+    large->startTransfer(largeFiles);
+    readers.start(&largeReader);
+    small->startTransfer(smallFiles);
+    readers.start(&smallReader);
+    readers.waitForDone();
+
+    QVERIFY(largeReader.completionMs() >= 0);
+    QVERIFY(smallReader.completionMs() >= 0);
+    QCOMPARE(largeReader.crcs(), std::vector<quint32>(LARGE_FILE_COUNT, sourceCrc_));
+    QCOMPARE(smallReader.crcs(), std::vector<quint32>(SMALL_FILE_COUNT, sourceCrc_));
+
+    const QString completion = QString("%1: small %2 ms, large %3 ms, mean completion %4 ms")
+        .arg(TransferScheduler::policyName(static_cast<TransferScheduler::Policy>(policy)))
+        .arg(smallReader.completionMs()).arg(largeReader.completionMs())
+        .arg((smallReader.completionMs() + largeReader.completionMs()) / 2);
+    qInfo("%s", qPrintable(completion));
+    if (smallFirst) {
+        QVERIFY2(smallReader.completionMs() < largeReader.completionMs(), qPrintable(completion));
+    } else {
+        QVERIFY2(largeReader.completionMs() < smallReader.completionMs(), qPrintable(completion));
+    }
+    large->stopTransfer();
+    small->stopTransfer();
+}
+
+QTEST_GUILESS_MAIN(TransferSessionsTest)
+
+#include "tst_transfersessions.moc"
@@ -0,0 +1,133 @@
+#include "Crc32c.h"
+#include "TransferSessionManager.h"
+#include <QDir>
+#include <QFile>
+#include <QRandomGenerator>
+#include <QTemporaryDir>
+#include <QTemporaryFile>
+#include <QtTest>
+#include <vector>
+
+using namespace clipboard;
+
+// 打开端到端校验时数据一致的传输校验通过；溢出文件中的数据在读回之前被破坏时，
+// readData最迟在文件末尾返回-1，之后的读取也都失败
+class VerificationTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void verifiedTransfer();
+    void corruptedSpillFails();
+
+private:
+    TransferFileList sourceFiles() const;
+
+    static const qint64 FILE_SIZE = 16 * 1024 * 1024;
+    static const qint64 HIGH_WATERMARK = 1024 * 1024;
+    static const qint64 LOW_WATERMARK = 512 * 1024;
+    static const qint64 READ_SIZE = 64 * 1024;
+    static const qint64 CORRUPT_SIZE = 4096;
+
+    QTemporaryFile source_;
+    quint32 sourceCrc_ = 0;
+};
+
+void VerificationTest::initTestCase()
+{
+    QVERIFY(source_.open());
+    std::vector<quint32> block(256 * 1024);
+    for (qint64 written = 0; written < FILE_SIZE; written += block.size() * sizeof(quint32)) {
+        QRandomGenerator::global()->fillRange(block.data(), static_cast<qsizetype>(block.size()));
+        const char* bytes = reinterpret_cast<const char*>(block.data());
+        const qint64 size = static_cast<qint64>(block.size() * sizeof(quint32));
+        QCOMPARE(source_.write(bytes, size), size);
+        sourceCrc_ = Crc32c::combine(sourceCrc_, Crc32c::compute(bytes, size), size);
+    }
+    QVERIFY(source_.flush());
+}
+
+TransferFileList VerificationTest::sourceFiles() const
+{
+    TransferFile file;
+    file.filePath = source_.fileName();
+    file.fileName = QStringLiteral("source.bin");
+    file.fileSize = FILE_SIZE;
+    return TransferFileList() << file;
+}
+
+void VerificationTest::verifiedTransfer()
+{
+    TransferSessionManager sessions;
+    std::shared_ptr<FileBufferManager> session = sessions.createSession();
+    session->setChecksums(true);
+    session->startTransfer(sourceFiles());
+
+    std::vector<char> buffer(READ_SIZE);
+    quint32 crc = 0;
+    qint64 offset = 0;
+    while (offset < FILE_SIZE) {
+        const qint64 bytesRead = session->readData(0, offset, buffer.data(), READ_SIZE);
+        QVERIFY2(bytesRead > 0, qPrintable(QString("read stopped at %1").arg(offset)));
+        crc = Crc32c::combine(crc, Crc32c::compute(buffer.data(), bytesRead), bytesRead);
+        offset += bytesRead;
+    }
+    session->waitForVerification();
+
+    QCOMPARE(crc, sourceCrc_);
+    QCOMPARE(session->fileVerification(0).status, ChunkVerifier::FileResult::Verified);
+    QCOMPARE(session->statistics().verification.chunkMismatches, (qint64)0);
+    sessions.closeSession(session);
+}
+
+void VerificationTest::corruptedSpillFails()
+{
+    QTemporaryDir spillDir;
+    QVERIFY(spillDir.isValid());
+    TransferSessionManager sessions;
+    std::shared_ptr<FileBufferManager> session = sessions.createSession();
+    session->setChecksums(true);
+    session->setFlowControl(HIGH_WATERMARK, LOW_WATERMARK);
+    session->setSpill(true, spillDir.path());
+    session->startTransfer(sourceFiles());
+
+    // 不读取，等生产者把文件的大部分写入溢出文件，再破坏最早溢出的数据块
+    QTRY_VERIFY_WITH_TIMEOUT(session->statistics().spill.spilledBytes >= FILE_SIZE / 2, 10000);
+    const QStringList spillFiles = QDir(spillDir.path()).entryList(QStringList() << QStringLiteral("*.spill"), QDir::Files);
+    QCOMPARE(spillFiles.size(), 1);
+    QFile spill(QDir(spillDir.path()).filePath(spillFiles.first()));
+    QVERIFY(spill.open(QIODevice::ReadWrite));
+    QByteArray bytes = spill.read(CORRUPT_SIZE);
+    QCOMPARE(bytes.size(), (int)CORRUPT_SIZE);
+    for (int i = 0; i < bytes.size(); ++i) {
+        bytes[i] = static_cast<char>(~bytes[i]);
+    }
+    QVERIFY(spill.seek(0));
+    QCOMPARE(spill.write(bytes), (qint64)CORRUPT_SIZE);
+    spill.close();
+
+    std::vector<char> buffer(READ_SIZE);
+    qint64 offset = 0;
+    bool failed = false;
+    while (offset < FILE_SIZE) {
+        const qint64 bytesRead = session->readData(0, offset, buffer.data(), READ_SIZE);
+        if (bytesRead < 0) {
+            failed = true;
+            break;
+        }
+        QVERIFY2(bytesRead > 0, qPrintable(QString("read stopped at %1").arg(offset)));
+        offset += bytesRead;
+    }
+    QVERIFY(failed);
+    // 发现不一致之后的读取同样失败，包括已在缓存中的数据
+    QCOMPARE(session->readData(0, 0, buffer.data(), READ_SIZE), (qint64)-1);
+
+    session->waitForVerification();
+    QVERIFY(session->statistics().verification.chunkMismatches > 0);
+    sessions.closeSession(session);
+}
+
+QTEST_GUILESS_MAIN(VerificationTest)
+
+#include "tst_verification.moc"